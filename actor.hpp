@@ -0,0 +1,435 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file actor.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef ACTOR_HPP
+#define ACTOR_HPP
+
+#include <atomic>
+#include <cassert>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cache_line.hpp"
+#include "fifo.hpp"
+#include "mpsc_fifo.hpp"
+#include "nanotime.hpp"
+#include "wait.hpp"
+
+/// Mailbox any thread can send to, the default
+template<typename T> using mpsc_mailbox = mpsc_fifo<T, busy_spin>;
+/// Mailbox with a single sender, cheaper but only one thread may ever send to it
+template<typename T> using spsc_mailbox = fifo<T, busy_spin>;
+
+/// Metrics for one actor, a snapshot taken while it runs
+struct actor_stats
+{
+    actor_stats()
+        : sent(0)
+        , processed(0)
+        , depth(0)
+        , max_depth(0)
+        , turns(0)
+    {}
+
+    /// messages sent to it
+    size_t sent;
+    /// messages its handler has returned from
+    size_t processed;
+    /// messages waiting in the mailbox (and the one running)
+    size_t depth;
+    /// deepest the mailbox was at the start of a turn
+    size_t max_depth;
+    /// how many times it got a thread
+    size_t turns;
+    /// time spent in the handler
+    vl::duration run_time;
+};
+
+class actor_system;
+
+/** @class actor_base
+ *  @desc What the actor_system needs from an actor, see actor
+*/
+class actor_base
+{
+public:
+    virtual ~actor_base()
+    {}
+
+    /// @brief metrics, from any thread
+    actor_stats stats() const
+    {
+        actor_stats s;
+        s.processed = processed.load(std::memory_order_acquire);
+        s.sent = sent.load(std::memory_order_acquire);
+        s.depth = depth();
+        s.max_depth = max_depth.load(std::memory_order_relaxed);
+        s.turns = turns.load(std::memory_order_relaxed);
+        s.run_time = vl::nanoseconds(run_ns.load(std::memory_order_relaxed));
+        return s;
+    }
+
+protected:
+    actor_base(actor_system &sys, size_t home_worker, size_t budget_per_turn)
+        : sent(0)
+        , queued(0)
+        , scheduled(false)
+        , system(sys)
+        , home(home_worker)
+        , budget(budget_per_turn)
+        , processed(0)
+        , max_depth(0)
+        , turns(0)
+        , run_ns(0)
+    {}
+
+    /// @brief the sender calls this after the message is in the mailbox
+    inline void notify();
+
+    /// @brief messages in the mailbox, a message is counted after it is pushed
+    /// The handler can take one before its sender has counted it, never below zero.
+    size_t depth() const
+    {
+        size_t const p = processed.load(std::memory_order_relaxed);
+        size_t const q = queued.load(std::memory_order_relaxed);
+        return q > p ? q - p : 0;
+    }
+
+    // written by the senders
+    // before the push, shutdown relies on it
+    std::atomic<size_t> sent;
+    // after the push, what the mailbox can deliver
+    std::atomic<size_t> queued;
+    // true while the actor is in a run queue or running
+    std::atomic<bool> scheduled;
+    char pad0[CACHE_LINE_SIZE];
+
+private:
+    friend class actor_system;
+
+    // not copyable, the system and the senders point to it
+    actor_base(actor_base const &);
+    actor_base &operator=(actor_base const &);
+
+    /// @brief handle at most max messages in order
+    /// @return how many were handled
+    virtual size_t run(size_t max) = 0;
+
+    actor_system &system;
+    size_t home;
+    size_t budget;
+
+    // written by the thread running the actor
+    std::atomic<size_t> processed;
+    std::atomic<size_t> max_depth;
+    std::atomic<size_t> turns;
+    std::atomic<int64_t> run_ns;
+};
+
+/** @class actor
+ *  @desc An actor with its own state and mailbox, run by an actor_system
+ *  Handler is called with every message in the order they were sent (per sender for
+ *  mpsc_mailbox, messages from different threads interleave in the order they were pushed).
+ *  It keeps the state: a lambda with its captures or a struct with operator().
+ *  The handler is never run by two threads at once so the state needs no locking, and
+ *  it can send messages to other actors (or itself).
+ *
+ *  Create with actor_system::spawn, the system owns it.
+*/
+template<typename Msg, template<typename> class Mailbox = mpsc_mailbox>
+class actor : public actor_base
+{
+public:
+    /// @brief send a message, from any thread (from one thread with spsc_mailbox)
+    void send(Msg const &msg)
+    {
+        // sent is counted before the push (for shutdown), queued after it (for the scheduler)
+        sent.fetch_add(1, std::memory_order_seq_cst);
+        mailbox.push(msg);
+        queued.fetch_add(1, std::memory_order_seq_cst);
+        notify();
+    }
+
+    void send(Msg &&msg)
+    {
+        sent.fetch_add(1, std::memory_order_seq_cst);
+        mailbox.push(std::move(msg));
+        queued.fetch_add(1, std::memory_order_seq_cst);
+        notify();
+    }
+
+protected:
+    actor(actor_system &sys, size_t home_worker, size_t budget_per_turn)
+        : actor_base(sys, home_worker, budget_per_turn)
+    {}
+
+    Mailbox<Msg> mailbox;
+};
+
+/// The handler part, spawn creates these
+template<typename Msg, typename Handler, template<typename> class Mailbox>
+class actor_impl : public actor<Msg, Mailbox>
+{
+public:
+    actor_impl(actor_system &sys, size_t home_worker, size_t budget_per_turn, Handler h)
+        : actor<Msg, Mailbox>(sys, home_worker, budget_per_turn)
+        , handler(std::move(h))
+    {}
+
+private:
+    size_t run(size_t max)
+    {
+        size_t n = 0;
+        while(n < max && this->mailbox.consume([this](Msg &m) { handler(m); }))
+        {
+            ++n;
+        }
+        return n;
+    }
+
+    Handler handler;
+};
+
+/** @class actor_system
+ *  @desc Runs any number of actors on a fixed pool of threads
+ *  An actor is only scheduled when it has messages: the first message to an idle actor
+ *  puts it in the run queue of its thread, the thread runs it for at most budget messages
+ *  and puts it back at the end of the queue if there are more, so a busy actor doesn't
+ *  starve the others on the same thread. Idle threads sleep on their run queue (spin_park).
+ *
+ *  Actors are spread over the threads round robin when spawned and always run on the
+ *  same thread, their state stays in that core's caches. There is no stealing, put the
+ *  heavy actors on different threads (spawn order) if they are known.
+ *
+ *      actor_system sys(4);
+ *      actor<int> *a = sys.spawn<int>([sum = 0](int &v) mutable { sum += v; });
+ *      a->send(1);
+ *      sys.shutdown();
+ *
+ *  shutdown waits until every message sent before it, and every message those send,
+ *  has been handled. Sending from outside after shutdown isn't allowed.
+*/
+class actor_system
+{
+public:
+    /// @brief Constructor, starts the threads
+    /// @param n_threads size of the pool
+    /// @param budget default messages per turn
+    /// @param idle_wait how long an idle thread sleeps before checking for shutdown again
+    explicit actor_system(size_t n_threads, size_t budget = 64, vl::time const &idle_wait = vl::time(0, 1000))
+        : default_budget(budget)
+        , idle(idle_wait)
+        , stopping(false)
+        , next_home(0)
+    {
+        assert(n_threads > 0 && budget > 0);
+        for(size_t i = 0; i < n_threads; ++i)
+        {
+            workers.emplace_back(new worker);
+        }
+        for(size_t i = 0; i < n_threads; ++i)
+        {
+            workers[i]->thread = std::thread(&actor_system::work, this, i);
+        }
+    }
+
+    /// Destructor, shuts down if it wasn't
+    ~actor_system()
+    {
+        shutdown();
+        for(size_t i = 0; i < actors.size(); ++i)
+        {
+            delete actors[i];
+        }
+    }
+
+    /// @brief create an actor, from any thread
+    /// @param handler called with every message, keeps the state
+    /// @param budget messages per turn, 0 for the system default
+    /// @return the actor for sending, owned by the system
+    template<typename Msg, template<typename> class Mailbox = mpsc_mailbox, typename Handler>
+    actor<Msg, Mailbox> *spawn(Handler handler, size_t budget = 0)
+    {
+        std::lock_guard<std::mutex> lock(actors_mutex);
+        size_t const home = next_home++ % workers.size();
+        actor_impl<Msg, Handler, Mailbox> *a = new actor_impl<Msg, Handler, Mailbox>(
+                *this, home, budget == 0 ? default_budget : budget, std::move(handler));
+        actors.push_back(a);
+        return a;
+    }
+
+    /// @brief wait for every message to be handled and stop the threads
+    void shutdown()
+    {
+        stopping.store(true, std::memory_order_release);
+        for(size_t i = 0; i < workers.size(); ++i)
+        {
+            if(workers[i]->thread.joinable())
+            { workers[i]->thread.join(); }
+        }
+    }
+
+    /// @brief number of threads
+    size_t size() const
+    {
+        return workers.size();
+    }
+
+    /// @brief number of actors
+    size_t actor_count()
+    {
+        std::lock_guard<std::mutex> lock(actors_mutex);
+        return actors.size();
+    }
+
+    /// @brief metrics of every actor in spawn order
+    std::vector<actor_stats> stats()
+    {
+        std::lock_guard<std::mutex> lock(actors_mutex);
+        std::vector<actor_stats> all;
+        all.reserve(actors.size());
+        for(size_t i = 0; i < actors.size(); ++i)
+        {
+            all.push_back(actors[i]->stats());
+        }
+        return all;
+    }
+
+private:
+    friend class actor_base;
+
+    /// One pool thread
+    struct worker
+    {
+        // actors with messages, from the senders
+        mpsc_fifo<actor_base *, spin_park> ready;
+        // actors that used their budget, only the thread
+        std::deque<actor_base *> again;
+        std::thread thread;
+        char pad[CACHE_LINE_SIZE];
+    };
+
+    // not copyable, owns threads
+    actor_system(actor_system const &);
+    actor_system &operator=(actor_system const &);
+
+    void schedule(actor_base *a)
+    {
+        workers[a->home]->ready.push(a);
+    }
+
+    /// @brief the thread loop
+    void work(size_t i)
+    {
+        worker &w = *workers[i];
+        while(true)
+        {
+            w.ready.consume_all([&w](actor_base *a) { w.again.push_back(a); });
+            if(w.again.empty())
+            {
+                if(stopping.load(std::memory_order_acquire) && quiet())
+                { return; }
+                w.ready.wait(idle);
+                continue;
+            }
+
+            actor_base *a = w.again.front();
+            w.again.pop_front();
+            if(turn(*a))
+            {
+                w.again.push_back(a);
+            }
+        }
+    }
+
+    /// @brief run an actor for its budget
+    /// @return true if it still has messages and stays scheduled
+    bool turn(actor_base &a)
+    {
+        size_t const depth = a.depth();
+
+        vl::time_point const start = vl::fast_clock::now();
+        size_t const n = a.run(a.budget);
+        // nothing handled isn't a turn: the last turn took the message before it was counted
+        // or an earlier push into the mpsc mailbox isn't linked yet
+        if(n > 0)
+        {
+            a.run_ns.fetch_add((vl::fast_clock::now() - start).count(), std::memory_order_relaxed);
+            a.processed.fetch_add(n, std::memory_order_seq_cst);
+            a.turns.fetch_add(1, std::memory_order_relaxed);
+            if(depth > a.max_depth.load(std::memory_order_relaxed))
+            { a.max_depth.store(depth, std::memory_order_relaxed); }
+        }
+
+        if(pending(a))
+        {
+            // let the sender that is linking it finish
+            if(n == 0)
+            { std::this_thread::yield(); }
+            return true;
+        }
+        // a sender that counted its message before this store sees scheduled set and doesn't
+        // schedule, so look again after clearing it, one of us has to see the message.
+        a.scheduled.store(false, std::memory_order_seq_cst);
+        if(pending(a) && !a.scheduled.exchange(true, std::memory_order_seq_cst))
+        {
+            return true;
+        }
+        return false;
+    }
+
+    /// @brief messages in the mailbox, only from the thread running the actor
+    /// Counted after the push so a message is there when this says so (the handler can
+    /// be ahead of the count, then processed is the bigger one).
+    static bool pending(actor_base const &a)
+    {
+        return a.queued.load(std::memory_order_seq_cst) > a.processed.load(std::memory_order_relaxed);
+    }
+
+    /// @brief has every message sent so far been handled
+    /// All the handled counts are read before the sent counts, both only grow, so equal sums
+    /// mean there was a moment with nothing in any mailbox and no handler running.
+    bool quiet()
+    {
+        std::lock_guard<std::mutex> lock(actors_mutex);
+        size_t n_processed = 0;
+        for(size_t i = 0; i < actors.size(); ++i)
+        {
+            n_processed += actors[i]->processed.load(std::memory_order_seq_cst);
+        }
+        size_t n_sent = 0;
+        for(size_t i = 0; i < actors.size(); ++i)
+        {
+            n_sent += actors[i]->sent.load(std::memory_order_seq_cst);
+        }
+        return n_processed == n_sent;
+    }
+
+    std::vector<std::unique_ptr<worker> > workers;
+    size_t default_budget;
+    vl::time idle;
+    std::atomic<bool> stopping;
+
+    std::mutex actors_mutex;
+    std::vector<actor_base *> actors;
+    size_t next_home;
+};
+
+inline void actor_base::notify()
+{
+    if(!scheduled.exchange(true, std::memory_order_seq_cst))
+    {
+        system.schedule(this);
+    }
+}
+
+#endif  // ACTOR_HPP
@@ -0,0 +1,217 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file arena.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include "cache_line.hpp"
+
+/** @class payload_arena
+ *  @desc Slab allocator for message payloads owned by the thread that sends them
+ *  The owner allocates, any thread can release. Blocks come in power of two size classes
+ *  carved from large chunks, so after warm up allocate doesn't touch the system allocator.
+ *
+ *  Released blocks go back to the owner through a lock free stack: releasers push,
+ *  the owner takes the whole stack at once when a size class runs dry. Push only
+ *  plus take all doesn't have the ABA problem of a general lock free stack.
+ *
+ *  Every block has a small header pointing to its arena so release doesn't need to know
+ *  where the block came from. The arena has to outlive all the blocks it has handed out.
+*/
+class payload_arena
+{
+private:
+    /// In front of every block
+    struct header
+    {
+        payload_arena *owner;
+        header *next;
+        uint32_t size_class;
+    };
+
+    /// Header size rounded up so payloads are aligned for anything
+    static const size_t HEADER_SIZE = (sizeof(header) + alignof(std::max_align_t) - 1)
+        / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    /// Smallest payload is 1 << MIN_SHIFT bytes
+    static const size_t MIN_SHIFT = 6;
+    static const size_t N_CLASSES = 16;
+    /// Blocks larger than the largest class are allocated one by one
+    static const uint32_t LARGE = uint32_t(-1);
+
+public:
+    /// @brief Constructor
+    /// @param chunk_size how much memory is allocated at a time for the small size classes
+    payload_arena(size_t chunk_size = 64*1024)
+        : returned(nullptr)
+        , chunk(chunk_size)
+        , outstanding(0)
+    {
+        for(size_t i = 0; i < N_CLASSES; ++i)
+        {
+            free_lists[i] = nullptr;
+        }
+    }
+
+    /// Destructor, all the blocks have to be released
+    ~payload_arena()
+    {
+        collect();
+        assert(outstanding == 0);
+
+        for(size_t i = 0; i < chunks.size(); ++i)
+        {
+            ::operator delete(chunks[i]);
+        }
+    }
+
+    /// @brief allocate a payload, only the owner
+    /// @param bytes size of the payload
+    /// @return pointer to at least bytes of memory aligned for any type
+    /// @throws std::bad_alloc
+    void *allocate(size_t bytes)
+    {
+        uint32_t const cls = size_class(bytes);
+        header *h = nullptr;
+        if(cls == LARGE)
+        {
+            h = static_cast<header *>(::operator new(HEADER_SIZE + bytes));
+        }
+        else
+        {
+            if(free_lists[cls] == nullptr)
+            {
+                collect();
+            }
+            if(free_lists[cls] == nullptr)
+            {
+                refill(cls);
+            }
+            h = free_lists[cls];
+            free_lists[cls] = h->next;
+        }
+
+        h->owner = this;
+        h->next = nullptr;
+        h->size_class = cls;
+        ++outstanding;
+        return reinterpret_cast<char *>(h) + HEADER_SIZE;
+    }
+
+    /// @brief allocate an array of n trivial elements, only the owner
+    template<typename T>
+    T *allocate_array(size_t n)
+    {
+        return static_cast<T *>(allocate(n*sizeof(T)));
+    }
+
+    /// @brief give a payload back to the arena it came from, any thread
+    /// @param p pointer returned by allocate, nullptr is ignored
+    static void release(void *p)
+    {
+        if(p == nullptr)
+        { return; }
+
+        header *h = reinterpret_cast<header *>(static_cast<char *>(p) - HEADER_SIZE);
+        h->owner->push_returned(h);
+    }
+
+    /// @brief how many blocks the owner has handed out that it hasn't got back yet, only the owner
+    /// Blocks released by other threads are counted once the owner has collected them.
+    size_t allocated() const
+    {
+        return outstanding;
+    }
+
+    /// @brief take back everything released so far, only the owner
+    void collect()
+    {
+        header *h = returned.exchange(nullptr, std::memory_order_acquire);
+        while(h != nullptr)
+        {
+            header *next = h->next;
+            if(h->size_class == LARGE)
+            {
+                ::operator delete(h);
+            }
+            else
+            {
+                h->next = free_lists[h->size_class];
+                free_lists[h->size_class] = h;
+            }
+            --outstanding;
+            h = next;
+        }
+    }
+
+private:
+    // not copyable, blocks point to us
+    payload_arena(payload_arena const &);
+    payload_arena &operator=(payload_arena const &);
+
+    static uint32_t size_class(size_t bytes)
+    {
+        for(uint32_t cls = 0; cls < N_CLASSES; ++cls)
+        {
+            if(bytes <= (size_t(1) << (MIN_SHIFT + cls)))
+            { return cls; }
+        }
+        return LARGE;
+    }
+
+    static size_t block_size(uint32_t cls)
+    {
+        return HEADER_SIZE + (size_t(1) << (MIN_SHIFT + cls));
+    }
+
+    /// @brief allocate a chunk and split it into free blocks of a class
+    void refill(uint32_t cls)
+    {
+        size_t const block = block_size(cls);
+        size_t const n = chunk > block ? chunk/block : 1;
+        char *mem = static_cast<char *>(::operator new(n*block));
+        chunks.push_back(mem);
+
+        for(size_t i = 0; i < n; ++i)
+        {
+            header *h = reinterpret_cast<header *>(mem + i*block);
+            h->next = free_lists[cls];
+            free_lists[cls] = h;
+        }
+    }
+
+    void push_returned(header *h)
+    {
+        header *head = returned.load(std::memory_order_relaxed);
+        do
+        {
+            h->next = head;
+        }
+        while(!returned.compare_exchange_weak(head, h,
+                    std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    // shared: pushed by the releasing threads
+    std::atomic<header *> returned;
+    char pad0[CACHE_LINE_SIZE - sizeof(std::atomic<header *>)];
+
+    // owner only
+    header *free_lists[N_CLASSES];
+    std::vector<char *> chunks;
+    size_t chunk;
+    size_t outstanding;
+};
+
+#endif  // ARENA_HPP
@@ -0,0 +1,416 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file bench_fifo.cpp
+*
+*   Under a copyleft.
+*/
+
+// Microbenchmarks for the queues on their own
+// - throughput: one writer thread, one reader thread, messages per second
+// - pingpong: round trip through two queues, latency percentiles
+// - burst: writer fills the queue, time for the reader to drain it
+// each for 8 B, 64 B and 8 KB elements.
+// - fanout: one writer sending every update to 4 and 16 readers,
+//   broadcast_ring (one write) against a fifo per reader (a copy each) for 64 B and 8 KB.
+//
+// Params {EXE} {N_MESSAGES} {FORMAT}
+// N_MESSAGES how many messages for the throughput test (others are scaled from it)
+// FORMAT csv (default) or json
+
+#include "fifo.hpp"
+#include "ring_fifo.hpp"
+#include "mpsc_fifo.hpp"
+#include "broadcast_ring.hpp"
+#include "nanotime.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Element of a given size, the first word is used as a sequence number
+template<size_t BYTES>
+struct element
+{
+    element(size_t seq = 0)
+    {
+        std::memset(bytes, 0, BYTES);
+        std::memcpy(bytes, &seq, sizeof(seq));
+    }
+
+    size_t seq() const
+    {
+        size_t s;
+        std::memcpy(&s, bytes, sizeof(s));
+        return s;
+    }
+
+    unsigned char bytes[BYTES];
+};
+
+/// 8 KB, the size of the original fixed batch message
+typedef element<8192> message_element;
+
+// all the queues yield when they have nothing to do so this works on a single core too
+template<typename T> using fifo_t = fifo<T, spin_yield>;
+template<typename T> using ring_t = ring_fifo<T, 1024, spin_yield>;
+template<typename T> using mpsc_t = mpsc_fifo<T, spin_yield>;
+template<typename T> using broadcast_t = broadcast_ring<T, 1024, spin_yield>;
+
+const vl::time TIMEOUT(10);
+
+/// One line of output
+struct result
+{
+    std::string queue;
+    size_t bytes;
+    std::string test;
+    std::string metric;
+    double value;
+};
+
+std::vector<result> results;
+
+void report(std::string const &queue, size_t bytes, std::string const &test,
+        std::string const &metric, double value)
+{
+    result r = { queue, bytes, test, metric, value };
+    results.push_back(r);
+    std::clog << queue << " " << bytes << "B " << test << " " << metric << " = " << value << std::endl;
+}
+
+/// @brief did every reader get all n messages, prints the ones that timed out
+bool all_received(std::vector<size_t> const &received, size_t n, const char *name, size_t bytes, size_t n_readers)
+{
+    bool all = true;
+    for(size_t r = 0; r < received.size(); ++r)
+    {
+        if(received[r] != n)
+        {
+            std::cerr << name << " " << bytes << "B fanout_" << n_readers << ": reader " << r
+                << " timed out after " << received[r] << " of " << n << " messages" << std::endl;
+            all = false;
+        }
+    }
+    return all;
+}
+
+double seconds_since(vl::time_point start)
+{
+    return (vl::fast_clock::now() - start).seconds();
+}
+
+/// @brief one way messages per second
+template<template<typename> class Queue, typename T>
+void bench_throughput(const char *name, size_t n)
+{
+    Queue<T> *q = new Queue<T>;
+    bool in_order = true;
+    size_t expected = 0;
+
+    auto start = vl::fast_clock::now();
+    std::thread reader([q, n, &in_order, &expected]()
+    {
+        while(expected < n && q->wait(TIMEOUT))
+        {
+            q->consume_all([&expected, &in_order](T &e)
+            {
+                in_order = in_order && e.seq() == expected;
+                ++expected;
+            });
+        }
+    });
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        q->emplace(i);
+    }
+    reader.join();
+    double const secs = seconds_since(start);
+
+    if(!in_order)
+    {
+        std::cerr << name << " throughput: messages out of order" << std::endl;
+    }
+    // a reader that timed out didn't get everything, there is no rate to report
+    if(expected != n)
+    {
+        std::cerr << name << " " << sizeof(T) << "B throughput: timed out after "
+            << expected << " of " << n << " messages" << std::endl;
+    }
+    else
+    {
+        report(name, sizeof(T), "throughput", "msgs_per_s", n/secs);
+    }
+    delete q;
+}
+
+/// @brief round trip latency through two queues with an echo thread
+template<template<typename> class Queue, typename T>
+void bench_pingpong(const char *name, size_t n)
+{
+    Queue<T> *ping = new Queue<T>;
+    Queue<T> *pong = new Queue<T>;
+
+    std::thread echo([ping, pong, n]()
+    {
+        for(size_t i = 0; i < n; ++i)
+        {
+            if(!ping->wait(TIMEOUT))
+            { return; }
+            ping->consume([pong](T &e) { pong->push(e); });
+        }
+    });
+
+    std::vector<double> rtt;
+    rtt.reserve(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        auto start = vl::fast_clock::now();
+        ping->emplace(i);
+        if(!pong->wait(TIMEOUT))
+        { break; }
+        pong->consume([](T &) {});
+        rtt.push_back(double((vl::fast_clock::now() - start).count()));
+    }
+    echo.join();
+
+    if(rtt.empty())
+    {
+        delete ping;
+        delete pong;
+        return;
+    }
+
+    std::sort(rtt.begin(), rtt.end());
+    const double percentiles[] = { 50, 90, 99, 99.9 };
+    const char *names[] = { "rtt_p50_ns", "rtt_p90_ns", "rtt_p99_ns", "rtt_p999_ns" };
+    for(size_t i = 0; i < 4; ++i)
+    {
+        size_t idx = size_t(percentiles[i]/100*(rtt.size() - 1));
+        report(name, sizeof(T), "pingpong", names[i], rtt[idx]);
+    }
+    report(name, sizeof(T), "pingpong", "rtt_max_ns", rtt.back());
+
+    delete ping;
+    delete pong;
+}
+
+/// @brief fill the queue and time draining it from another thread
+template<template<typename> class Queue, typename T>
+void bench_burst(const char *name, size_t burst, size_t rounds)
+{
+    Queue<T> *q = new Queue<T>;
+
+    double total = 0;
+    for(size_t r = 0; r < rounds; ++r)
+    {
+        // the reader is started first and waits for the go, thread start up isn't timed
+        std::atomic<bool> go(false);
+        vl::time_point end;
+        std::thread reader([q, burst, &go, &end]()
+        {
+            while(!go.load(std::memory_order_acquire))
+            { std::this_thread::yield(); }
+            size_t got = 0;
+            while(got < burst)
+            {
+                got += q->consume_all([](T &) {});
+            }
+            end = vl::fast_clock::now();
+        });
+
+        for(size_t i = 0; i < burst; ++i)
+        {
+            q->emplace(i);
+        }
+
+        // the reader starts only after the burst is queued
+        vl::time_point const start = vl::fast_clock::now();
+        go.store(true, std::memory_order_release);
+        reader.join();
+        total += double((end - start).count());
+    }
+
+    report(name, sizeof(T), "burst", "drain_ns_per_msg", total/(rounds*burst));
+    delete q;
+}
+
+/// @brief updates per second to every reader through one broadcast_ring
+template<typename T>
+void bench_fanout_broadcast(size_t n_readers, size_t n)
+{
+    broadcast_t<T> *ring = new broadcast_t<T>(n_readers);
+    std::vector<typename broadcast_t<T>::reader *> readers;
+    for(size_t r = 0; r < n_readers; ++r)
+    {
+        readers.push_back(new typename broadcast_t<T>::reader(*ring));
+    }
+
+    auto start = vl::fast_clock::now();
+    std::vector<std::thread> threads;
+    std::vector<size_t> received(n_readers, 0);
+    for(size_t r = 0; r < n_readers; ++r)
+    {
+        typename broadcast_t<T>::reader *rd = readers[r];
+        size_t *got = &received[r];
+        threads.push_back(std::thread([rd, n, got]()
+        {
+            while(*got < n && rd->wait(TIMEOUT))
+            {
+                *got += rd->consume_all([](T const &) {});
+            }
+        }));
+    }
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        ring->emplace(i);
+    }
+    for(size_t r = 0; r < n_readers; ++r)
+    {
+        threads[r].join();
+        delete readers[r];
+    }
+    double const secs = seconds_since(start);
+
+    if(all_received(received, n, "broadcast_ring", sizeof(T), n_readers))
+    {
+        report("broadcast_ring", sizeof(T), "fanout_" + std::to_string(n_readers), "updates_per_s", n/secs);
+    }
+    delete ring;
+}
+
+/// @brief the same with a fifo per reader, the writer pushes a copy to each
+template<typename T>
+void bench_fanout_fifo(size_t n_readers, size_t n)
+{
+    std::vector<fifo_t<T> *> queues;
+    for(size_t r = 0; r < n_readers; ++r)
+    {
+        queues.push_back(new fifo_t<T>);
+    }
+
+    auto start = vl::fast_clock::now();
+    std::vector<std::thread> threads;
+    std::vector<size_t> received(n_readers, 0);
+    for(size_t r = 0; r < n_readers; ++r)
+    {
+        fifo_t<T> *q = queues[r];
+        size_t *got = &received[r];
+        threads.push_back(std::thread([q, n, got]()
+        {
+            while(*got < n && q->wait(TIMEOUT))
+            {
+                *got += q->consume_all([](T &) {});
+            }
+        }));
+    }
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        for(size_t r = 0; r < n_readers; ++r)
+        {
+            queues[r]->emplace(i);
+        }
+    }
+    for(size_t r = 0; r < n_readers; ++r)
+    {
+        threads[r].join();
+        delete queues[r];
+    }
+    double const secs = seconds_since(start);
+
+    if(all_received(received, n, "fifo", sizeof(T), n_readers))
+    {
+        report("fifo", sizeof(T), "fanout_" + std::to_string(n_readers), "updates_per_s", n/secs);
+    }
+}
+
+template<typename T>
+void bench_fanout(size_t n)
+{
+    size_t const scaled = std::max<size_t>(sizeof(T) > 1024 ? n/64 : n/8, 1);
+    const size_t readers[] = { 4, 16 };
+    for(size_t i = 0; i < 2; ++i)
+    {
+        bench_fanout_broadcast<T>(readers[i], scaled);
+        bench_fanout_fifo<T>(readers[i], scaled);
+    }
+}
+
+template<template<typename> class Queue, typename T>
+void bench_all(const char *name, size_t n)
+{
+    // big elements move a lot more memory, keep the run times similar
+    // at least one message for every test so a small N_MESSAGES doesn't divide by zero
+    size_t const scaled = std::max<size_t>(sizeof(T) > 1024 ? n/32 : n, 1);
+    bench_throughput<Queue, T>(name, scaled);
+    bench_pingpong<Queue, T>(name, std::max<size_t>(scaled/20, 1));
+    // the ring can't queue more than its capacity
+    bench_burst<Queue, T>(name, std::max<size_t>(std::min<size_t>(scaled/10, 1024), 1), 10);
+}
+
+template<template<typename> class Queue>
+void bench_sizes(const char *name, size_t n)
+{
+    bench_all<Queue, element<8> >(name, n);
+    bench_all<Queue, element<64> >(name, n);
+    bench_all<Queue, message_element>(name, n);
+}
+
+void print_csv()
+{
+    std::cout << "queue,element_bytes,test,metric,value" << std::endl;
+    for(size_t i = 0; i < results.size(); ++i)
+    {
+        result const &r = results[i];
+        std::cout << r.queue << "," << r.bytes << "," << r.test << "," << r.metric << "," << r.value << std::endl;
+    }
+}
+
+void print_json()
+{
+    std::cout << "[" << std::endl;
+    for(size_t i = 0; i < results.size(); ++i)
+    {
+        result const &r = results[i];
+        std::cout << "  {\"queue\": \"" << r.queue << "\", \"element_bytes\": " << r.bytes
+            << ", \"test\": \"" << r.test << "\", \"metric\": \"" << r.metric
+            << "\", \"value\": " << r.value << "}" << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    std::cout << "]" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = 1000000;
+    std::string format = "csv";
+
+    if(argc > 1)
+    {
+        n = std::atoi(argv[1]);
+    }
+    if(argc > 2)
+    {
+        format = argv[2];
+    }
+
+    bench_sizes<fifo_t>("fifo", n);
+    bench_sizes<ring_t>("ring_fifo", n);
+    bench_sizes<mpsc_t>("mpsc_fifo", n);
+    bench_fanout<element<64> >(n);
+    bench_fanout<message_element>(n);
+
+    if(format == "json")
+    { print_json(); }
+    else
+    { print_csv(); }
+
+    return 0;
+}
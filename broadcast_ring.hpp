@@ -0,0 +1,462 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file broadcast_ring.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef BROADCAST_RING_HPP
+#define BROADCAST_RING_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cache_line.hpp"
+#include "wait.hpp"
+
+/// What the writer of a broadcast_ring does when the slowest reader is N entries behind
+enum broadcast_mode
+{
+    /// wait for the slowest reader, nobody misses anything
+    BROADCAST_GATED,
+    /// write over the oldest entry, a reader that falls behind skips what it missed
+    BROADCAST_LOSSY
+};
+
+/** @class broadcast_ring
+ *  @desc One writer, any number of readers that all see every entry (Disruptor style)
+ *  The writer constructs each entry once in a preallocated ring of N slots and publishes
+ *  it by moving its sequence forward. Every reader has its own cursor (the sequence of
+ *  the next entry it reads) on its own cache line and reads the entries in place, so
+ *  an update to 30 readers is one write and 30 reads instead of 30 copies.
+ *
+ *  Readers join and leave at any time with a reader object, they start from the entries
+ *  published after they joined. Up to max_readers at the same time.
+ *
+ *  BROADCAST_GATED: the writer waits (yields) while the slowest reader is N entries behind.
+ *  With no readers the entries are simply dropped when the ring wraps.
+ *
+ *  BROADCAST_LOSSY: the writer never waits and never looks at the readers. Each slot has
+ *  a stamp that the writer changes around the write (a seqlock), a reader copies the entry
+ *  out and checks the stamp didn't change. A reader that was lapped jumps to the oldest
+ *  entry still in the ring and counts what it missed. T has to be trivially copyable.
+ *
+ *  N has to be a power of two. Wait is the strategy readers use when there's nothing new.
+*/
+template<typename T, size_t N, typename Wait = busy_spin, broadcast_mode Mode = BROADCAST_GATED>
+class broadcast_ring
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "broadcast_ring capacity has to be a power of two");
+    static_assert(Mode == BROADCAST_GATED || std::is_trivially_copyable<T>::value,
+            "lossy broadcast_ring elements have to be trivially copyable");
+
+private:
+    /// Gated element, constructed in place and alive until the writer comes around again
+    struct gated_slot
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *data()
+        { return reinterpret_cast<T *>(storage); }
+    };
+
+    /// Lossy element, stored as words written and read with relaxed atomics (like ws_deque)
+    /// so a reader racing with the writer gets a torn copy it throws away, never undefined behaviour.
+    struct lossy_slot
+    {
+        static constexpr size_t WORDS = (sizeof(T) + sizeof(uintptr_t) - 1)/sizeof(uintptr_t);
+
+        /// sequence + 1 of the entry in the slot, WRITING while the writer is on it
+        std::atomic<uint64_t> stamp;
+        std::atomic<uintptr_t> words[WORDS];
+    };
+
+    typedef typename std::conditional<Mode == BROADCAST_GATED, gated_slot, lossy_slot>::type slot;
+
+    /// Position of one reader, FREE when nobody is using it
+    struct alignas(CACHE_LINE_SIZE) cursor
+    {
+        cursor()
+            : seq(FREE)
+        {}
+
+        std::atomic<uint64_t> seq;
+    };
+
+public:
+    static constexpr uint64_t FREE = std::numeric_limits<uint64_t>::max();
+
+    /** @class reader
+     *  @desc A subscription to the ring, used by a single thread
+     *  Sees every entry published after it was created (gated) or as many of them as
+     *  it can keep up with (lossy).
+    */
+    class reader
+    {
+    public:
+        /// @brief join the ring
+        /// @throws std::string if max_readers are already reading
+        reader(broadcast_ring &r)
+            : ring(r)
+            , pos(r.subscribe(index))
+            , n_missed(0)
+        {}
+
+        /// Leave the ring, the writer no longer waits for us
+        ~reader()
+        {
+            ring.unsubscribe(index);
+        }
+
+        /// @brief use every entry published so far in place, the cursor is moved once at the end
+        /// @param f functor called with a const reference to every entry in order, must not throw
+        /// In lossy mode f gets a copy that was checked not to be overwritten.
+        /// @return number of entries consumed
+        template<typename F>
+        size_t consume_all(F f)
+        {
+            return consume_n(f, std::numeric_limits<size_t>::max());
+        }
+
+        /// @brief use the next entry if there is one
+        template<typename F>
+        bool consume(F f)
+        {
+            return consume_n(f, 1) == 1;
+        }
+
+        /// @brief copy the next entry out if there is one
+        /// @param data OUT the entry
+        /// @return true if there was one, false if we are up to date
+        bool try_read(T &data)
+        {
+            return consume_n([&data](T const &e) { data = e; }, 1) == 1;
+        }
+
+        /// @brief wait until there is something new
+        /// @param timeout how long to wait at most
+        /// @return true if there is, false if we timed out
+        bool wait(vl::time const &timeout)
+        {
+            return ring.waiter.wait([this]() { return !empty(); }, timeout);
+        }
+
+        /// @brief copy the next entry out, waits for one if we are up to date
+        bool read_wait(T &data, vl::time const &timeout)
+        {
+            return wait(timeout) && try_read(data);
+        }
+
+        /// @brief nothing new for us
+        bool empty() const
+        {
+            return ring.published.load(std::memory_order_acquire) == pos;
+        }
+
+        /// @brief sequence of the next entry we read
+        uint64_t position() const
+        {
+            return pos;
+        }
+
+        /// @brief entries that were overwritten before we got to them, always 0 when gated
+        uint64_t missed() const
+        {
+            return n_missed;
+        }
+
+    private:
+        // not copyable, owns the cursor
+        reader(reader const &);
+        reader &operator=(reader const &);
+
+        template<typename F>
+        size_t consume_n(F f, size_t max)
+        {
+            uint64_t end = ring.published.load(std::memory_order_acquire);
+            size_t count = 0;
+
+            if constexpr(Mode == BROADCAST_GATED)
+            {
+                // the writer can't touch anything from pos on until we move our cursor
+                for(; pos != end && count < max; ++pos, ++count)
+                {
+                    f(*static_cast<T const *>(ring.slots[pos & MASK].data()));
+                }
+            }
+            else
+            {
+                while(pos != end && count < max)
+                {
+                    // lapped, the oldest entry still in the ring is end - N
+                    if(end - pos > N)
+                    {
+                        n_missed += end - N - pos;
+                        pos = end - N;
+                    }
+
+                    // raw copy, T doesn't need a default constructor
+                    alignas(T) unsigned char copy[sizeof(T)];
+                    if(!ring.read_slot(pos, copy))
+                    {
+                        // overwritten while we were copying, try again with a fresh end
+                        end = ring.published.load(std::memory_order_acquire);
+                        continue;
+                    }
+                    f(*reinterpret_cast<T const *>(copy));
+                    ++pos;
+                    ++count;
+                }
+            }
+
+            if(count > 0)
+            {
+                ring.cursors[index].seq.store(pos, std::memory_order_release);
+            }
+            return count;
+        }
+
+        broadcast_ring &ring;
+        size_t index;
+        uint64_t pos;
+        uint64_t n_missed;
+    };
+
+    /// @brief Constructor, allocates the slots
+    /// @param max_readers how many readers can be subscribed at the same time
+    broadcast_ring(size_t max_readers = 32)
+        : published(0)
+        , cached_min(0)
+        , slots(new slot[N])
+        , cursors(max_readers)
+    {
+        if constexpr(Mode == BROADCAST_LOSSY)
+        {
+            for(size_t i = 0; i < N; ++i)
+            {
+                slots[i].stamp.store(WRITING, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// Destructor, the readers have to be gone
+    ~broadcast_ring()
+    {
+        if constexpr(Mode == BROADCAST_GATED)
+        {
+            uint64_t const end = published.load();
+            uint64_t const first = end > N ? end - N : 0;
+            for(uint64_t s = first; s != end; ++s)
+            {
+                slots[s & MASK].data()->~T();
+            }
+        }
+        delete [] slots;
+    }
+
+    /// @brief publish a copy of data to every reader, only the writer
+    /// Gated: waits for the slowest reader if the ring is full.
+    void push(T const &data)
+    {
+        emplace(data);
+    }
+
+    void push(T &&data)
+    {
+        emplace(std::move(data));
+    }
+
+    /// @brief construct an entry in place and publish it, only the writer
+    template<typename... Args>
+    void emplace(Args&&... args)
+    {
+        while(!has_room())
+        {
+            std::this_thread::yield();
+        }
+        construct(std::forward<Args>(args)...);
+    }
+
+    /// @brief publish if the slowest reader isn't N entries behind, only the writer
+    /// Always succeeds in lossy mode.
+    /// @return true if published, false if the ring was full
+    bool try_push(T const &data)
+    {
+        if(!has_room())
+        {
+            return false;
+        }
+        construct(data);
+        return true;
+    }
+
+    /// @brief sequence the next entry gets, everything before it has been published
+    uint64_t position() const
+    {
+        return published.load(std::memory_order_acquire);
+    }
+
+    /// @brief how many readers are subscribed right now
+    size_t readers() const
+    {
+        size_t n = 0;
+        for(size_t i = 0; i < cursors.size(); ++i)
+        {
+            if(cursors[i].seq.load(std::memory_order_relaxed) != FREE)
+            { ++n; }
+        }
+        return n;
+    }
+
+    /// @brief how many entries fit in the ring
+    static size_t capacity()
+    {
+        return N;
+    }
+
+private:
+    // not copyable, the readers point to us
+    broadcast_ring(broadcast_ring const &);
+    broadcast_ring &operator=(broadcast_ring const &);
+
+    /// stamp of a slot the writer is on
+    static constexpr uint64_t WRITING = 0;
+    static constexpr size_t MASK = N - 1;
+
+    /// @brief take a free cursor and start from the current end
+    uint64_t subscribe(size_t &index)
+    {
+        for(size_t i = 0; i < cursors.size(); ++i)
+        {
+            uint64_t expected = FREE;
+            uint64_t const start = published.load(std::memory_order_acquire);
+            if(cursors[i].seq.compare_exchange_strong(expected, start, std::memory_order_seq_cst))
+            {
+                // the writer might have checked the cursors before it saw us and gone further
+                // than start + N, but not further than anything it published after our store
+                uint64_t const now = published.load(std::memory_order_seq_cst);
+                cursors[i].seq.store(now, std::memory_order_release);
+                index = i;
+                return now;
+            }
+        }
+        throw std::string("broadcast_ring: too many readers");
+    }
+
+    void unsubscribe(size_t index)
+    {
+        cursors[index].seq.store(FREE, std::memory_order_release);
+    }
+
+    /// @brief slowest reader, the current end if there are none
+    uint64_t min_cursor() const
+    {
+        uint64_t m = FREE;
+        for(size_t i = 0; i < cursors.size(); ++i)
+        {
+            uint64_t const s = cursors[i].seq.load(std::memory_order_acquire);
+            if(s < m)
+            { m = s; }
+        }
+        return m == FREE ? published.load(std::memory_order_relaxed) : m;
+    }
+
+    /// @brief is there a slot nobody is reading, only the writer
+    bool has_room()
+    {
+        if(Mode == BROADCAST_LOSSY)
+        {
+            return true;
+        }
+
+        uint64_t const s = published.load(std::memory_order_relaxed);
+        if(s - cached_min >= N)
+        {
+            // pairs with the subscribe, a reader that joins now sees what we publish after this
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            cached_min = min_cursor();
+        }
+        return s - cached_min < N;
+    }
+
+    /// @brief write the entry to the next slot and publish it, has_room has to be checked first
+    template<typename... Args>
+    void construct(Args&&... args)
+    {
+        uint64_t const s = published.load(std::memory_order_relaxed);
+        slot &sl = slots[s & MASK];
+
+        if constexpr(Mode == BROADCAST_LOSSY)
+        {
+            // readers copying the old entry see the stamp change and throw the copy away
+            T const tmp(std::forward<Args>(args)...);
+            uintptr_t words[lossy_slot::WORDS] = {};
+            std::memcpy(words, &tmp, sizeof(T));
+
+            sl.stamp.store(WRITING, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for(size_t i = 0; i < lossy_slot::WORDS; ++i)
+            {
+                sl.words[i].store(words[i], std::memory_order_relaxed);
+            }
+            sl.stamp.store(s + 1, std::memory_order_release);
+        }
+        else
+        {
+            // every reader has passed the old entry
+            if(s >= N)
+            { sl.data()->~T(); }
+            new (sl.storage) T(std::forward<Args>(args)...);
+        }
+
+        published.store(s + 1, std::memory_order_release);
+        waiter.notify();
+    }
+
+    /// @brief copy entry seq out of the ring, only lossy mode
+    /// @return false if it was overwritten during the copy
+    bool read_slot(uint64_t seq, unsigned char *out) const
+    {
+        slot const &sl = slots[seq & MASK];
+        if(sl.stamp.load(std::memory_order_acquire) != seq + 1)
+        { return false; }
+
+        uintptr_t words[lossy_slot::WORDS];
+        for(size_t i = 0; i < lossy_slot::WORDS; ++i)
+        {
+            words[i] = sl.words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(sl.stamp.load(std::memory_order_relaxed) != seq + 1)
+        { return false; }
+
+        std::memcpy(out, words, sizeof(T));
+        return true;
+    }
+
+    // leading pad so the writer line isn't shared with whatever is before us
+    char pad0[CACHE_LINE_SIZE];
+
+    // writer side: next sequence to write, read by every reader
+    std::atomic<uint64_t> published;
+    uint64_t cached_min;
+    char pad1[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>) - sizeof(uint64_t)];
+
+    slot *slots;
+    // one cache line for each reader
+    std::vector<cursor> cursors;
+    Wait waiter;
+};
+
+#endif  // BROADCAST_RING_HPP
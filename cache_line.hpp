@@ -0,0 +1,19 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file cache_line.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef CACHE_LINE_HPP
+#define CACHE_LINE_HPP
+
+#include <cstddef>
+
+/// Size of a cache line on the machines we care about (x86-64 and most ARMs)
+/// Used for padding data that is written by different threads so that the
+/// writes don't bounce the same cache line between cores (false sharing).
+const size_t CACHE_LINE_SIZE = 64;
+
+#endif  // CACHE_LINE_HPP
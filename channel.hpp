@@ -0,0 +1,127 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file channel.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef CHANNEL_HPP
+#define CHANNEL_HPP
+
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "time.hpp"
+
+/// @brief combine lambdas into a single overload set for std::visit
+template<typename... Fs>
+struct overloaded : Fs...
+{
+    using Fs::operator()...;
+};
+
+template<typename... Fs>
+overloaded(Fs...) -> overloaded<Fs...>;
+
+/// @brief true if T is one of Ts
+template<typename T, typename... Ts>
+struct is_one_of : std::disjunction<std::is_same<T, Ts>...>
+{};
+
+/** @class channel
+ *  @desc Typed message queue
+ *  Every message type is its own struct, the channel stores them as a std::variant so
+ *  a slot is as large as the largest message and small control messages don't need to
+ *  carry space for a payload. Sending a type that isn't in the list doesn't compile.
+ *
+ *  The reader passes one handler per message type (lambdas, overloaded with overloaded)
+ *  and a message the handlers don't cover is a compile error. No virtual calls,
+ *  std::visit is a jump table and the handler bodies can be inlined into the reader loop.
+ *
+ *  Queue is the underlying queue template (fifo, ring_fifo, mpsc_fifo, socket_fifo, via an
+ *  alias that fixes the other parameters), the threading rules are the ones of the queue.
+ *  Constructor arguments are passed to the queue.
+ *
+ *      channel<inbox_t, BatchMsg, ExitMsg> chan;
+ *      chan.send(ExitMsg());
+ *      chan.dispatch_all([](BatchMsg &m) { ... }, [](ExitMsg &) { ... });
+*/
+template<template<typename> class Queue, typename... Msgs>
+class channel
+{
+public:
+    typedef std::variant<Msgs...> message_type;
+
+    /// @brief Constructor
+    /// @param args passed to the queue, for queues that need them (socket_fifo takes the socket)
+    template<typename... Args>
+    explicit channel(Args&&... args)
+        : queue(std::forward<Args>(args)...)
+    {}
+
+    /// @brief send a message
+    /// @param msg one of Msgs
+    template<typename M>
+    void send(M &&msg)
+    {
+        typedef typename std::decay<M>::type type;
+        static_assert(is_one_of<type, Msgs...>::value, "message type is not part of this channel");
+        queue.emplace(std::in_place_type<type>, std::forward<M>(msg));
+    }
+
+    /// @brief construct a message in place
+    /// @param args arguments for the constructor of M
+    template<typename M, typename... Args>
+    void emplace(Args&&... args)
+    {
+        static_assert(is_one_of<M, Msgs...>::value, "message type is not part of this channel");
+        queue.emplace(std::in_place_type<M>, std::forward<Args>(args)...);
+    }
+
+    /// @brief send what the queue has batched, only for queues that batch (socket_fifo)
+    void flush()
+    {
+        queue.flush();
+    }
+
+    /// @brief call the matching handler for the front message if there is one
+    /// @param handlers one callable per message type, called with a reference to the message
+    /// @return true if a message was handled
+    template<typename... Handlers>
+    bool dispatch(Handlers... handlers)
+    {
+        overloaded<Handlers...> h{ handlers... };
+        return queue.consume([&h](message_type &m) { std::visit(h, m); });
+    }
+
+    /// @brief call the matching handler for every message in the channel at the moment
+    /// @param handlers one callable per message type, called with a reference to the message
+    /// @return number of messages handled
+    template<typename... Handlers>
+    size_t dispatch_all(Handlers... handlers)
+    {
+        overloaded<Handlers...> h{ handlers... };
+        return queue.consume_all([&h](message_type &m) { std::visit(h, m); });
+    }
+
+    /// @brief wait until there is a message
+    /// @param timeout how long to wait at most
+    /// @return true if there is a message, false if we timed out
+    bool wait(vl::time const &timeout)
+    {
+        return queue.wait(timeout);
+    }
+
+    /// @brief is the channel empty, only valid from the reader
+    bool empty() const
+    {
+        return queue.empty();
+    }
+
+private:
+    Queue<message_type> queue;
+};
+
+#endif  // CHANNEL_HPP
@@ -23,21 +23,25 @@ vl::chrono::chrono(void )
 vl::chrono::chrono(time const &t)
 {
     reset();
-    _start_time -= t;
+    _start_time -= duration(t);
 }
 
 void
 vl::chrono::reset(void )
-{ _start_time = vl::get_system_time(); }
+{ _start_time = vl::fast_clock::now(); }
 
 vl::time
 vl::chrono::elapsed(void) const
-{ return vl::get_system_time() - _start_time; }
+{ return elapsed_ns().to_time(); }
+
+vl::duration
+vl::chrono::elapsed_ns(void) const
+{ return vl::fast_clock::now() - _start_time; }
 
 /// ----------------------------- stop_chrono --------------------------------
 
 vl::stop_chrono::stop_chrono(void)
-    : _last_time(vl::get_system_time())
+    : _last_time(vl::fast_clock::now())
     , _stopped(false)
 {}
 
@@ -48,7 +52,7 @@ vl::stop_chrono::resume(void)
     if(_stopped)
     {
         _stopped = false;
-        _last_time = vl::get_system_time();
+        _last_time = vl::fast_clock::now();
     }
 }
 
@@ -59,7 +63,7 @@ vl::stop_chrono::stop(void)
     if(!_stopped)
     {
         _stopped = true;
-        _elapsed += vl::get_system_time() - _last_time;
+        _elapsed += vl::fast_clock::now() - _last_time;
         // No need to update last time as resume will do it
     }
 }
@@ -67,19 +71,25 @@ vl::stop_chrono::stop(void)
 void
 vl::stop_chrono::reset(void)
 {
-    _elapsed = vl::time();
-    _last_time = vl::get_system_time();
+    _elapsed = vl::duration();
+    _last_time = vl::fast_clock::now();
     _stopped = false;
 }
 
 vl::time
 vl::stop_chrono::elapsed(void) const
 {
-    vl::time elapsed = _elapsed;
+    return elapsed_ns().to_time();
+}
+
+vl::duration
+vl::stop_chrono::elapsed_ns(void) const
+{
+    vl::duration elapsed = _elapsed;
     // If the clock is not stopped we need to account for the time since resume
     if(!_stopped)
     {
-        elapsed += vl::get_system_time()-_last_time;
+        elapsed += vl::fast_clock::now() - _last_time;
     }
 
     return elapsed;
@@ -33,6 +33,7 @@
 #define HYDRA_BASE_CHRONO_HPP
 
 #include "time.hpp"
+#include "nanotime.hpp"
 
 
 namespace vl
@@ -57,8 +58,11 @@ public :
     /// @return time between last call to reset and now
     time elapsed(void) const;
 
+    /// @brief time elapsed since last reset in nanoseconds
+    duration elapsed_ns(void) const;
+
 private:
-    time _start_time;   // A point in time
+    time_point _start_time;   // A point in time
 
 };
 
@@ -82,12 +86,15 @@ public :
     /// @brief time elapsed since last reset accounting for the stopping
     time elapsed(void) const;
 
+    /// @brief time elapsed since last reset accounting for the stopping in nanoseconds
+    duration elapsed_ns(void) const;
+
 private :
-    time _elapsed;
-    time _last_time;
+    duration _elapsed;
+    time_point _last_time;
     bool _stopped;
 };
 
 }   // namespace vl
 
-#endif HYDRA_BASE_CHRONO_HPP
+#endif  // HYDRA_BASE_CHRONO_HPP
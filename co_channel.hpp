@@ -0,0 +1,441 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file co_channel.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef CO_CHANNEL_HPP
+#define CO_CHANNEL_HPP
+
+// C++20, only the targets that include this are built with it
+#if __cplusplus < 202002L
+#error "co_channel.hpp needs C++20 coroutines"
+#endif
+
+#include <cassert>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "mpsc_fifo.hpp"
+#include "wait.hpp"
+
+class co_executor;
+
+/** @class co_task
+ *  @desc A coroutine run by co_executor
+ *  Starts suspended, spawn hands it to an executor that resumes it and destroys it when
+ *  it finishes. An exception that escapes the coroutine comes out of co_executor::run.
+ *
+ *      co_task consumer(co_channel<int> &in)
+ *      {
+ *          while(std::optional<int> v = co_await in.pop()) { ... }
+ *      }
+*/
+class co_task
+{
+public:
+    struct promise_type
+    {
+        promise_type()
+            : slot(0)
+        {}
+
+        co_task get_return_object()
+        {
+            return co_task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        // the executor sees done() after resume and destroys it
+        std::suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void()
+        {}
+
+        void unhandled_exception()
+        {
+            error = std::current_exception();
+        }
+
+        std::exception_ptr error;
+        /// where the executor keeps us
+        size_t slot;
+    };
+
+    typedef std::coroutine_handle<promise_type> handle;
+
+    co_task(co_task &&other) noexcept
+        : coro(std::exchange(other.coro, nullptr))
+    {}
+
+    /// Destructor, a task that was never spawned is destroyed with it
+    ~co_task()
+    {
+        if(coro)
+        { coro.destroy(); }
+    }
+
+private:
+    friend class co_executor;
+
+    explicit co_task(handle h)
+        : coro(h)
+    {}
+
+    // not copyable, owns the coroutine until it's spawned
+    co_task(co_task const &);
+    co_task &operator=(co_task const &);
+
+    handle coro;
+};
+
+/** @class co_executor
+ *  @desc Single threaded executor for co_tasks
+ *  Keeps a list of coroutines that are ready to continue and resumes them in order.
+ *  A coroutine waiting on a co_channel isn't in the list, the channel puts it back when
+ *  data or room arrives, so thousands of waiting tasks cost nothing but their frames.
+ *
+ *  run is called by one thread. Other threads talk to it with post (any thread), when
+ *  nothing is ready the executor sleeps on the post queue (spin_park), it doesn't spin.
+ *  Use one executor per thread to spread tasks over a few threads.
+*/
+class co_executor
+{
+public:
+    co_executor()
+    {}
+
+    /// Destructor, destroys tasks that never finished
+    ~co_executor()
+    {
+        for(size_t i = 0; i < tasks.size(); ++i)
+        {
+            tasks[i].destroy();
+        }
+    }
+
+    /// @brief start a task, from the executor thread or before run
+    void spawn(co_task task)
+    {
+        co_task::handle h = std::exchange(task.coro, nullptr);
+        h.promise().slot = tasks.size();
+        tasks.push_back(h);
+        ready.push_back(h);
+    }
+
+    /// @brief continue a suspended coroutine on the next round, only the executor thread
+    void schedule(std::coroutine_handle<> h)
+    {
+        ready.push_back(h);
+    }
+
+    /// @brief run f on the executor thread, from any thread
+    /// Wakes the executor if it's sleeping.
+    void post(std::function<void()> f)
+    {
+        inbox.push(std::move(f));
+    }
+
+    /// @brief resume everything that's ready and run the posted functions, doesn't wait
+    /// @return number of coroutines resumed
+    /// @throws whatever a task let escape, the task is gone then
+    size_t poll()
+    {
+        inbox.consume_all([](std::function<void()> &f) { f(); });
+
+        // the ones that become ready while we run go to the next round
+        size_t const n = ready.size();
+        for(size_t i = 0; i < n; ++i)
+        {
+            std::coroutine_handle<> h = ready.front();
+            ready.pop_front();
+            resume(h);
+        }
+        return n;
+    }
+
+    /// @brief run until every spawned task has finished
+    /// Sleeps on the post queue while nothing is ready, tasks waiting for other threads
+    /// are woken by their posts.
+    void run()
+    {
+        while(!tasks.empty())
+        {
+            if(ready.empty())
+            {
+                inbox.wait(vl::time(1));
+            }
+            poll();
+        }
+    }
+
+    /// @brief tasks spawned and not finished
+    size_t size() const
+    {
+        return tasks.size();
+    }
+
+private:
+    // not copyable, the channels and coroutines point to us
+    co_executor(co_executor const &);
+    co_executor &operator=(co_executor const &);
+
+    void resume(std::coroutine_handle<> h)
+    {
+        h.resume();
+        if(!h.done())
+        {
+            return;
+        }
+
+        // only co_tasks run here, the handle is one of ours
+        co_task::handle t = co_task::handle::from_address(h.address());
+        std::exception_ptr error = t.promise().error;
+        size_t const slot = t.promise().slot;
+        tasks[slot] = tasks.back();
+        tasks[slot].promise().slot = slot;
+        tasks.pop_back();
+        t.destroy();
+        if(error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    std::vector<co_task::handle> tasks;
+    std::deque<std::coroutine_handle<> > ready;
+    mpsc_fifo<std::function<void()>, spin_park> inbox;
+};
+
+/** @class co_channel
+ *  @desc Bounded channel between coroutines of one executor
+ *  co_await push(x) continues right away if there is room and waits for a pop otherwise,
+ *  co_await pop() waits for a value. A value pushed to a waiting popper goes straight to
+ *  it. After close pop returns an empty optional once the buffer is drained.
+ *
+ *  Not thread safe, every coroutine using it runs on the same executor.
+ *  From another thread use post, it goes through the executor's queue.
+*/
+template<typename T>
+class co_channel
+{
+private:
+    struct pop_awaiter;
+    struct push_awaiter;
+
+public:
+    /// @brief Constructor
+    /// @param exec executor of the coroutines using this
+    /// @param capacity values buffered before push waits, at least 1
+    co_channel(co_executor &exec, size_t capacity)
+        : executor(exec)
+        , limit(capacity == 0 ? 1 : capacity)
+        , is_closed(false)
+    {}
+
+    /// @brief awaitable, the next value or an empty optional if closed and drained
+    pop_awaiter pop()
+    {
+        return pop_awaiter(*this);
+    }
+
+    /// @brief awaitable, waits for room
+    push_awaiter push(T value)
+    {
+        return push_awaiter(*this, std::move(value));
+    }
+
+    /// @brief push without waiting, from the executor thread
+    /// @return false if the channel is full or closed
+    bool try_push(T value)
+    {
+        if(is_closed || (poppers.empty() && buffer.size() >= limit))
+        {
+            return false;
+        }
+        deliver(std::move(value));
+        return true;
+    }
+
+    /// @brief pop without waiting, from the executor thread
+    bool try_pop(T &value)
+    {
+        if(buffer.empty())
+        {
+            return false;
+        }
+        value = std::move(buffer.front());
+        buffer.pop_front();
+        refill();
+        return true;
+    }
+
+    /// @brief push from any thread, goes through the executor and doesn't wait
+    /// Over the capacity if it has to, keep the other thread in check with flow control.
+    void post(T value)
+    {
+        executor.post([this, v = std::move(value)]() mutable
+        {
+            if(!is_closed)
+            { deliver(std::move(v)); }
+        });
+    }
+
+    /// @brief no more pushes, waiting poppers get an empty optional, waiting pushers are dropped
+    void close()
+    {
+        is_closed = true;
+        while(!poppers.empty())
+        {
+            executor.schedule(poppers.front()->waiter);
+            poppers.pop_front();
+        }
+        while(!pushers.empty())
+        {
+            pushers.front()->accepted = false;
+            executor.schedule(pushers.front()->waiter);
+            pushers.pop_front();
+        }
+    }
+
+    bool closed() const
+    {
+        return is_closed;
+    }
+
+    /// @brief values buffered
+    size_t size() const
+    {
+        return buffer.size();
+    }
+
+private:
+    // not copyable, awaiters point to us
+    co_channel(co_channel const &);
+    co_channel &operator=(co_channel const &);
+
+    struct pop_awaiter
+    {
+        explicit pop_awaiter(co_channel &c)
+            : chan(c)
+        {}
+
+        bool await_ready()
+        {
+            if(!chan.buffer.empty())
+            {
+                result = std::move(chan.buffer.front());
+                chan.buffer.pop_front();
+                chan.refill();
+                return true;
+            }
+            return chan.is_closed;
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            waiter = h;
+            chan.poppers.push_back(this);
+        }
+
+        std::optional<T> await_resume()
+        {
+            return std::move(result);
+        }
+
+        co_channel &chan;
+        std::coroutine_handle<> waiter;
+        std::optional<T> result;
+    };
+
+    struct push_awaiter
+    {
+        push_awaiter(co_channel &c, T v)
+            : chan(c)
+            , value(std::move(v))
+            , accepted(true)
+        {}
+
+        bool await_ready()
+        {
+            if(chan.is_closed)
+            {
+                accepted = false;
+                return true;
+            }
+            if(!chan.poppers.empty() || chan.buffer.size() < chan.limit)
+            {
+                chan.deliver(std::move(value));
+                return true;
+            }
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            waiter = h;
+            chan.pushers.push_back(this);
+        }
+
+        /// @return false if the channel was closed and the value dropped
+        bool await_resume()
+        {
+            return accepted;
+        }
+
+        co_channel &chan;
+        T value;
+        std::coroutine_handle<> waiter;
+        bool accepted;
+    };
+
+    /// @brief to a waiting popper or to the buffer
+    void deliver(T &&value)
+    {
+        if(!poppers.empty())
+        {
+            pop_awaiter *p = poppers.front();
+            poppers.pop_front();
+            p->result.emplace(std::move(value));
+            executor.schedule(p->waiter);
+            return;
+        }
+        buffer.push_back(std::move(value));
+    }
+
+    /// @brief there is room, take the value of the first waiting pusher
+    void refill()
+    {
+        if(!pushers.empty() && buffer.size() < limit)
+        {
+            push_awaiter *p = pushers.front();
+            pushers.pop_front();
+            buffer.push_back(std::move(p->value));
+            executor.schedule(p->waiter);
+        }
+    }
+
+    co_executor &executor;
+    size_t limit;
+    bool is_closed;
+    std::deque<T> buffer;
+    // suspended coroutines, the awaiters live in their frames
+    std::deque<pop_awaiter *> poppers;
+    std::deque<push_awaiter *> pushers;
+};
+
+#endif  // CO_CHANNEL_HPP
@@ -0,0 +1,154 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file core_latency.cpp
+*
+*   Under a copyleft.
+*/
+
+// Round trip latency through a pair of fifos for every pair of CPUs.
+// One thread is pinned to the row CPU and sends, an echo thread is pinned to the column CPU.
+// Shows what a queue hop costs between SMT siblings, cores sharing a cache and packages.
+//
+// Params {EXE} {N_ROUND_TRIPS} {FORMAT}
+// N_ROUND_TRIPS per pair, the median is reported
+// FORMAT table (default) or csv
+
+#include "fifo.hpp"
+#include "nanotime.hpp"
+#include "topology.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// both threads have a core of their own, busy spinning is the lowest latency
+typedef fifo<size_t, busy_spin> queue_t;
+
+const vl::time TIMEOUT(1);
+/// round trips thrown away before measuring, the queues allocate their nodes during these
+const size_t WARMUP = 1000;
+
+/// @brief median round trip in nanoseconds between two CPUs, -1 if it didn't finish
+double measure(int from, int to, size_t n)
+{
+    queue_t ping;
+    queue_t pong;
+    size_t const total = WARMUP + n;
+
+    std::thread echo([&ping, &pong, to, total]()
+    {
+        pin_this_thread(to);
+        for(size_t i = 0; i < total; ++i)
+        {
+            size_t v = 0;
+            if(!ping.pop_wait(v, TIMEOUT))
+            { return; }
+            pong.push(v);
+        }
+    });
+
+    std::vector<double> rtt;
+    rtt.reserve(n);
+    std::thread sender([&ping, &pong, &rtt, from, total]()
+    {
+        pin_this_thread(from);
+        for(size_t i = 0; i < total; ++i)
+        {
+            auto start = vl::fast_clock::now();
+            ping.push(i);
+            size_t v = 0;
+            if(!pong.pop_wait(v, TIMEOUT))
+            { return; }
+            if(i >= WARMUP)
+            { rtt.push_back(double((vl::fast_clock::now() - start).count())); }
+        }
+    });
+
+    sender.join();
+    echo.join();
+
+    if(rtt.size() != n || rtt.empty())
+    { return -1; }
+    std::nth_element(rtt.begin(), rtt.begin() + rtt.size()/2, rtt.end());
+    return rtt[rtt.size()/2];
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = 10000;
+    std::string format = "table";
+
+    if(argc > 1)
+    {
+        n = std::atoi(argv[1]);
+    }
+    if(argc > 2)
+    {
+        format = argv[2];
+    }
+
+    cpu_topology topo = cpu_topology::detect();
+    std::clog << "Topology: " << topo << std::endl;
+    if(topo.size() < 2)
+    {
+        std::clog << "Need at least two cpus." << std::endl;
+        return 1;
+    }
+
+    // matrix[i][j] from cpu i to cpu j
+    std::vector<std::vector<double> > matrix(topo.size(), std::vector<double>(topo.size(), 0));
+    for(size_t i = 0; i < topo.size(); ++i)
+    {
+        for(size_t j = 0; j < topo.size(); ++j)
+        {
+            if(i != j)
+            { matrix[i][j] = measure(topo[i].cpu, topo[j].cpu, n); }
+        }
+        std::clog << "cpu " << topo[i].cpu << " done" << std::endl;
+    }
+
+    if(format == "csv")
+    {
+        std::cout << "from,to,from_core,to_core,from_package,to_package,from_node,to_node,rtt_p50_ns" << std::endl;
+        for(size_t i = 0; i < topo.size(); ++i)
+        {
+            for(size_t j = 0; j < topo.size(); ++j)
+            {
+                if(i == j)
+                { continue; }
+                std::cout << topo[i].cpu << "," << topo[j].cpu << ","
+                    << topo[i].core << "," << topo[j].core << ","
+                    << topo[i].package << "," << topo[j].package << ","
+                    << topo[i].node << "," << topo[j].node << "," << matrix[i][j] << std::endl;
+            }
+        }
+        return 0;
+    }
+
+    // rows send, columns echo, median round trip in ns
+    std::cout << std::setw(6) << "cpu";
+    for(size_t j = 0; j < topo.size(); ++j)
+    {
+        std::cout << std::setw(8) << topo[j].cpu;
+    }
+    std::cout << std::endl;
+    for(size_t i = 0; i < topo.size(); ++i)
+    {
+        std::cout << std::setw(6) << topo[i].cpu;
+        for(size_t j = 0; j < topo.size(); ++j)
+        {
+            if(i == j)
+            { std::cout << std::setw(8) << "-"; }
+            else
+            { std::cout << std::setw(8) << std::fixed << std::setprecision(0) << matrix[i][j]; }
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
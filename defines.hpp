@@ -13,11 +13,19 @@
 
 /// How many threads
 const size_t N_THREADS = 2;
-/// How many elements in a single batch (message)
+/// Default for how many elements in a single batch (message), can be changed from the command line
+/// messages are sized by their content so this doesn't limit anything
 const size_t BATCH_SIZE = 1024;
 /// How many batches do we run
 const size_t N_RUNS = 20;
-/// Artificial slow in the prime calculation function (in milliseconds)
+/// Artificial slow in the prime calculation function (in milliseconds, fractions are fine)
 const double DELAY = 1;
+/// What kind of work the delay does (see workload.hpp)
+const char *const WORKLOAD = "alu";
+/// Where the threads run: none, compact, scatter or nosmt (see topology.hpp)
+const char *const PLACEMENT = "none";
+/// Batches queued per worker at most, the main thread spills to another worker or waits
+/// when they are all full (0 for no limit)
+const size_t QUEUE_CAPACITY = 8;
 
 #endif  // DEFINES_HPP
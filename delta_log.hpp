@@ -0,0 +1,202 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file delta_log.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef DELTA_LOG_HPP
+#define DELTA_LOG_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/// What a consumer needs to catch up
+template<typename Delta, typename Snapshot>
+struct delta_batch
+{
+    delta_batch()
+        : has_snapshot(false)
+        , first(0)
+    {}
+
+    /// state after every delta before first, only if the consumer was too far behind
+    bool has_snapshot;
+    Snapshot snapshot;
+    /// sequence of deltas[0]
+    uint64_t first;
+    /// in order, contiguous up to the newest delta
+    std::vector<Delta> deltas;
+
+    /// @brief sequence after the last delta, where the consumer is after applying this
+    uint64_t end() const
+    {
+        return first + deltas.size();
+    }
+};
+
+/** @class delta_log
+ *  @desc Sequence numbered log of state changes kept by the producer
+ *  Every delta the producer sends gets the next sequence number (from 0) and is kept here.
+ *  A consumer that missed updates (fell behind on a lossy queue, restarted, joined late)
+ *  asks for everything since the first sequence it doesn't have and gets it as one batch,
+ *  instead of stalling the producer or rebuilding its state from scratch.
+ *
+ *  Only the newest deltas are kept. When retention deltas are in the log the oldest half is
+ *  folded into a snapshot with the compaction hook, fold(snapshot, delta) applies one delta
+ *  to it. A consumer asking for something older than that gets the snapshot and the deltas
+ *  after it.
+ *
+ *  Not thread safe, it belongs to the producer. Consumers ask for catch ups with messages
+ *  and the producer answers with the batch (see test_delta_log.cpp).
+*/
+template<typename Delta, typename Snapshot>
+class delta_log
+{
+public:
+    typedef std::function<void(Snapshot &, Delta const &)> fold_function;
+
+    /// What a consumer gets to catch up
+    typedef delta_batch<Delta, Snapshot> batch;
+
+    /// @brief Constructor
+    /// @param retention how many deltas to keep at most before compacting, at least 2
+    /// @param initial state before the first delta
+    /// @param fold compaction hook, applies a delta to the snapshot
+    delta_log(size_t retention, Snapshot const &initial, fold_function fold)
+        : limit(retention < 2 ? 2 : retention)
+        , base(initial)
+        , base_seq(0)
+        , fold_delta(fold)
+        , n_compactions(0)
+    {
+        deltas.reserve(limit);
+    }
+
+    /// @brief add the next delta, compacts when the retention limit is reached
+    /// @return sequence number of the delta
+    uint64_t append(Delta const &d)
+    {
+        if(deltas.size() >= limit)
+        {
+            compact(limit/2);
+        }
+        deltas.push_back(d);
+        return next_seq() - 1;
+    }
+
+    /// @brief everything a consumer that has applied all deltas before seq needs
+    /// @param seq first sequence the consumer doesn't have
+    /// @return the deltas from seq on, with the snapshot first if seq was compacted already
+    /// @throws std::string if seq is in the future
+    batch since(uint64_t seq) const
+    {
+        if(seq > next_seq())
+        {
+            throw std::string("delta_log: sequence from the future");
+        }
+
+        batch b;
+        if(seq < base_seq)
+        {
+            b.has_snapshot = true;
+            b.snapshot = base;
+            seq = base_seq;
+        }
+        b.first = seq;
+        b.deltas.assign(deltas.begin() + size_t(seq - base_seq), deltas.end());
+        return b;
+    }
+
+    /// @brief fold the oldest deltas into the snapshot, keeping the newest keep
+    void compact(size_t keep)
+    {
+        if(deltas.size() <= keep)
+        { return; }
+
+        size_t const n = deltas.size() - keep;
+        for(size_t i = 0; i < n; ++i)
+        {
+            fold_delta(base, deltas[i]);
+        }
+        deltas.erase(deltas.begin(), deltas.begin() + n);
+        base_seq += n;
+        ++n_compactions;
+    }
+
+    /// @brief sequence the next delta gets
+    uint64_t next_seq() const
+    {
+        return base_seq + deltas.size();
+    }
+
+    /// @brief oldest sequence still in the log, older ones are in the snapshot
+    uint64_t first_seq() const
+    {
+        return base_seq;
+    }
+
+    /// @brief state after every delta before first_seq
+    Snapshot const &snapshot() const
+    {
+        return base;
+    }
+
+    /// @brief deltas in the log
+    size_t size() const
+    {
+        return deltas.size();
+    }
+
+    /// @brief how many times deltas were folded into the snapshot
+    size_t compactions() const
+    {
+        return n_compactions;
+    }
+
+private:
+    // not copyable, could be large
+    delta_log(delta_log const &);
+    delta_log &operator=(delta_log const &);
+
+    size_t limit;
+    Snapshot base;
+    uint64_t base_seq;
+    std::vector<Delta> deltas;
+    fold_function fold_delta;
+    size_t n_compactions;
+};
+
+/// @brief bring a consumer up to date with a batch from delta_log::since
+/// Deltas it already has (the batch can overlap with what came in on the live queue) are skipped.
+/// @param b the batch
+/// @param state consumer state, replaced by the snapshot if the batch has one
+/// @param applied sequence of the first delta the consumer doesn't have
+/// @param apply called with (state, delta) for every new delta in order
+/// @return the new applied sequence
+template<typename Delta, typename Snapshot, typename Apply>
+uint64_t apply_batch(delta_batch<Delta, Snapshot> const &b, Snapshot &state,
+        uint64_t applied, Apply apply)
+{
+    if(b.has_snapshot && applied < b.first)
+    {
+        state = b.snapshot;
+        applied = b.first;
+    }
+    // without a snapshot a gap before the batch can't be filled, leave the state as it is
+    if(applied < b.first)
+    {
+        return applied;
+    }
+    for(uint64_t s = applied; s < b.end(); ++s)
+    {
+        apply(state, b.deltas[size_t(s - b.first)]);
+    }
+    return b.end() > applied ? b.end() : applied;
+}
+
+#endif  // DELTA_LOG_HPP
@@ -11,6 +11,12 @@
 
 #include <atomic>
 #include <cassert>
+#include <string>
+#include <new>
+#include <utility>
+
+#include "wait.hpp"
+#include "fifo_stats.hpp"
 
 /** @class fifo
  *  @desc Non locking thread safe queue (first in, first out buffer)
@@ -20,31 +26,45 @@
  *  Non locking is implemented by having one thread read from one end and other one push to the other
  *  we use a pointer between these two to mark the read point.
  *  The read pointer is atomic since it is accessed by both push and pop.
+ *
+ *  Nodes consumed by the reader are not deleted, the writer moves them to a private free list
+ *  and reuses them on push. Once the list has grown to the working size of the queue
+ *  push and pop don't allocate. Use reserve to fill the list up front.
+ *
+ *  Elements are constructed in place in the node by push/emplace and destroyed by the reader
+ *  when it's done with them, so the element type doesn't need a default constructor and
+ *  large elements can be moved in and out (or used in place with consume) instead of copied.
+ *
+ *  Wait is the strategy pop_wait uses when the buffer is empty (see wait.hpp).
+ *
+ *  With FIFO_STATS defined the queue counts pushes, pops, empty polls, the high water
+ *  depth and the time spent reclaiming nodes, read them with stats (see fifo_stats.hpp).
 */
-template<typename T>
+template<typename T, typename Wait = busy_spin>
 class fifo
 {
 private:
     /// Linked list structure
+    /// data is only alive between push and the reader passing the node
     struct node
     {
-        node(T d)
-            : data(d)
-            , next(nullptr)
-        {}
-
         node()
-            : data()
-            , next(nullptr)
+            : next(nullptr)
         {}
 
-        T data;
-        node *next;
+        T *data()
+        { return reinterpret_cast<T *>(storage); }
+
+        alignas(T) unsigned char storage[sizeof(T)];
+        // written by push and read by pop, so atomic to publish the data with it
+        std::atomic<node *> next;
     };
 
 public:
     /// Constructor
     fifo()
+        : free_list(nullptr)
+        , free_count(0)
     {
         // on purpose a single statement, they all point to the same object
         front = back = divider = new node;
@@ -53,34 +73,112 @@ public:
     /// Destructor
     ~fifo()
     {
-        while(front != nullptr)
+        // elements the reader never got to
+        node *d = divider.load(std::memory_order_relaxed);
+        for(node *n = d->next.load(std::memory_order_relaxed); n != nullptr; n = n->next.load(std::memory_order_relaxed))
         {
-            node *tmp = front;
-            front = tmp->next;
-            delete tmp;
+            n->data()->~T();
         }
+
+        delete_list(front);
+        delete_list(free_list);
     }
 
     /// @brief push data to back
     /// @param data element to push
-    /// @throws never
-    void push(T data)
+    /// @throws only if copying data throws
+    void push(T const &data)
+    {
+        emplace(data);
+    }
+
+    /// @brief push data to back
+    /// @param data element to move into the buffer
+    /// @throws only if moving data throws
+    void push(T &&data)
+    {
+        emplace(std::move(data));
+    }
+
+    /// @brief construct an element in place at the back
+    /// @param args arguments passed to the constructor of T
+    /// @throws only if the constructor throws, the buffer is left unchanged
+    template<typename... Args>
+    void emplace(Args&&... args)
     {
         assert(front != nullptr);
         assert(divider.load() != nullptr);
         assert(back != nullptr);
 
-        back->next = new node(data);
-        back = back->next;
+        node *n = get_node();
+        try
+        {
+            new (n->data()) T(std::forward<Args>(args)...);
+        }
+        catch(...)
+        {
+            put_node(n);
+            throw;
+        }
+        n->next.store(nullptr, std::memory_order_relaxed);
+        back->next.store(n, std::memory_order_release);
+        back = n;
+        waiter.notify();
+        wstats.pushed(1);
 
         // lazy delete, we don't modify divider here
         // and pop doesn't modify front so we are all good
-        while (front != divider.load())
+        reclaim();
+    }
+
+    /// @brief push n elements to back with a single publish for all of them
+    /// The reader sees either none or all of the elements.
+    /// @param first iterator to the first element
+    /// @param n how many elements to push
+    /// @throws only if copying an element throws, the buffer is left unchanged
+    template<typename InputIt>
+    void push_n(InputIt first, size_t n)
+    {
+        if(n == 0)
+        { return; }
+
+        // link a private chain first, the reader can't see it yet
+        node *head = nullptr;
+        node *tail = nullptr;
+        try
         {
-            node *tmp = front;
-            front = tmp->next;
-            delete tmp;
+            for(size_t i = 0; i < n; ++i, ++first)
+            {
+                node *tmp = get_node();
+                tmp->next.store(nullptr, std::memory_order_relaxed);
+                if(tail == nullptr)
+                { head = tmp; }
+                else
+                { tail->next.store(tmp, std::memory_order_relaxed); }
+                tail = tmp;
+                new (tmp->data()) T(*first);
+            }
+        }
+        catch(...)
+        {
+            // the last node doesn't have an element yet
+            while(head != tail)
+            {
+                node *tmp = head;
+                head = tmp->next.load(std::memory_order_relaxed);
+                tmp->data()->~T();
+                put_node(tmp);
+            }
+            put_node(tail);
+            throw;
         }
+
+        back->next.store(head, std::memory_order_release);
+        back = tail;
+        waiter.notify();
+        wstats.pushed(n);
+
+        reclaim();
     }
 
     /// @brief pop data from front
@@ -90,15 +188,76 @@ public:
     {
         if(empty())
         {
+            rstats.popped(0);
             throw std::string("empty");
         }
 
         // We can't delete here (it's the responsibility of the pusher)
         // so we just move the divider
-        node *tmp = divider.load()->next;
+        node *tmp = divider.load(std::memory_order_relaxed)->next.load(std::memory_order_acquire);
         assert(tmp != nullptr);
-        divider.store(tmp);
-        return tmp->data;
+        T data(std::move(*tmp->data()));
+        tmp->data()->~T();
+        divider.store(tmp, std::memory_order_release);
+        rstats.popped(1);
+        return data;
+    }
+
+    /// @brief pop data from front if there is any
+    /// @param data OUT the popped element is moved here
+    /// @return true if an element was popped, false if the buffer was empty
+    /// @throws only if moving the element throws
+    bool try_pop(T &data)
+    {
+        return consume_n([&data](T &elem) { data = std::move(elem); }, 1) == 1;
+    }
+
+    /// @brief use the front element in place and pop it
+    /// Avoids copying large elements out of the buffer.
+    /// @param f functor called with a reference to the element, must not throw
+    /// @return true if an element was consumed, false if the buffer was empty
+    template<typename F>
+    bool consume(F f)
+    {
+        return consume_n(f, 1) == 1;
+    }
+
+    /// @brief pop up to max elements, the divider is moved once for all of them
+    /// @param out output iterator the elements are moved to
+    /// @param max maximum number of elements to pop
+    /// @return number of elements popped
+    template<typename OutputIt>
+    size_t pop_n(OutputIt out, size_t max)
+    {
+        return consume_n([&out](T &data) { *out = std::move(data); ++out; }, max);
+    }
+
+    /// @brief call f for every element that is in the buffer at the moment
+    /// The divider is moved once at the end so f must not throw.
+    /// @param f functor called with a reference to every element in order
+    /// @return number of elements consumed
+    template<typename F>
+    size_t consume_all(F f)
+    {
+        return consume_n(f, size_t(-1));
+    }
+
+    /// @brief wait until there is data to read
+    /// @param timeout how long to wait at most
+    /// @return true if there is data, false if we timed out
+    bool wait(vl::time const &timeout)
+    {
+        return waiter.wait([this]() { return !empty(); }, timeout);
+    }
+
+    /// @brief pop data from front, waits for data if the buffer is empty
+    /// @param data OUT the popped element is moved here
+    /// @param timeout how long to wait at most
+    /// @return true if an element was popped, false if we timed out
+    /// @throws only if moving the element throws
+    bool pop_wait(T &data, vl::time const &timeout)
+    {
+        return wait(timeout) && try_pop(data);
     }
 
     /// @brief is this buffer empty
@@ -106,14 +265,126 @@ public:
     bool empty() const
     {
         assert(divider.load() != nullptr);
-        return divider.load()->next == nullptr;
+        return divider.load(std::memory_order_relaxed)->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+    /// @brief make sure there are at least n free nodes, only call from the writer
+    /// @param n how many elements we can push without allocating
+    void reserve(size_t n)
+    {
+        reclaim();
+        while(free_count < n)
+        {
+            put_node(new node);
+        }
+    }
+
+    /// @brief how many free nodes the writer has, only call from the writer
+    size_t pool_size() const
+    {
+        return free_count;
+    }
+
+    /// @brief snapshot of the counters, any thread
+    /// All zeros unless FIFO_STATS is defined. The counters are read one at a time
+    /// while the queue is running so they can be a few operations apart.
+    fifo_stats stats() const
+    {
+        return make_fifo_stats(wstats, rstats);
     }
 
 private:
+    // not copyable, the nodes are shared with another thread
+    fifo(fifo const &);
+    fifo &operator=(fifo const &);
+
+    /// @brief call f for up to max elements and publish the new divider once
+    /// The elements are destroyed after f, the passed nodes are left for the writer to reclaim.
+    template<typename F>
+    size_t consume_n(F f, size_t max)
+    {
+        node *d = divider.load(std::memory_order_relaxed);
+        size_t count = 0;
+        while(count < max)
+        {
+            node *tmp = d->next.load(std::memory_order_acquire);
+            if(tmp == nullptr)
+            { break; }
+
+            f(*tmp->data());
+            tmp->data()->~T();
+            d = tmp;
+            ++count;
+        }
+
+        if(count > 0)
+        {
+            divider.store(d, std::memory_order_release);
+        }
+        rstats.popped(count);
+        return count;
+    }
+
+    /// @brief take a node from the free list or allocate a new one
+    node *get_node()
+    {
+        if(free_list == nullptr)
+        {
+            return new node;
+        }
+
+        node *n = free_list;
+        free_list = n->next.load(std::memory_order_relaxed);
+        --free_count;
+        return n;
+    }
+
+    /// @brief return a node to the free list
+    void put_node(node *n)
+    {
+        n->next.store(free_list, std::memory_order_relaxed);
+        free_list = n;
+        ++free_count;
+    }
+
+    /// @brief move everything the reader is done with to the free list
+    void reclaim()
+    {
+        // acquire so the reader is done with the data before we overwrite it
+        node *const d = divider.load(std::memory_order_acquire);
+        auto const start = wstats.reclaim_start();
+        size_t n = 0;
+        while (front != d)
+        {
+            node *tmp = front;
+            front = tmp->next.load(std::memory_order_relaxed);
+            put_node(tmp);
+            ++n;
+        }
+        wstats.reclaim_done(n, start);
+    }
+
+    static void delete_list(node *n)
+    {
+        while(n != nullptr)
+        {
+            node *tmp = n;
+            n = tmp->next.load(std::memory_order_relaxed);
+            delete tmp;
+        }
+    }
+
     // divider is accessed by both push and pop so it needs to be thread-safe
     std::atomic< node *> divider;
     node * front;
     node * back;
+    // writer private list of nodes ready for reuse
+    node * free_list;
+    size_t free_count;
+    Wait waiter;
+    // instrumentation, each side on its own cache line when enabled
+    fifo_writer_stats wstats;
+    fifo_reader_stats rstats;
 };
 
 #endif  // FIFO_HPP
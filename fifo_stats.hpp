@@ -0,0 +1,175 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file fifo_stats.hpp
+*
+*   Under a copyleft.
+*/
+
+/*
+ *  Optional instrumentation for fifo, compiled in when FIFO_STATS is defined
+ *  (CMake option FIFO_STATS). Without it the counters are empty and all the calls
+ *  compile to nothing.
+ *
+ *  Every counter has a single writer: the writer side counters live on the writer's
+ *  cache line and the reader side ones on the reader's. Increments are a relaxed load
+ *  and store instead of a locked add, a monitor thread reads them with relaxed loads
+ *  so looking at a queue never stops or slows it down (beyond the reads themselves).
+ */
+
+#ifndef FIFO_STATS_HPP
+#define FIFO_STATS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+#include "cache_line.hpp"
+#include "nanotime.hpp"
+
+/// Snapshot of the counters of a single queue
+struct fifo_stats
+{
+    fifo_stats()
+        : pushes(0)
+        , pops(0)
+        , depth(0)
+        , high_water(0)
+        , empty_polls(0)
+        , reclaim_ns(0)
+    {}
+
+    /// elements pushed
+    uint64_t pushes;
+    /// elements popped or consumed
+    uint64_t pops;
+    /// elements in the queue when the snapshot was taken
+    uint64_t depth;
+    /// largest depth the writer has seen
+    uint64_t high_water;
+    /// reader calls that found the queue empty
+    uint64_t empty_polls;
+    /// time the writer has spent moving used nodes to its free list
+    uint64_t reclaim_ns;
+};
+
+inline std::ostream &operator<<(std::ostream &os, fifo_stats const &s)
+{
+    os << "depth " << s.depth << " (max " << s.high_water << ") : pushes " << s.pushes
+        << " : pops " << s.pops << " : empty polls " << s.empty_polls
+        << " : reclaim " << s.reclaim_ns << "ns";
+    return os;
+}
+
+#ifdef FIFO_STATS
+
+/// @brief add to a counter that only one thread writes
+inline void stats_add(std::atomic<uint64_t> &counter, uint64_t n)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+/// Counters only the writer updates
+struct alignas(CACHE_LINE_SIZE) fifo_writer_stats
+{
+    fifo_writer_stats()
+        : pushes(0)
+        , reclaimed(0)
+        , high_water(0)
+        , reclaim_ns(0)
+    {}
+
+    void pushed(uint64_t n)
+    {
+        stats_add(pushes, n);
+    }
+
+    vl::time_point reclaim_start() const
+    {
+        return vl::fast_clock::now();
+    }
+
+    /// @brief the writer has reclaimed n nodes
+    /// Every reclaimed node has been popped so after a reclaim pushes - reclaimed is the
+    /// depth as of the divider the writer just read, no need to touch the reader's counters.
+    void reclaim_done(uint64_t n, vl::time_point start)
+    {
+        if(n > 0)
+        {
+            stats_add(reclaimed, n);
+            stats_add(reclaim_ns, uint64_t((vl::fast_clock::now() - start).count()));
+        }
+
+        uint64_t const depth = pushes.load(std::memory_order_relaxed) - reclaimed.load(std::memory_order_relaxed);
+        if(depth > high_water.load(std::memory_order_relaxed))
+        {
+            high_water.store(depth, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint64_t> pushes;
+    std::atomic<uint64_t> reclaimed;
+    std::atomic<uint64_t> high_water;
+    std::atomic<uint64_t> reclaim_ns;
+};
+
+/// Counters only the reader updates
+struct alignas(CACHE_LINE_SIZE) fifo_reader_stats
+{
+    fifo_reader_stats()
+        : pops(0)
+        , empty_polls(0)
+    {}
+
+    void popped(uint64_t n)
+    {
+        if(n == 0)
+        { stats_add(empty_polls, 1); }
+        else
+        { stats_add(pops, n); }
+    }
+
+    std::atomic<uint64_t> pops;
+    std::atomic<uint64_t> empty_polls;
+};
+
+/// @brief combine the two sides into a snapshot, any thread
+inline fifo_stats make_fifo_stats(fifo_writer_stats const &w, fifo_reader_stats const &r)
+{
+    fifo_stats s;
+    // pops first, so we don't see more pops than pushes
+    s.pops = r.pops.load(std::memory_order_relaxed);
+    s.empty_polls = r.empty_polls.load(std::memory_order_relaxed);
+    s.pushes = w.pushes.load(std::memory_order_relaxed);
+    s.high_water = w.high_water.load(std::memory_order_relaxed);
+    s.reclaim_ns = w.reclaim_ns.load(std::memory_order_relaxed);
+    s.depth = s.pushes > s.pops ? s.pushes - s.pops : 0;
+    return s;
+}
+
+#else
+
+// Stubs, the fifo code calls these either way
+
+struct fifo_writer_stats
+{
+    struct time_point {};
+
+    void pushed(uint64_t) {}
+    time_point reclaim_start() const { return time_point(); }
+    void reclaim_done(uint64_t, time_point) {}
+};
+
+struct fifo_reader_stats
+{
+    void popped(uint64_t) {}
+};
+
+inline fifo_stats make_fifo_stats(fifo_writer_stats const &, fifo_reader_stats const &)
+{
+    return fifo_stats();
+}
+
+#endif  // FIFO_STATS
+
+#endif  // FIFO_STATS_HPP
@@ -0,0 +1,287 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file flow_control.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef FLOW_CONTROL_HPP
+#define FLOW_CONTROL_HPP
+
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <utility>
+
+#include "cache_line.hpp"
+#include "wait.hpp"
+
+/// What a producer does when the consumer has no room
+enum overflow_policy
+{
+    /// wait for the consumer to drain
+    OVERFLOW_BLOCK,
+    /// return false and let the caller decide
+    OVERFLOW_FAIL,
+    /// give it to another consumer that has room, wait if none has
+    OVERFLOW_SPILL
+};
+
+/** @class credit_counter
+ *  @desc Credit based flow control between one producer and one consumer
+ *  The consumer starts with capacity credits. The producer takes one for every message it
+ *  sends and the consumer gives them back as it drains, so no more than capacity messages
+ *  are ever queued no matter how far behind the consumer is.
+ *
+ *  Watermarks: on_high_water is called by the producer when it fills the queue to the
+ *  high mark, on_low_water by the consumer when it has drained back down to the low mark.
+ *  They come in pairs, use them to throttle whatever feeds the producer.
+ *  Keep the callbacks short, they run inside push and consume.
+ *
+ *  Capacity 0 is unbounded, the credits aren't counted at all then.
+*/
+class credit_counter
+{
+public:
+    typedef std::function<void()> callback;
+
+    /// @brief Constructor
+    /// @param capacity messages in flight at most, 0 for no limit
+    explicit credit_counter(size_t capacity = 0)
+        : credits(capacity)
+        , above(false)
+        , limit(capacity)
+        , high(capacity)
+        , low(capacity/2)
+    {}
+
+    /// @brief set the limit, only before the queue is used
+    /// @param capacity messages in flight at most, 0 for no limit
+    void set_capacity(size_t capacity)
+    {
+        credits.store(capacity, std::memory_order_relaxed);
+        limit = capacity;
+        high = capacity;
+        low = capacity/2;
+    }
+
+    /// @brief set the watermarks and the callbacks, only before the queue is used
+    /// @param high_mark on_high is called when this many messages are queued
+    /// @param low_mark on_low is called when the queue is back down to this many
+    void set_watermarks(size_t high_mark, size_t low_mark, callback on_high, callback on_low)
+    {
+        assert(low_mark < high_mark && high_mark <= limit);
+        high = high_mark;
+        low = low_mark;
+        on_high_water = on_high;
+        on_low_water = on_low;
+    }
+
+    /// @brief take a credit if there is one, only the producer
+    /// @return true if we can send
+    bool try_acquire()
+    {
+        if(limit == 0)
+        { return true; }
+
+        // only the producer takes so nobody else can take it between the load and the sub
+        if(credits.load(std::memory_order_acquire) == 0)
+        { return false; }
+        size_t const left = credits.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        if(limit - left >= high && !above.load(std::memory_order_relaxed)
+                && !above.exchange(true, std::memory_order_acq_rel) && on_high_water)
+        {
+            on_high_water();
+        }
+        return true;
+    }
+
+    /// @brief take a credit, waits for the consumer to give one back, only the producer
+    void acquire()
+    {
+        while(!try_acquire())
+        {
+            waiter.wait([this]() { return credits.load(std::memory_order_acquire) != 0; }, vl::time(1));
+        }
+    }
+
+    /// @brief take a credit, waits at most timeout
+    /// @return true if we can send, false if the consumer didn't drain in time
+    bool acquire(vl::time const &timeout)
+    {
+        return try_acquire()
+            || (waiter.wait([this]() { return credits.load(std::memory_order_acquire) != 0; }, timeout)
+                && try_acquire());
+    }
+
+    /// @brief give credits back, only the consumer
+    /// @param n messages drained
+    void release(size_t n)
+    {
+        if(limit == 0 || n == 0)
+        { return; }
+
+        size_t const left = credits.fetch_add(n, std::memory_order_acq_rel) + n;
+        assert(left <= limit);
+        waiter.notify();
+        if(limit - left <= low && above.load(std::memory_order_relaxed)
+                && above.exchange(false, std::memory_order_acq_rel) && on_low_water)
+        {
+            on_low_water();
+        }
+    }
+
+    /// @brief messages in flight, approximate from the other side
+    size_t in_use() const
+    {
+        return limit == 0 ? 0 : limit - credits.load(std::memory_order_relaxed);
+    }
+
+    /// @brief credits the producer has left
+    size_t available() const
+    {
+        return credits.load(std::memory_order_relaxed);
+    }
+
+    /// @brief the limit, 0 for none
+    size_t capacity() const
+    {
+        return limit;
+    }
+
+private:
+    // not copyable, shared by two threads
+    credit_counter(credit_counter const &);
+    credit_counter &operator=(credit_counter const &);
+
+    // written by both sides
+    std::atomic<size_t> credits;
+    std::atomic<bool> above;
+    spin_park waiter;
+    char pad[CACHE_LINE_SIZE];
+
+    // set before use
+    size_t limit;
+    size_t high;
+    size_t low;
+    callback on_high_water;
+    callback on_low_water;
+};
+
+/** @class bounded_fifo
+ *  @desc Queue with a capacity, credit_counter in front of any of the queues
+ *  push waits for room, try_push fails, the credits go back once per consume_all so
+ *  draining a burst costs one atomic add. Same threading rules as Queue.
+ *
+ *  Queue is the queue template (via an alias like channel), it can be unbounded,
+ *  the credits do the limiting. Works as the Queue of a channel:
+ *
+ *      template<typename T> using bounded_inbox_t = bounded_fifo<T, inbox_t>;
+ *      channel<bounded_inbox_t, BatchMsg, ExitMsg> chan(64);
+*/
+template<typename T, template<typename> class Queue>
+class bounded_fifo
+{
+public:
+    /// @brief Constructor
+    /// @param capacity elements queued at most
+    explicit bounded_fifo(size_t capacity)
+    {
+        assert(capacity > 0);
+        flow.set_capacity(capacity);
+    }
+
+    /// @brief push data to back, waits for the reader if the queue is full
+    void push(T const &data)
+    {
+        flow.acquire();
+        queue.push(data);
+    }
+
+    /// @brief construct the element in place, waits if the queue is full
+    template<typename... Args>
+    void emplace(Args&&... args)
+    {
+        flow.acquire();
+        queue.emplace(std::forward<Args>(args)...);
+    }
+
+    /// @brief push data to back if there is room
+    /// @return true if pushed, false if the queue is full
+    bool try_push(T const &data)
+    {
+        if(!flow.try_acquire())
+        { return false; }
+        queue.push(data);
+        return true;
+    }
+
+    /// @brief push data according to a policy, spill is the same as block with only one queue
+    /// @return false if the queue is full and policy is OVERFLOW_FAIL
+    bool push(T const &data, overflow_policy policy)
+    {
+        if(policy == OVERFLOW_FAIL)
+        { return try_push(data); }
+        push(data);
+        return true;
+    }
+
+    bool try_pop(T &data)
+    {
+        return consume([&data](T &elem) { data = elem; });
+    }
+
+    template<typename F>
+    bool consume(F f)
+    {
+        bool const ret = queue.consume(f);
+        flow.release(ret ? 1 : 0);
+        return ret;
+    }
+
+    /// @brief call f for every element, the credits go back in one go at the end
+    template<typename F>
+    size_t consume_all(F f)
+    {
+        size_t const n = queue.consume_all(f);
+        flow.release(n);
+        return n;
+    }
+
+    bool wait(vl::time const &timeout)
+    {
+        return queue.wait(timeout);
+    }
+
+    bool pop_wait(T &data, vl::time const &timeout)
+    {
+        return wait(timeout) && try_pop(data);
+    }
+
+    bool empty() const
+    {
+        return queue.empty();
+    }
+
+    /// @brief the credits, for the watermarks and monitoring
+    credit_counter &credits()
+    {
+        return flow;
+    }
+
+    credit_counter const &credits() const
+    {
+        return flow;
+    }
+
+private:
+    // not copyable, shared with other threads
+    bounded_fifo(bounded_fifo const &);
+    bounded_fifo &operator=(bounded_fifo const &);
+
+    Queue<T> queue;
+    credit_counter flow;
+};
+
+#endif  // FLOW_CONTROL_HPP
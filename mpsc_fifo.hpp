@@ -0,0 +1,236 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file mpsc_fifo.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef MPSC_FIFO_HPP
+#define MPSC_FIFO_HPP
+
+#include <atomic>
+#include <cassert>
+#include <string>
+#include <new>
+#include <utility>
+
+#include "cache_line.hpp"
+#include "wait.hpp"
+
+/** @class mpsc_fifo
+ *  @desc Non locking queue for any number of writers and one reader
+ *  Same interface as fifo on the reader side, but push can be called from any thread.
+ *  Useful when many workers report to one coordinator: the coordinator waits on one queue
+ *  instead of scanning a fifo per worker and results come out in the order they were pushed.
+ *
+ *  Linked list where writers swap themselves in as the new back with a single exchange
+ *  and then link the previous back to them (Dmitry Vyukov's MPSC queue).
+ *  Between those two steps the queue looks shorter to the reader than it is, the elements
+ *  behind the missing link show up as soon as the writer finishes its push.
+ *
+ *  Unlike fifo the nodes are allocated on push and deleted by the reader, recycling them
+ *  would need a free list shared by all the writers.
+ *
+ *  Wait is the strategy pop_wait uses when the buffer is empty (see wait.hpp).
+*/
+template<typename T, typename Wait = busy_spin>
+class mpsc_fifo
+{
+private:
+    /// Linked list structure
+    /// data is only alive between push and the reader passing the node
+    struct node
+    {
+        node()
+            : next(nullptr)
+        {}
+
+        T *data()
+        { return reinterpret_cast<T *>(storage); }
+
+        alignas(T) unsigned char storage[sizeof(T)];
+        std::atomic<node *> next;
+    };
+
+public:
+    /// Constructor
+    mpsc_fifo()
+    {
+        // empty node so both ends always have something to point to
+        front = new node;
+        back.store(front);
+    }
+
+    /// Destructor, no writers may be running
+    ~mpsc_fifo()
+    {
+        node *n = front->next.load(std::memory_order_relaxed);
+        delete front;
+        while(n != nullptr)
+        {
+            node *tmp = n;
+            n = tmp->next.load(std::memory_order_relaxed);
+            tmp->data()->~T();
+            delete tmp;
+        }
+    }
+
+    /// @brief push data to back, can be called from any thread
+    /// @param data element to push
+    /// @throws std::bad_alloc or if copying data throws
+    void push(T const &data)
+    {
+        emplace(data);
+    }
+
+    /// @brief push data to back, can be called from any thread
+    /// @param data element to move into the buffer
+    /// @throws std::bad_alloc or if moving data throws
+    void push(T &&data)
+    {
+        emplace(std::move(data));
+    }
+
+    /// @brief construct an element in place at the back, can be called from any thread
+    /// @param args arguments passed to the constructor of T
+    /// @throws std::bad_alloc or if the constructor throws, the buffer is left unchanged
+    template<typename... Args>
+    void emplace(Args&&... args)
+    {
+        node *n = new node;
+        try
+        {
+            new (n->data()) T(std::forward<Args>(args)...);
+        }
+        catch(...)
+        {
+            delete n;
+            throw;
+        }
+
+        node *prev = back.exchange(n, std::memory_order_acq_rel);
+        // the reader can't get past prev until this store
+        prev->next.store(n, std::memory_order_release);
+        waiter.notify();
+    }
+
+    /// @brief pop data from front
+    /// @return the popped element
+    /// @throws on an empty buffer
+    T pop()
+    {
+        node *next = front->next.load(std::memory_order_acquire);
+        if(next == nullptr)
+        {
+            throw std::string("empty");
+        }
+
+        T data(std::move(*next->data()));
+        advance(next);
+        return data;
+    }
+
+    /// @brief pop data from front if there is any
+    /// @param data OUT the popped element is moved here
+    /// @return true if an element was popped, false if the buffer was empty
+    /// @throws only if moving the element throws
+    bool try_pop(T &data)
+    {
+        return consume_n([&data](T &elem) { data = std::move(elem); }, 1) == 1;
+    }
+
+    /// @brief use the front element in place and pop it
+    /// @param f functor called with a reference to the element, must not throw
+    /// @return true if an element was consumed, false if the buffer was empty
+    template<typename F>
+    bool consume(F f)
+    {
+        return consume_n(f, 1) == 1;
+    }
+
+    /// @brief pop up to max elements
+    /// @param out output iterator the elements are moved to
+    /// @param max maximum number of elements to pop
+    /// @return number of elements popped
+    template<typename OutputIt>
+    size_t pop_n(OutputIt out, size_t max)
+    {
+        return consume_n([&out](T &data) { *out = std::move(data); ++out; }, max);
+    }
+
+    /// @brief call f for every element that is in the buffer at the moment
+    /// @param f functor called with a reference to every element in order, must not throw
+    /// @return number of elements consumed
+    template<typename F>
+    size_t consume_all(F f)
+    {
+        return consume_n(f, size_t(-1));
+    }
+
+    /// @brief wait until there is data to read
+    /// @param timeout how long to wait at most
+    /// @return true if there is data, false if we timed out
+    bool wait(vl::time const &timeout)
+    {
+        return waiter.wait([this]() { return !empty(); }, timeout);
+    }
+
+    /// @brief pop data from front, waits for data if the buffer is empty
+    /// @param data OUT the popped element is moved here
+    /// @param timeout how long to wait at most
+    /// @return true if an element was popped, false if we timed out
+    /// @throws only if moving the element throws
+    bool pop_wait(T &data, vl::time const &timeout)
+    {
+        return wait(timeout) && try_pop(data);
+    }
+
+    /// @brief is this buffer empty, only valid from the reader
+    /// @return true if empty, false otherwise
+    bool empty() const
+    {
+        return front->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    // not copyable, the nodes are shared with other threads
+    mpsc_fifo(mpsc_fifo const &);
+    mpsc_fifo &operator=(mpsc_fifo const &);
+
+    /// @brief call f for up to max elements
+    template<typename F>
+    size_t consume_n(F f, size_t max)
+    {
+        size_t count = 0;
+        while(count < max)
+        {
+            node *next = front->next.load(std::memory_order_acquire);
+            if(next == nullptr)
+            { break; }
+
+            f(*next->data());
+            advance(next);
+            ++count;
+        }
+        return count;
+    }
+
+    /// @brief make next the new empty front node, destroys its element
+    void advance(node *next)
+    {
+        next->data()->~T();
+        delete front;
+        front = next;
+    }
+
+    // writers side: swapped by every push
+    std::atomic<node *> back;
+    char pad0[CACHE_LINE_SIZE - sizeof(std::atomic<node *>)];
+
+    // reader side
+    node *front;
+    Wait waiter;
+};
+
+#endif  // MPSC_FIFO_HPP
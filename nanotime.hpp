@@ -0,0 +1,206 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file nanotime.hpp
+*
+*   Under a copyleft.
+*/
+
+/*
+ *  Nanosecond time for the hot paths.
+ *
+ *  duration and time_point are a single int64_t of nanoseconds, all the arithmetic
+ *  is exact integer math and constexpr (292 years of range either way).
+ *  vl::time stays for the interfaces that already use it, both convert to it.
+ *
+ *  fast_clock reads the time stamp counter when the CPU has an invariant one
+ *  (x86-64, GCC or Clang) and scales it to nanoseconds with a multiply and a shift.
+ *  The scale is calibrated against CLOCK_MONOTONIC at startup, during static initialisation
+ *  (takes ~10ms before main), now() only reads it.
+ *  Elsewhere it falls back to clock_gettime(CLOCK_MONOTONIC) or QueryPerformanceCounter.
+ *  The implementation is in time.cpp.
+ */
+
+#ifndef VL_NANOTIME_HPP
+#define VL_NANOTIME_HPP
+
+#include <stdint.h>
+#include <iostream>
+
+#include "time.hpp"
+
+namespace vl
+{
+
+/// Signed time interval in nanoseconds
+class duration
+{
+public:
+    constexpr duration()
+        : _ns(0)
+    {}
+
+    constexpr explicit duration(int64_t ns)
+        : _ns(ns)
+    {}
+
+    /// @brief convert from the microsecond time
+    duration(time const &t)
+        : _ns(int64_t(t.sec)*1000000000 + int64_t(t.usec)*1000)
+    {}
+
+    /// @brief nanoseconds in this interval
+    constexpr int64_t count() const
+    { return _ns; }
+
+    /// @brief convert to the microsecond time, negative durations become zero
+    time to_time() const
+    {
+        if(_ns <= 0)
+        { return time(); }
+        return time(uint32_t(_ns/1000000000), uint32_t(_ns%1000000000/1000));
+    }
+
+    /// @brief seconds as a double, for printing rates
+    constexpr double seconds() const
+    { return double(_ns)/1e9; }
+
+    duration &operator+=(duration d)
+    { _ns += d._ns; return *this; }
+
+    duration &operator-=(duration d)
+    { _ns -= d._ns; return *this; }
+
+    duration &operator*=(int64_t n)
+    { _ns *= n; return *this; }
+
+    duration &operator/=(int64_t n)
+    { _ns /= n; return *this; }
+
+private:
+    int64_t _ns;
+};
+
+constexpr duration nanoseconds(int64_t n)
+{ return duration(n); }
+
+constexpr duration microseconds(int64_t n)
+{ return duration(n*1000); }
+
+constexpr duration milliseconds(int64_t n)
+{ return duration(n*1000000); }
+
+constexpr duration seconds(int64_t n)
+{ return duration(n*1000000000); }
+
+constexpr duration operator+(duration a, duration b)
+{ return duration(a.count() + b.count()); }
+
+constexpr duration operator-(duration a, duration b)
+{ return duration(a.count() - b.count()); }
+
+constexpr duration operator-(duration a)
+{ return duration(-a.count()); }
+
+constexpr duration operator*(duration a, int64_t n)
+{ return duration(a.count()*n); }
+
+constexpr duration operator*(int64_t n, duration a)
+{ return duration(a.count()*n); }
+
+constexpr duration operator/(duration a, int64_t n)
+{ return duration(a.count()/n); }
+
+/// @brief how many times b fits in a
+constexpr int64_t operator/(duration a, duration b)
+{ return a.count()/b.count(); }
+
+constexpr duration operator%(duration a, duration b)
+{ return duration(a.count() % b.count()); }
+
+constexpr bool operator==(duration a, duration b)
+{ return a.count() == b.count(); }
+
+constexpr bool operator!=(duration a, duration b)
+{ return a.count() != b.count(); }
+
+constexpr bool operator<(duration a, duration b)
+{ return a.count() < b.count(); }
+
+constexpr bool operator>(duration a, duration b)
+{ return a.count() > b.count(); }
+
+constexpr bool operator<=(duration a, duration b)
+{ return a.count() <= b.count(); }
+
+constexpr bool operator>=(duration a, duration b)
+{ return a.count() >= b.count(); }
+
+/// Same format as time with the nanoseconds at the end
+std::ostream &operator<<(std::ostream &os, duration d);
+
+/// A moment on fast_clock, nanoseconds since an unspecified start
+class time_point
+{
+public:
+    constexpr time_point()
+        : _since(0)
+    {}
+
+    constexpr explicit time_point(duration since)
+        : _since(since)
+    {}
+
+    constexpr duration since_epoch() const
+    { return _since; }
+
+    time_point &operator+=(duration d)
+    { _since += d; return *this; }
+
+    time_point &operator-=(duration d)
+    { _since -= d; return *this; }
+
+private:
+    duration _since;
+};
+
+constexpr duration operator-(time_point a, time_point b)
+{ return a.since_epoch() - b.since_epoch(); }
+
+constexpr time_point operator+(time_point a, duration d)
+{ return time_point(a.since_epoch() + d); }
+
+constexpr time_point operator-(time_point a, duration d)
+{ return time_point(a.since_epoch() - d); }
+
+constexpr bool operator==(time_point a, time_point b)
+{ return a.since_epoch() == b.since_epoch(); }
+
+constexpr bool operator!=(time_point a, time_point b)
+{ return a.since_epoch() != b.since_epoch(); }
+
+constexpr bool operator<(time_point a, time_point b)
+{ return a.since_epoch() < b.since_epoch(); }
+
+constexpr bool operator>(time_point a, time_point b)
+{ return a.since_epoch() > b.since_epoch(); }
+
+constexpr bool operator<=(time_point a, time_point b)
+{ return a.since_epoch() <= b.since_epoch(); }
+
+constexpr bool operator>=(time_point a, time_point b)
+{ return a.since_epoch() >= b.since_epoch(); }
+
+/// Cheap monotonic clock, see the top of the file
+struct fast_clock
+{
+    /// @brief current time, same time base on every thread
+    static time_point now();
+
+    /// @brief is the time stamp counter used (false if we fell back to the OS clock)
+    static bool uses_tsc();
+};
+
+}   // namespace vl
+
+#endif  // VL_NANOTIME_HPP
@@ -9,12 +9,120 @@
 #ifndef PRIME_HPP
 #define PRIME_HPP
 
-#include "chrono.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+/// Largest number in the small primes table
+const uint32_t SMALL_PRIME_LIMIT = uint32_t(1) << 20;
+/// The segmented sieve works below this, above it every number is tested on its own
+const uint64_t SIEVE_LIMIT = uint64_t(SMALL_PRIME_LIMIT)*SMALL_PRIME_LIMIT;
+/// Odd numbers per sieve segment, one byte each so a segment stays in the L1 cache
+const size_t SIEVE_SEGMENT = 32*1024;
+
+/// @brief primes up to SMALL_PRIME_LIMIT
+/// Built on the first call (thread safe), read only after that so every thread can share it.
+inline std::vector<uint32_t> const &small_primes()
+{
+    struct table
+    {
+        table()
+        {
+            std::vector<unsigned char> composite(SMALL_PRIME_LIMIT + 1, 0);
+            for(uint32_t i = 2; i <= SMALL_PRIME_LIMIT; ++i)
+            {
+                if(composite[i])
+                { continue; }
+                primes.push_back(i);
+                for(uint64_t j = uint64_t(i)*i; j <= SMALL_PRIME_LIMIT; j += i)
+                { composite[size_t(j)] = 1; }
+            }
+        }
+
+        std::vector<uint32_t> primes;
+    };
+
+    static const table t;
+    return t.primes;
+}
+
+/// @brief a*b mod m without overflow
+inline uint64_t mul_mod(uint64_t a, uint64_t b, uint64_t m)
+{
+#ifdef __SIZEOF_INT128__
+    return uint64_t((unsigned __int128)a*b % m);
+#else
+    // double and add, no 128 bit type on this compiler
+    uint64_t r = 0;
+    a %= m;
+    while(b > 0)
+    {
+        if(b & 1)
+        { r = a >= m - r ? a - (m - r) : a + r; }
+        a = a >= m - a ? a - (m - a) : a + a;
+        b >>= 1;
+    }
+    return r;
+#endif
+}
+
+/// @brief a^e mod m
+inline uint64_t pow_mod(uint64_t a, uint64_t e, uint64_t m)
+{
+    uint64_t r = 1;
+    a %= m;
+    while(e > 0)
+    {
+        if(e & 1)
+        { r = mul_mod(r, a, m); }
+        a = mul_mod(a, a, m);
+        e >>= 1;
+    }
+    return r;
+}
+
+/// @brief deterministic Miller-Rabin, correct for every 64 bit number
+/// The first twelve primes as bases are enough below 3.3 * 10^24.
+/// @param n odd number larger than 37
+inline bool miller_rabin(uint64_t n)
+{
+    static const uint64_t bases[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+
+    // n - 1 = d * 2^s
+    uint64_t d = n - 1;
+    unsigned s = 0;
+    while((d & 1) == 0)
+    {
+        d >>= 1;
+        ++s;
+    }
+
+    for(size_t i = 0; i < sizeof(bases)/sizeof(bases[0]); ++i)
+    {
+        uint64_t x = pow_mod(bases[i], d, n);
+        if(x == 1 || x == n - 1)
+        { continue; }
+
+        bool witness = true;
+        for(unsigned r = 1; r < s && witness; ++r)
+        {
+            x = mul_mod(x, x, n);
+            if(x == n - 1)
+            { witness = false; }
+        }
+        if(witness)
+        { return false; }
+    }
+    return true;
+}
 
 /// @brief test if a number is a prime or not
+/// Trial division for small numbers, Miller-Rabin for the rest.
 /// @param n number to test
 /// @return true if prime, false otherwise
-bool isPrime(size_t n)
+inline bool isPrime(size_t n)
 {
     if (n <= 1)
     { return false; }
@@ -23,7 +131,20 @@ bool isPrime(size_t n)
     else if (n % 2 == 0 || n % 3 == 0)
     { return false; }
 
-    int i = 5;
+    if (n >= SMALL_PRIME_LIMIT)
+    {
+        // weed out most of the composites before the expensive test
+        static const uint32_t trial[] = { 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+        for (size_t i = 0; i < sizeof(trial)/sizeof(trial[0]); ++i)
+        {
+            if (n % trial[i] == 0)
+            { return false; }
+        }
+        return miller_rabin(n);
+    }
+
+    // i*i can't overflow below the limit
+    size_t i = 5;
     while (i * i <= n)
     {
         if (n % i == 0 || n %(i + 2) == 0)
@@ -33,15 +154,80 @@ bool isPrime(size_t n)
     return true;
 }
 
-/// @brief delay function that simulates a more complex function call
-/// @param delay_ms empty spinning time in milliseconds
-void really_slow_func(double delay_ms)
+/// @brief segmented sieve of Eratosthenes over [lo, hi), hi <= SIEVE_LIMIT
+template<typename F>
+void sieve_segments(uint64_t lo, uint64_t hi, F &f)
 {
-    auto limit = vl::time(0, (uint32_t)(delay_ms*1000));
-    auto clock = vl::chrono();
+    if(lo <= 2 && hi > 2)
+    { f(size_t(2)); }
+
+    std::vector<uint32_t> const &primes = small_primes();
+    unsigned char segment[SIEVE_SEGMENT];
+
+    // only odd numbers from here on, segment[i] is o + 2*i
+    uint64_t o = lo < 3 ? 3 : (lo | 1);
+    while(o < hi)
+    {
+        uint64_t const seg_hi = hi - o > 2*SIEVE_SEGMENT ? o + 2*SIEVE_SEGMENT : hi;
+        size_t const n_odd = size_t((seg_hi - o + 1)/2);
+        std::memset(segment, 1, n_odd);
+
+        // the table starts with 2, the evens aren't in the segment
+        for(size_t k = 1; k < primes.size(); ++k)
+        {
+            uint64_t const p = primes[k];
+            if(p*p >= seg_hi)
+            { break; }
 
-    while(clock.elapsed() < limit)
-    {}
+            // first odd multiple in the segment, never p itself
+            uint64_t m = p*p;
+            if(m < o)
+            {
+                m = (o + p - 1)/p*p;
+                if((m & 1) == 0)
+                { m += p; }
+            }
+            for(; m < seg_hi; m += 2*p)
+            {
+                segment[size_t((m - o)/2)] = 0;
+            }
+        }
+
+        for(size_t i = 0; i < n_odd; ++i)
+        {
+            if(segment[i])
+            { f(size_t(o + 2*i)); }
+        }
+        o = seg_hi;
+    }
+}
+
+/// @brief call f for every prime in [base, base + count) in increasing order
+/// Sieves the part of the range below SIEVE_LIMIT, a linear pass instead of a test per number.
+/// Above that every odd number is tested with isPrime (Miller-Rabin).
+/// Works up to the largest size_t, the range is cut there.
+/// @param base first number
+/// @param count how many numbers
+/// @param f called with each prime (size_t)
+template<typename F>
+void primes_in_range(size_t base, size_t count, F f)
+{
+    size_t const max = std::numeric_limits<size_t>::max();
+    // one past the last number, the largest size_t itself is never prime (2^n - 1 with n even)
+    size_t const end = count > max - base ? max : base + count;
+
+    if(base < SIEVE_LIMIT)
+    {
+        uint64_t const sieve_end = end < SIEVE_LIMIT ? end : SIEVE_LIMIT;
+        sieve_segments(base, sieve_end, f);
+        base = size_t(sieve_end);
+    }
+
+    for(size_t n = base; n < end; ++n)
+    {
+        if(isPrime(n))
+        { f(n); }
+    }
 }
 
 #endif  // PRIME_HPP
@@ -0,0 +1,582 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file primes_process.cpp
+*
+*   Under a copyleft.
+*/
+
+// primes_threaded with the workers in their own processes.
+// Every worker has an inbox and a results queue, the coordinator hands out batches round
+// robin and collects the primes. A worker that crashes only loses the batches it had,
+// the coordinator notices (waitpid) and gives them to the others.
+//
+// The queues are shm_fifos in shared memory or socket_fifos. With sockets the workers
+// connect to the coordinator's address the same way they would from another machine,
+// the worker and coordinator code is the same for both.
+//
+// Params {EXE} {N_WORKERS} {DELAY} {OUTPUT_FILENAME} {BATCH_SIZE} {WORKLOAD} {CRASH_WORKER} {TRANSPORT}
+// N_workers how many worker processes do we create
+// Delay in milliseconds (extra time function call takes), fractions are fine
+// Batch size how many numbers per message
+// Workload what the delay does: alu, cache, dram or state
+// Crash worker index of a worker that aborts on its second batch (optional, -1 for none)
+// Transport shm (default) or an address to listen on: unix:PATH or tcp:HOST:PORT
+
+#include "chrono.hpp"
+
+#include <cassert>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "shm_fifo.hpp"
+#include "socket_fifo.hpp"
+#include "result_writer.hpp"
+#include "prime.hpp"
+#include "workload.hpp"
+#include "defines.hpp"
+
+// Messages are copied into the shared memory or the socket, no pointers in them
+
+/// Range of numbers to check [base, base + count), from the coordinator to a worker
+struct BatchMsg
+{
+    uint32_t id;
+    /// quit instead of working
+    bool stop;
+    size_t base;
+    size_t count;
+};
+
+/// primes in one results message, a batch is sent in as many as it needs
+const size_t RESULTS_CHUNK = 62;
+
+/// Some of the primes of a batch, from a worker to the coordinator
+struct ResultsMsg
+{
+    uint32_t batch;
+    /// which worker sent this
+    uint16_t worker;
+    uint16_t size;
+    /// the batch is done with this one
+    bool last;
+    size_t data[RESULTS_CHUNK];
+};
+
+/// How long a reader sleeps before checking again (it's woken up by a push anyway)
+const vl::time WAIT_TIMEOUT(0, 100000);
+/// How long the coordinator sleeps when a worker has hung up but waitpid doesn't have it yet
+const vl::time EXIT_POLL(0, 1000);
+/// How long a worker keeps trying to connect
+const vl::time CONNECT_TIMEOUT(5);
+/// batches a worker has queued at most, the rest wait in the coordinator
+const size_t MAX_IN_FLIGHT = 4;
+
+/// Coordinator's view of a worker process
+template<typename Transport>
+struct worker_proc
+{
+    worker_proc()
+        : pid(-1)
+        , alive(false)
+        , n_batches(0)
+    {}
+
+    std::unique_ptr<typename Transport::inbox_t> inbox;
+    std::unique_ptr<typename Transport::results_t> results;
+    pid_t pid;
+    bool alive;
+    /// sent and not finished, in the order the worker runs them
+    std::deque<BatchMsg> outstanding;
+    /// primes of the batch the worker is sending right now
+    std::vector<size_t> partial;
+    size_t n_batches;
+};
+
+/// the doorbell the SIGCHLD handler rings, only in the coordinator
+shm_doorbell *child_bell = nullptr;
+
+extern "C" void ring_on_child(int)
+{
+    if(child_bell)
+    { child_bell->ring(); }
+}
+
+/// Queues in named shared memory, created before the fork and inherited by the worker
+/// Every worker rings one doorbell after sending results and so does a worker's death
+/// (SIGCHLD), the coordinator sleeps on the doorbell.
+struct shm_transport
+{
+    typedef shm_fifo<BatchMsg, 64> inbox_t;
+    typedef shm_fifo<ResultsMsg, 256> results_t;
+
+    shm_transport()
+        : prefix("/mq_primes_" + std::to_string(::getpid()))
+        , bell(prefix + "_bell", SHM_CREATE)
+    {
+        bell.unlink();
+
+        child_bell = &bell;
+        struct sigaction sa;
+        sa.sa_handler = ring_on_child;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+        ::sigaction(SIGCHLD, &sa, &old_action);
+    }
+
+    ~shm_transport()
+    {
+        ::sigaction(SIGCHLD, &old_action, nullptr);
+        child_bell = nullptr;
+    }
+
+    /// @brief before worker i is forked
+    void prepare(size_t i, worker_proc<shm_transport> &w)
+    {
+        w.inbox.reset(new inbox_t(prefix + "_in_" + std::to_string(i), SHM_CREATE));
+        w.results.reset(new results_t(prefix + "_out_" + std::to_string(i), SHM_CREATE));
+        // the worker inherits the mappings, the names aren't needed and can't leak in a crash
+        w.inbox->unlink();
+        w.results->unlink();
+    }
+
+    /// @brief in worker i after the fork, it has the mappings already
+    void open_worker(size_t, worker_proc<shm_transport> &)
+    {}
+
+    /// @brief in the coordinator after worker i is forked
+    void open_coordinator(size_t, worker_proc<shm_transport> &)
+    {}
+
+    /// @brief in a worker, after it has sent results
+    void ring()
+    {
+        bell.ring();
+    }
+
+    /// @brief in the coordinator, before it reads the results and checks for dead workers
+    uint32_t arm()
+    {
+        return bell.rings();
+    }
+
+    /// @brief in the coordinator, sleep until a worker sends results or dies
+    /// @param seen what arm returned
+    void wait_any(std::vector<std::unique_ptr<worker_proc<shm_transport> > > &, uint32_t seen,
+            vl::time const &timeout)
+    {
+        bell.wait(seen, timeout);
+    }
+
+    std::string name() const
+    {
+        return "shared memory";
+    }
+
+    std::string prefix;
+    shm_doorbell bell;
+    struct sigaction old_action;
+
+private:
+    // not copyable, the signal handler points to the bell
+    shm_transport(shm_transport const &);
+    shm_transport &operator=(shm_transport const &);
+};
+
+/// Queues over sockets, the worker connects to the coordinator like it would from another machine
+struct socket_transport
+{
+    typedef socket_fifo<BatchMsg> inbox_t;
+    typedef socket_fifo<ResultsMsg> results_t;
+
+    explicit socket_transport(std::string const &addr)
+        : listener(addr)
+    {}
+
+    void prepare(size_t, worker_proc<socket_transport> &)
+    {}
+
+    /// @brief in worker i, connects the inbox first and the results second
+    void open_worker(size_t, worker_proc<socket_transport> &w)
+    {
+        w.inbox.reset(new inbox_t(socket_connect(listener.address(), CONNECT_TIMEOUT)));
+        w.results.reset(new results_t(socket_connect(listener.address(), CONNECT_TIMEOUT)));
+    }
+
+    /// @brief in the coordinator, accepts worker i's connections before the next one is forked
+    void open_coordinator(size_t i, worker_proc<socket_transport> &w)
+    {
+        int const in_fd = listener.accept(CONNECT_TIMEOUT);
+        int const out_fd = in_fd < 0 ? -1 : listener.accept(CONNECT_TIMEOUT);
+        if(out_fd < 0)
+        {
+            throw std::string("worker ") + std::to_string(i) + " didn't connect";
+        }
+        w.inbox.reset(new inbox_t(in_fd));
+        w.results.reset(new results_t(out_fd));
+    }
+
+    /// @brief the socket wakes the coordinator, nothing to do
+    void ring()
+    {}
+
+    uint32_t arm()
+    {
+        return 0;
+    }
+
+    /// @brief in the coordinator, one poll over the results of every worker
+    /// A worker that dies closes its socket, that wakes the poll too.
+    void wait_any(std::vector<std::unique_ptr<worker_proc<socket_transport> > > &workers, uint32_t,
+            vl::time const &timeout)
+    {
+        vl::time wait = timeout;
+        std::vector<pollfd> fds;
+        for(size_t i = 0; i < workers.size(); ++i)
+        {
+            worker_proc<socket_transport> &w = *workers[i];
+            if(!w.alive)
+            { continue; }
+            // poll doesn't see what has already been received
+            if(!w.results->empty())
+            { return; }
+            // hung up and waitpid didn't have it yet, the exit is a moment away
+            if(w.results->closed())
+            {
+                wait = EXIT_POLL;
+                continue;
+            }
+            pollfd p = { w.results->native_handle(), POLLIN, 0 };
+            fds.push_back(p);
+        }
+        ::poll(fds.data(), fds.size(), int(wait.sec*1000 + wait.usec/1000));
+    }
+
+    std::string name() const
+    {
+        return listener.address();
+    }
+
+    socket_listener listener;
+};
+
+// worker process, never returns
+template<typename Inbox, typename Results, typename Ring>
+void primes(Inbox *in, Results *out, Ring ring, uint16_t id, workload_calibration cal,
+        vl::duration delay, bool crash)
+{
+    pid_t const parent = ::getppid();
+    workload work(cal);
+
+    size_t n_batches = 0;
+    BatchMsg batch;
+    while(true)
+    {
+        if(!in->pop_wait(batch, WAIT_TIMEOUT))
+        {
+            // the coordinator is gone, nobody is going to read what we'd send
+            if(::getppid() != parent)
+            { ::_exit(1); }
+            continue;
+        }
+        if(batch.stop)
+        { break; }
+
+        if(crash && n_batches == 1)
+        {
+            std::abort();
+        }
+
+        work.run(delay*int64_t(batch.count));
+
+        ResultsMsg msg;
+        msg.batch = batch.id;
+        msg.worker = id;
+        msg.size = 0;
+        msg.last = false;
+        primes_in_range(batch.base, batch.count, [out, &msg](size_t n)
+        {
+            msg.data[msg.size++] = n;
+            if(msg.size == RESULTS_CHUNK)
+            {
+                out->push(msg);
+                msg.size = 0;
+            }
+        });
+        msg.last = true;
+        out->push(msg);
+        // the whole batch goes in one send on a socket
+        out->flush();
+        ring();
+        ++n_batches;
+    }
+
+    out->flush();
+    // skip the destructors and atexit handlers, they belong to the coordinator
+    ::_exit(0);
+}
+
+/// @brief read what a worker has sent, finished batches go to the output
+/// @return how many batches finished
+template<typename Transport>
+size_t read_results(worker_proc<Transport> &w, result_writer &out, size_t &c_primes)
+{
+    size_t n_finished = 0;
+    w.results->consume_all([&w, &out, &c_primes, &n_finished](ResultsMsg const &msg)
+    {
+        w.partial.insert(w.partial.end(), msg.data, msg.data + msg.size);
+        if(!msg.last)
+        { return; }
+
+        // a worker runs its batches in order
+        assert(!w.outstanding.empty() && w.outstanding.front().id == msg.batch);
+        w.outstanding.pop_front();
+        for(size_t j = 0; j < w.partial.size(); ++j)
+        {
+            out.prime(w.partial[j], msg.worker);
+        }
+        c_primes += w.partial.size();
+        w.partial.clear();
+        ++w.n_batches;
+        ++n_finished;
+    });
+    return n_finished;
+}
+
+/// @brief start the workers, hand out the batches and collect the results
+/// @return exit code
+template<typename Transport>
+int run(Transport &transport, int n_workers, double delay, size_t batch_size,
+        workload_calibration const &cal, int crash_worker, std::string const &out_filename)
+{
+    /// Total number of primes to calculate
+    const size_t N_NUMBERS = n_workers * batch_size * N_RUNS;
+
+    // full application clock
+    vl::chrono app_timer;
+
+    // fork before any threads exist (the result writer has one)
+    std::clog.flush();
+    std::vector<std::unique_ptr<worker_proc<Transport> > > workers;
+    for(int i = 0; i < n_workers; ++i)
+    {
+        workers.emplace_back(new worker_proc<Transport>);
+        worker_proc<Transport> &w = *workers.back();
+        transport.prepare(i, w);
+        w.pid = ::fork();
+        if(w.pid < 0)
+        {
+            std::clog << "fork failed" << std::endl;
+            return 1;
+        }
+        if(w.pid == 0)
+        {
+            int status = 1;
+            try
+            {
+                transport.open_worker(i, w);
+                primes(w.inbox.get(), w.results.get(), [&transport]() { transport.ring(); },
+                        uint16_t(i), cal, vl::nanoseconds(int64_t(delay*1e6)), i == crash_worker);
+            }
+            catch(std::string const &e)
+            {
+                std::clog << "Worker " << i << " : " << e << std::endl;
+            }
+            ::_exit(status);
+        }
+        transport.open_coordinator(i, w);
+        w.alive = true;
+    }
+
+    result_writer out(out_filename, result_writer::mode_for(out_filename));
+    std::streambuf* oldCoutStreamBuf = std::cout.rdbuf();
+    std::cout.rdbuf(out.text_stream());
+
+    std::stringstream ss;
+    ss << "Starting with " << n_workers << " processes : " << batch_size << " per batch : "
+        << N_RUNS << " batches." << std::endl
+        << " Checking " << N_NUMBERS << " numbers for prime number." << std::endl
+        << " Queues over " << transport.name() << ".";
+    std::cout << ss.str() << std::endl;
+
+    // every batch, the ones of a crashed worker come back here
+    std::deque<BatchMsg> todo;
+    for(size_t i = 0; i < N_RUNS*n_workers; ++i)
+    {
+        BatchMsg msg = { uint32_t(i), false, i*batch_size, batch_size };
+        todo.push_back(msg);
+    }
+
+    size_t const n_batches = todo.size();
+    size_t n_finished = 0;
+    size_t c_primes = 0;
+    size_t n_alive = workers.size();
+    size_t next = 0;
+    while(n_finished != n_batches)
+    {
+        // round robin over the live workers that have room
+        for(size_t tries = 0; !todo.empty() && tries < workers.size(); ++tries)
+        {
+            worker_proc<Transport> &w = *workers[next];
+            next = (next + 1) % workers.size();
+            if(!w.alive || w.outstanding.size() >= MAX_IN_FLIGHT)
+            { continue; }
+
+            w.outstanding.push_back(todo.front());
+            w.inbox->push(todo.front());
+            todo.pop_front();
+            tries = 0;
+        }
+
+        // anything sent or any worker dying after this wakes wait_any
+        uint32_t const seen = transport.arm();
+        for(size_t i = 0; i < workers.size(); ++i)
+        {
+            if(workers[i]->alive)
+            {
+                workers[i]->inbox->flush();
+                n_finished += read_results(*workers[i], out, c_primes);
+            }
+        }
+
+        // a crashed worker keeps the batches it finished, the rest are done again by the others
+        int status = 0;
+        pid_t pid = 0;
+        while((pid = ::waitpid(-1, &status, WNOHANG)) > 0)
+        {
+            for(size_t i = 0; i < workers.size(); ++i)
+            {
+                worker_proc<Transport> &w = *workers[i];
+                if(w.pid != pid)
+                { continue; }
+
+                n_finished += read_results(w, out, c_primes);
+                w.alive = false;
+                w.pid = -1;
+                --n_alive;
+                std::clog << "Worker " << i << " died ("
+                    << (WIFSIGNALED(status) ? "signal " : "exit ")
+                    << (WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status))
+                    << "), resending " << w.outstanding.size() << " batches." << std::endl;
+                todo.insert(todo.begin(), w.outstanding.begin(), w.outstanding.end());
+                w.outstanding.clear();
+                w.partial.clear();
+            }
+        }
+        if(n_alive == 0)
+        {
+            std::clog << "All the workers died." << std::endl;
+            std::cout.rdbuf(oldCoutStreamBuf);
+            out.close();
+            return 1;
+        }
+
+        // sleep until any of the workers sends something or dies
+        transport.wait_any(workers, seen, WAIT_TIMEOUT);
+    }
+
+    // Cleanup
+    for(size_t i = 0; i < workers.size(); ++i)
+    {
+        worker_proc<Transport> &w = *workers[i];
+        if(!w.alive)
+        { continue; }
+
+        BatchMsg stop = { 0, true, 0, 0 };
+        w.inbox->push(stop);
+        w.inbox->flush();
+        int status = 0;
+        ::waitpid(w.pid, &status, 0);
+        std::cout << "Worker " << i << " (pid " << w.pid << ") : ran " << w.n_batches << " batches" << std::endl;
+    }
+
+    // Final reports to console and file
+    ss.str("");
+    ss << "ALL DONE" << std::endl
+        << " found " << c_primes << " prime numbers."
+        << " from " << N_NUMBERS << std::endl
+        << "Total time: " << app_timer.elapsed();
+    std::cout << ss.str() << std::endl;
+    std::clog << ss.str() << std::endl;
+
+    std::cout.rdbuf(oldCoutStreamBuf);
+    out.close();
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    // Input params
+    int n_workers = N_THREADS;
+    double delay = DELAY;
+    std::string out_filename = "output_multi_p.txt";
+    size_t batch_size = BATCH_SIZE;
+    std::string workload_type = WORKLOAD;
+    int crash_worker = -1;
+    std::string transport_type = "shm";
+
+    if(argc > 1)
+    {
+        n_workers = std::atoi(argv[1]);
+    }
+    if(argc > 2)
+    {
+        delay = std::atof(argv[2]);
+    }
+    if(argc > 3)
+    {
+        out_filename = argv[3];
+    }
+    if(argc > 4)
+    {
+        batch_size = std::atoi(argv[4]);
+    }
+    if(argc > 5)
+    {
+        workload_type = argv[5];
+    }
+    if(argc > 6)
+    {
+        crash_worker = std::atoi(argv[6]);
+    }
+    if(argc > 7)
+    {
+        transport_type = argv[7];
+    }
+
+    std::clog << "Starting with " << n_workers << " processes : " << batch_size << " per batch : "
+        << N_RUNS << " batches." << std::endl
+        << " With a delay of " << delay << "ms (" << workload_type << ") per function call." << std::endl;
+
+    // measured once, the workers inherit the result and the small primes table with the fork
+    workload_calibration const cal = calibrate_workload(parse_workload(workload_type));
+    small_primes();
+
+    try
+    {
+        if(transport_type == "shm")
+        {
+            shm_transport transport;
+            return run(transport, n_workers, delay, batch_size, cal, crash_worker, out_filename);
+        }
+        socket_transport transport(transport_type);
+        std::clog << "Listening on " << transport.name() << std::endl;
+        return run(transport, n_workers, delay, batch_size, cal, crash_worker, out_filename);
+    }
+    catch(std::string const &e)
+    {
+        std::clog << e << std::endl;
+        return 1;
+    }
+}
@@ -11,18 +11,24 @@
 #include <sstream>
 
 #include "prime.hpp"
+#include "workload.hpp"
+#include "result_writer.hpp"
 #include "chrono.hpp"
 #include "defines.hpp"
 
-/// Params {EXE} {N_THREADS} {DELAY} {OUTPUT_FILENAME}
+/// Params {EXE} {N_THREADS} {DELAY} {OUTPUT_FILENAME} {BATCH_SIZE} {WORKLOAD}
 /// threads doesn't actually create threads but affects how many primes we calculate
-/// Delay in milliseconds (extra time function call takes)
+/// Delay in milliseconds (extra time function call takes), fractions are fine
+/// Batch size only affects how many primes we calculate (same as the threaded version)
+/// Workload what the delay does: alu, cache, dram or state
 int main(int argc, char **argv)
 {
     // Parse input args
     int n_threads = N_THREADS;
-    int delay = DELAY;
+    double delay = DELAY;
     std::string out_filename = "output_single_t.txt";
+    size_t batch_size = BATCH_SIZE;
+    std::string workload_type = WORKLOAD;
 
     if(argc > 1)
     {
@@ -30,40 +36,55 @@ int main(int argc, char **argv)
     }
     if(argc > 2)
     {
-        delay = std::atoi(argv[2]);
+        delay = std::atof(argv[2]);
     }
     if(argc > 3)
     {
         out_filename = argv[3];
     }
+    if(argc > 4)
+    {
+        batch_size = std::atoi(argv[4]);
+    }
+    if(argc > 5)
+    {
+        workload_type = argv[5];
+    }
 
-    // Redirect cout
-    // simpler to print into it, but console is slow as sin
+    // Primes go to a writer thread (same as the threaded version), .bin writes them as binary
+    result_writer out(out_filename, result_writer::mode_for(out_filename));
     std::streambuf* oldCoutStreamBuf = std::cout.rdbuf();
-    std::ofstream fout(out_filename);
-    std::cout.rdbuf(fout.rdbuf());
+    std::cout.rdbuf(out.text_stream());
 
     /// Total number of primes to calculate
-    const size_t N_NUMBERS = n_threads * BATCH_SIZE * N_RUNS;
+    const size_t N_NUMBERS = n_threads * batch_size * N_RUNS;
 
     std::stringstream ss;
     ss << "Startin non-threaded version: with" << std::endl
         << " " << N_NUMBERS << " numbers to check for primes." << std::endl
-        << " With a delay of " << delay << "ms per function call.";
+        << " With a delay of " << delay << "ms (" << workload_type << ") per function call.";
     // Print to the user
     std::clog << ss.str() << std::endl;
     // print to log
     std::cout << ss.str() << std::endl;
+
+    // measure the workload once before the clock starts
+    workload work(calibrate_workload(parse_workload(workload_type)));
+    vl::duration const delay_ns = vl::nanoseconds(int64_t(delay*1e6));
+
+    small_primes();
+
     vl::chrono app_clock;
     size_t count = 0;
-    for(size_t i = 0; i < n_threads*BATCH_SIZE*N_RUNS; ++i)
+    // same batches as the threaded version, one after the other
+    for(size_t base = 0; base < N_NUMBERS; base += batch_size)
     {
-        really_slow_func(delay);
-        if(isPrime(i))
+        work.run(delay_ns*int64_t(batch_size));
+        primes_in_range(base, batch_size, [&out, &count](size_t n)
         {
-            std::cout << i << " is a prime " << std::endl;
+            out.prime(n);
             ++count;
-        }
+        });
     }
 
     ss.str("");
@@ -73,5 +94,8 @@ int main(int argc, char **argv)
     std::cout << ss.str() << std::endl;
     std::clog << ss.str() << std::endl;
 
+    std::cout.rdbuf(oldCoutStreamBuf);
+    out.close();
+
     return 0;
 }
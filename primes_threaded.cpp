@@ -9,112 +9,178 @@
 // @todo Change so that NUMBER of THREADS doesn't affect number of primes checked
 // instead make them distinct and divide the numbers by threads
 // it's hella confusing atm
-// @todo using std::cout for might not be that good since it's thread safe
-// we only call it from the main thread but still we could just use unsafe filestream.
 
-#include "sleep.hpp"
 #include "chrono.hpp"
 
+#include <atomic>
 #include <thread>
 #include <vector>
 #include <cassert>
 #include <fstream>
 #include <sstream>
+#include <utility>
+#include <cstring>
 
 #include "fifo.hpp"
+#include "ring_fifo.hpp"
+#include "mpsc_fifo.hpp"
+#include "ws_scheduler.hpp"
+#include "arena.hpp"
+#include "channel.hpp"
+#include "trace.hpp"
+#include "result_writer.hpp"
+#include "rpc.hpp"
 #include "prime.hpp"
+#include "workload.hpp"
+#include "topology.hpp"
 #include "defines.hpp"
 
-// Valid message types (well 0 is not valid)
-const uint16_t MSG_UNDEFINED = 0;
-const uint16_t MSG_BATCH = 1;
-const uint16_t MSG_RESULTS = 2;
-const uint16_t MSG_EXIT = 3;
+// Message types, the results are in a payload allocated from the sender's arena.
+// The receiver releases the payload when it's done with it.
 
-// @todo for large batches we need to switch to dynamic memory
-struct Message
+/// Range of numbers to check [base, base + count), from the main thread to the workers
+struct BatchMsg
 {
-    Message(uint16_t type) : msg(type), size(0) {}
-    Message() : msg(MSG_UNDEFINED), size(0) {}
+    /// correlation id, the results carry it back
+    uint64_t id;
+    size_t base;
+    size_t count;
+    msg_trace trace;
+};
 
-    uint16_t msg;
-    size_t data[BATCH_SIZE];
+/// Numbers that were primes, from a worker to the main thread
+struct ResultsMsg
+{
+    /// id of the batch
+    uint64_t id;
+    /// which worker sent this
+    uint16_t thread;
     size_t size;
+    size_t *data;
+    /// the trail of the batch these came from
+    msg_trace trace;
+};
+
+/// Last message from a worker before it quits
+struct DoneMsg
+{
+    uint16_t thread;
+    /// where it was running at the end
+    int cpu;
+    worker_stats stats;
 };
 
-#define buffer_t fifo<Message>
+// Either queue works for the worker inboxes, the ring doesn't allocate per message but
+// it has a hard limit for messages in flight (the writer waits when it's full).
+// Readers park on a futex when idle instead of burning the core.
+#ifdef USE_RING_FIFO
+template<typename T> using inbox_t = ring_fifo<T, 64, spin_park>;
+#else
+template<typename T> using inbox_t = fifo<T, spin_park>;
+#endif
+
+// Batches are handed out by a work stealing scheduler
+typedef ws_scheduler<BatchMsg, inbox_t> scheduler_t;
+
+// All the workers push their results to the same queue, the main thread waits on it
+template<typename T> using results_queue_t = mpsc_fifo<T, spin_park>;
+typedef channel<results_queue_t, ResultsMsg, DoneMsg> results_t;
+
+/// How long a reader sleeps before checking again (it's woken up by a push anyway)
+const vl::time WAIT_TIMEOUT(0, 100000);
 
 // worker function
-void primes(buffer_t *in, buffer_t *out, size_t delay)
+void primes(scheduler_t *sched, results_t *out, payload_arena *arena, uint16_t id,
+        workload_calibration cal, vl::duration delay, int cpu)
 {
-    bool cont = true;
-    while (cont)
+    // before anything is allocated so the working set and the results are on our node
+    pin_this_thread(cpu);
+    // every worker has its own working set
+    workload work(cal);
+
+    // reused for every batch so the results can be sent with an exact size payload
+    std::vector<size_t> found;
+    BatchMsg batch;
+    while (sched->next(id, batch))
     {
-        if (!in->empty())
+        batch.trace.mark(TRACE_POPPED);
+        found.clear();
+        // the delay is per number, done in one go
+        work.run(delay*int64_t(batch.count));
+        primes_in_range(batch.base, batch.count, [&found](size_t n) { found.push_back(n); });
+
+        ResultsMsg msg = { batch.id, id, found.size(), arena->allocate_array<size_t>(found.size()), batch.trace };
+        if(!found.empty())
         {
-            auto data = in->pop();
-            switch(data.msg)
-            {
-            case MSG_BATCH:
-            {
-                Message msg(MSG_RESULTS);
-                for(size_t i = 0; i < data.size; ++i)
-                {
-                    really_slow_func(delay);
-                    auto n = data.data[i];
-                    if(isPrime(n))
-                    {
-                        msg.data[msg.size] = n;
-                        ++msg.size;
-                    }
-                }
-                out->push(msg);
-            }
-            break;
-            case MSG_EXIT:
-            {
-                cont = false;
-            }
-            break;
-            default:
-                // just ignore
-                break;
-            }
+            std::memcpy(msg.data, &found[0], msg.size*sizeof(size_t));
         }
+        msg.trace.mark(TRACE_RESULT_PUSHED);
+        out->send(msg);
     }
+
+    out->send(DoneMsg{ id, current_cpu(), sched->stats(id) });
 }
 
-/// @brief read data from threads and print it to standard out
-/// @param in buffers for all threads (an array)
-/// @param n_threads how many threads
-/// @param n_rec OUT how many responses have we got
+/// @brief hand the primes of a batch to the output writer, called when its results arrive
+/// @param data the results
+/// @param out where the primes go
+/// @param traces OUT the trails of the batches we got back
 /// @param c_primes OUT how many primes we found so far
-void read_from_threads(buffer_t *in, const size_t n_threads, size_t &n_rec, size_t &c_primes)
+void write_results(ResultsMsg &data, result_writer &out, trace_sink &traces, size_t &c_primes)
 {
-    for (size_t i = 0; i < n_threads; ++i)
+    data.trace.mark(TRACE_RESULT_POPPED);
+    traces.add(data.trace, data.thread);
+    // only copies the numbers, formatting and the file are on the writer thread
+    for(size_t j = 0; j < data.size; ++j)
     {
-        while (!in[i].empty())
+        out.prime(data.data[j], data.thread);
+    }
+    c_primes += data.size;
+}
+
+/// @brief read data from threads and complete the calls they answer
+/// @param in channel all the threads write to
+/// @param calls the batches we are waiting for
+/// @param n_done OUT how many threads have quit
+void read_from_threads(results_t &in, rpc_client<ResultsMsg> &calls, size_t &n_done)
+{
+    // drain everything the workers have sent so far in one go
+    in.dispatch_all(
+        [&calls](ResultsMsg &data)
         {
-            ++n_rec;
-            auto data = in[i].pop();
-            for(size_t j = 0; j < data.size; ++j)
+            if(!calls.complete(data.id, data))
             {
-                std::cout << data.data[j] << " is a prime (thread: " << i << ")" << std::endl;
-                ++c_primes;
+                std::clog << "Results for an unknown batch " << data.id << std::endl;
             }
-        }
-    }
+            // the callback has copied the primes
+            payload_arena::release(data.data);
+        },
+        [&n_done](DoneMsg &done)
+        {
+            std::cout << "Worker " << done.thread << " (cpu " << done.cpu << ") : ran " << done.stats.executed << " batches, stole "
+                << done.stats.stolen << " (" << done.stats.failed_steals << " failed), busy for "
+                << done.stats.busy << std::endl;
+            ++n_done;
+        });
 }
 
-/// Params {EXE} {N_THREADS} {DELAY} {OUTPUT_FILENAME}
+/// Params {EXE} {N_THREADS} {DELAY} {OUTPUT_FILENAME} {BATCH_SIZE} {WORKLOAD} {TRACE_FILENAME} {PLACEMENT}
 /// N_threads how many workers do we create
-/// Delay in milliseconds (extra time function call takes)
+/// Delay in milliseconds (extra time function call takes), fractions are fine
+/// Batch size how many numbers per message
+/// Workload what the delay does: alu, cache, dram or state
+/// Trace filename where to write the Chrome trace of the batches (optional, - for none)
+/// Placement where the threads run: none, compact, scatter or nosmt
 int main(int argc, char *argv[])
 {
     // Input params
     int n_threads = N_THREADS;
-    int delay = DELAY;
+    double delay = DELAY;
     std::string out_filename = "output_multi_t.txt";
+    size_t batch_size = BATCH_SIZE;
+    std::string workload_type = WORKLOAD;
+    std::string trace_filename;
+    std::string placement_type = PLACEMENT;
 
     if(argc > 1)
     {
@@ -122,98 +188,166 @@ int main(int argc, char *argv[])
     }
     if(argc > 2)
     {
-        delay = std::atoi(argv[2]);
+        delay = std::atof(argv[2]);
     }
     if(argc > 3)
     {
         out_filename = argv[3];
     }
+    if(argc > 4)
+    {
+        batch_size = std::atoi(argv[4]);
+    }
+    if(argc > 5)
+    {
+        workload_type = argv[5];
+    }
+    if(argc > 6 && std::string(argv[6]) != "-")
+    {
+        trace_filename = argv[6];
+    }
+    if(argc > 7)
+    {
+        placement_type = argv[7];
+    }
 
-    // Redirect cout
-    // simpler to print into it, but console is slow as sin
+    // Primes go to a writer thread, file name ending in .bin writes them as binary
+    // cout is redirected to it so the log lines end up in the file in order with the primes
+    result_writer out(out_filename, result_writer::mode_for(out_filename));
     std::streambuf* oldCoutStreamBuf = std::cout.rdbuf();
-    std::ofstream fout(out_filename);
-    std::cout.rdbuf(fout.rdbuf());
+    std::cout.rdbuf(out.text_stream());
 
     /// Total number of primes to calculate
-    const size_t N_NUMBERS  = n_threads * BATCH_SIZE * N_RUNS;
+    const size_t N_NUMBERS  = n_threads * batch_size * N_RUNS;
 
     // print out the starting parameters
     std::stringstream ss;
-    ss << "Starting with " << n_threads << " threads : " << BATCH_SIZE << " per batch : "
+    ss << "Starting with " << n_threads << " threads : " << batch_size << " per batch : "
         << N_RUNS << " batches." << std::endl
         << " Checking " << N_NUMBERS << " numbers for prime number." << std::endl
-        << " With a delay of " << delay << "ms per function call.";
+        << " With a delay of " << delay << "ms (" << workload_type << ") per function call.";
     std::cout << ss.str() << std::endl;
     std::clog << ss.str() << std::endl;
 
+    // measure the workload once before the clock starts, every worker uses the result
+    workload_calibration const cal = calibrate_workload(parse_workload(workload_type));
+    // shared by all the workers, build it before they start
+    small_primes();
+    std::clog << "Workload " << workload_name(cal.profile) << " : " << cal.units_per_ns*1000
+        << " units per us" << std::endl;
+
+    // the main thread gets the first cpu of the plan and worker i the one after it
+    cpu_topology const topo = cpu_topology::detect();
+    placement const place = parse_placement(placement_type);
+    std::vector<int> const cpus = topo.plan(place, n_threads + 1);
+    pin_this_thread(cpus[0]);
+    std::clog << "Topology " << topo << " : placement " << placement_name(place) << std::endl;
+
     // full application clock
     vl::chrono app_timer;
 
-    std::vector<buffer_t> out(n_threads);
-    std::vector<buffer_t> in(n_threads);
+    // a worker that stalls stops getting batches instead of queueing all of them
+    scheduler_t sched(n_threads, vl::time(0, 1000), QUEUE_CAPACITY);
+    // build each worker's inbox and deque on its own cpu, so they are allocated on its NUMA node
+    if(place != PLACE_NONE)
+    {
+        for (size_t i = 0; i < n_threads; ++i)
+        {
+            run_on_cpu(cpus[i + 1], [&sched, i]() { sched.attach(i, N_RUNS); });
+        }
+    }
+    // how often the workers were full and drained again, the callbacks run on different threads
+    std::atomic<size_t> n_high_water(0);
+    std::atomic<size_t> n_low_water(0);
+    for (size_t i = 0; QUEUE_CAPACITY > 1 && i < n_threads; ++i)
+    {
+        sched.credits(i).set_watermarks(QUEUE_CAPACITY, QUEUE_CAPACITY/2,
+            [&n_high_water]() { n_high_water.fetch_add(1, std::memory_order_relaxed); },
+            [&n_low_water]() { n_low_water.fetch_add(1, std::memory_order_relaxed); });
+    }
+    results_t in;
+    trace_sink traces;
     std::vector<std::thread> workers;
+    // one arena per worker for the results
+    // the results are released by us so the arenas have to outlive the workers
+    std::vector<payload_arena> result_arenas(n_threads);
 
     auto clock = vl::chrono();
     // spawn threads
     for (size_t i = 0; i < n_threads; ++i)
     {
-        workers.push_back(std::thread(primes, &out[i], &in[i], delay));
+        workers.push_back(std::thread(primes, &sched, &in, &result_arenas[i], (uint16_t)i,
+                    cal, vl::nanoseconds(int64_t(delay*1e6)), cpus[i + 1]));
     }
 
     std::cout << "Took " << clock.elapsed() << " to create workers." << std::endl;
 
-    // push data to threads
-    // we keep count because we want to continue in the next phase
+    // every batch is a call, the results are written when they come back
+    rpc_client<ResultsMsg> calls(n_threads*N_RUNS);
+    std::vector<rpc_future<ResultsMsg> > batches;
     size_t count = 0;   // how many numbers so far
     size_t c_primes = 0;// how many primes so far
-    size_t n_sent = 0;  // how many messages have we sent
-    size_t n_rec = 0;   // how many messages have we received
+    size_t n_done = 0;  // how many workers have quit
+    auto on_results = [&out, &traces, &c_primes](ResultsMsg &data)
+    {
+        write_results(data, out, traces, c_primes);
+    };
+    // sleeps on the results channel until something comes in
+    auto pump = [&in, &calls, &n_done]()
+    {
+        in.wait(WAIT_TIMEOUT);
+        read_from_threads(in, calls, n_done);
+    };
+
+    // push data to threads
     for (size_t run = 0; run < N_RUNS; ++run)
     {
         std::cout << "Push Data" << std::endl;
         clock.reset();
         for (size_t i = 0; i < n_threads; ++i)
         {
-            ++n_sent;
-            Message msg(MSG_BATCH);
-            msg.size = BATCH_SIZE;
-            for (size_t j = 0; j < BATCH_SIZE; ++j)
-            {
-                // push to the thread
-                msg.data[j] = count;
-                ++count;
-            }
-            out[i].push(msg);
+            batches.push_back(calls.call(on_results));
+            BatchMsg msg = {};
+            msg.id = batches.back().id();
+            msg.base = count;
+            msg.count = batch_size;
+            count += batch_size;
+            uint32_t const trace_id = uint32_t(batches.size());
+            // the starting point, whoever is free first ends up doing it
+            // a full worker's batch goes to the next one with room, we wait if nobody has any,
+            // the trail starts once it has room so the wait isn't counted as queued
+            sched.submit(i, msg, OVERFLOW_SPILL, [trace_id](BatchMsg &m) { m.trace.start(trace_id); });
         }
         std::cout << run << " : Took " << clock.elapsed() << " to push data." << std::endl;
 
-        // sleep to force a context switch (so our workers get going)
-        vl::sleep(1);
-
         std::cout << "Pull data" << std::endl;
         clock.reset();
 
-        read_from_threads(&in[0], n_threads, n_rec, c_primes);
+        read_from_threads(in, calls, n_done);
 
         std::cout << run << " : Took " << clock.elapsed() << " to get data." << std::endl;
+
+#if defined(FIFO_STATS)
+        // the workers keep going while we look, the counters are safe to read from here
+        // the batches wait in the scheduler's queues, the inboxes only carry wake ups
+        for (size_t i = 0; i < n_threads; ++i)
+        {
+            std::cout << run << " : queue " << i << " : " << sched.queue_stats(i) << std::endl;
+        }
+#endif
     }
 
     clock.reset();
-    // Wait for data, we should have same amount of messages in each direction
-    while(n_sent != n_rec)
-    {
-        read_from_threads(&in[0], n_threads, n_rec, c_primes);
-
-        vl::sleep(1);
-    }
+    // Wait for the results of every batch
+    calls.when_all(batches, pump);
     std::cout << "Took " << clock.elapsed() << " to wait for all the data." << std::endl;
  
-    // Cleanup
-    for (size_t i = 0; i < n_threads; ++i)
+    // Cleanup, the workers report their stats on the way out
+    sched.shutdown();
+
+    while(n_done != n_threads)
     {
-        Message msg(MSG_EXIT);
-        out[i].push(msg);
+        pump();
     }
 
     for(size_t i = 0; i < n_threads; ++i)
@@ -226,10 +360,27 @@ int main(int argc, char *argv[])
     ss << "ALL DONE" << std::endl
         << " found " << c_primes << " prime numbers."
         << " from " << N_NUMBERS << std::endl
-        << "Total time: " << app_timer.elapsed();
+        << "Total time: " << app_timer.elapsed() << std::endl
+        << "Queues: " << QUEUE_CAPACITY << " batches per worker, full "
+        << n_high_water.load() << " times, drained " << n_low_water.load() << " times";
     std::cout << ss.str() << std::endl;
     std::clog << ss.str() << std::endl;
 
+    // where the batches spent their time
+    ss.str("");
+    traces.print(ss);
+    std::cout << ss.str();
+    std::clog << ss.str();
+
+    if(!trace_filename.empty())
+    {
+        std::ofstream trace_out(trace_filename);
+        traces.write_chrome_trace(trace_out);
+        std::clog << "Trace written to " << trace_filename << std::endl;
+    }
+
+    std::cout.rdbuf(oldCoutStreamBuf);
+    out.close();
 
     return 0;
 }
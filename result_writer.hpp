@@ -0,0 +1,420 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file result_writer.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef RESULT_WRITER_HPP
+#define RESULT_WRITER_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fifo.hpp"
+
+/// @brief write the decimal digits of v, two at a time
+/// @param v number to format
+/// @param out where to write, needs room for 20 characters
+/// @return one past the last character written
+inline char *format_decimal(uint64_t v, char *out)
+{
+    static constexpr char pairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    // backwards into a scratch buffer, then copy in order
+    char tmp[20];
+    char *p = tmp + sizeof(tmp);
+    while(v >= 100)
+    {
+        unsigned const i = unsigned(v % 100)*2;
+        v /= 100;
+        *--p = pairs[i + 1];
+        *--p = pairs[i];
+    }
+    if(v >= 10)
+    {
+        unsigned const i = unsigned(v)*2;
+        *--p = pairs[i + 1];
+        *--p = pairs[i];
+    }
+    else
+    {
+        *--p = char('0' + v);
+    }
+
+    size_t const n = size_t(tmp + sizeof(tmp) - p);
+    std::memcpy(out, p, n);
+    return out + n;
+}
+
+/** @class result_writer
+ *  @desc Writes the results of the sample to a file from its own thread
+ *  The producer (one thread) appends compact records to a buffer, full buffers go to
+ *  the writer thread over a fifo and come back over another one for reuse. The writer
+ *  formats them and writes the file in large blocks, so the producer never waits
+ *  for the disk or formats numbers (unless all the buffers are in flight).
+ *
+ *  Records are either a prime (number and the worker that found it) or a line of text.
+ *  Text mode writes "n is a prime (thread: t)" and the text lines.
+ *  Binary mode writes only the primes as 8 byte native endian numbers.
+ *
+ *  text_stream is a streambuf that turns everything written to it into text records,
+ *  point std::cout at it and the existing log lines end up in order with the primes.
+ *  std::endl on it ends a record instead of flushing a file.
+ *
+ *  Data is written to the file once a block is full and when the writer is closed.
+*/
+class result_writer
+{
+public:
+    enum mode
+    {
+        TEXT,
+        BINARY
+    };
+
+    /// thread value for primes that don't come from a worker
+    static constexpr uint16_t NO_THREAD = uint16_t(-1);
+
+    /// Producer side buffer size
+    static constexpr size_t BUFFER_SIZE = 64*1024;
+    /// Writer side block size, what is passed to the file at once
+    static constexpr size_t BLOCK_SIZE = 1024*1024;
+
+    /// @brief binary for names ending in .bin, text otherwise
+    static mode mode_for(std::string const &filename)
+    {
+        std::string const ext = ".bin";
+        bool const bin = filename.size() >= ext.size()
+            && filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0;
+        return bin ? BINARY : TEXT;
+    }
+
+    /// @brief Constructor, opens the file and starts the writer thread
+    /// @param filename file to write, truncated
+    /// @param m text or binary
+    /// @param max_buffers how many buffers can be in flight before the producer waits
+    /// @throws std::string if the file can't be opened
+    result_writer(std::string const &filename, mode m = TEXT, size_t max_buffers = 16)
+        : file(std::fopen(filename.c_str(), "wb"))
+        , output_mode(m)
+        , max_in_flight(max_buffers)
+        , current(nullptr)
+        , written(0)
+        , stream(*this)
+        , closed(false)
+    {
+        if(file == nullptr)
+        {
+            throw std::string("Failed to open ") + filename;
+        }
+        // we write in large blocks ourselves
+        std::setvbuf(file, nullptr, _IONBF, 0);
+        writer = std::thread(&result_writer::run, this);
+    }
+
+    /// Destructor, closes if not closed yet
+    ~result_writer()
+    {
+        close();
+    }
+
+    /// @brief add a prime, only the producer
+    /// @param n the prime
+    /// @param thread which worker found it, NO_THREAD to leave it out of the text
+    void prime(uint64_t n, uint16_t thread = NO_THREAD)
+    {
+        char *p = reserve(PRIME_RECORD);
+        p[0] = PRIME;
+        std::memcpy(p + 1, &n, sizeof(n));
+        std::memcpy(p + 1 + sizeof(n), &thread, sizeof(thread));
+    }
+
+    /// @brief add text as is (no newline added), only the producer
+    /// Longer texts than a buffer are split into several records.
+    void text(const char *s, size_t len)
+    {
+        while(len > 0)
+        {
+            size_t const n = len < BUFFER_SIZE - TEXT_HEADER ? len : BUFFER_SIZE - TEXT_HEADER;
+            uint32_t const n32 = uint32_t(n);
+            char *p = reserve(TEXT_HEADER + n);
+            p[0] = TEXT_LINE;
+            std::memcpy(p + 1, &n32, sizeof(n32));
+            std::memcpy(p + TEXT_HEADER, s, n);
+            s += n;
+            len -= n;
+        }
+    }
+
+    void text(std::string const &s)
+    {
+        text(s.data(), s.size());
+    }
+
+    /// @brief streambuf that writes text records, only the producer
+    std::streambuf *text_stream()
+    {
+        return &stream;
+    }
+
+    /// @brief hand the current buffer to the writer even if it isn't full, only the producer
+    void flush()
+    {
+        stream.pubsync();
+        if(current != nullptr && current->used > 0)
+        {
+            filled.push(current);
+            current = nullptr;
+        }
+    }
+
+    /// @brief write everything and wait for the writer to finish, only the producer
+    void close()
+    {
+        if(closed)
+        { return; }
+        closed = true;
+
+        flush();
+        // null is the stop message
+        filled.push(nullptr);
+        writer.join();
+        std::fclose(file);
+
+        // every buffer is back with us, the writer has quit
+        for(size_t i = 0; i < buffers.size(); ++i)
+        {
+            delete buffers[i];
+        }
+        buffers.clear();
+    }
+
+    /// @brief bytes written to the file, valid after close
+    size_t bytes_written() const
+    {
+        return written;
+    }
+
+private:
+    // not copyable, the thread points to us
+    result_writer(result_writer const &);
+    result_writer &operator=(result_writer const &);
+
+    // record tags and sizes
+    static constexpr char PRIME = 'P';
+    static constexpr char TEXT_LINE = 'T';
+    static constexpr size_t PRIME_RECORD = 1 + sizeof(uint64_t) + sizeof(uint16_t);
+    static constexpr size_t TEXT_HEADER = 1 + sizeof(uint32_t);
+    /// longest formatted prime line
+    static constexpr size_t MAX_LINE = 64;
+
+    struct buffer
+    {
+        buffer()
+            : used(0)
+        {}
+
+        char data[BUFFER_SIZE];
+        size_t used;
+    };
+
+    /// Turns stream output into text records, a record per sync (std::endl or flush)
+    class text_buf : public std::streambuf
+    {
+    public:
+        text_buf(result_writer &w)
+            : out(w)
+        {}
+
+    protected:
+        int_type overflow(int_type c)
+        {
+            if(c != traits_type::eof())
+            { pending.push_back(char(c)); }
+            return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char *s, std::streamsize n)
+        {
+            pending.append(s, size_t(n));
+            return n;
+        }
+
+        int sync()
+        {
+            if(!pending.empty())
+            {
+                out.text(pending);
+                pending.clear();
+            }
+            return 0;
+        }
+
+    private:
+        result_writer &out;
+        std::string pending;
+    };
+
+    /// @brief room for n bytes in the current buffer
+    char *reserve(size_t n)
+    {
+        assert(n <= BUFFER_SIZE);
+        if(current == nullptr || current->used + n > BUFFER_SIZE)
+        {
+            if(current != nullptr)
+            { filled.push(current); }
+            current = get_buffer();
+        }
+
+        char *p = current->data + current->used;
+        current->used += n;
+        return p;
+    }
+
+    /// @brief an empty buffer, waits for the writer if all of them are in flight
+    buffer *get_buffer()
+    {
+        buffer *b = nullptr;
+        if(recycled.try_pop(b))
+        { return b; }
+
+        if(buffers.size() < max_in_flight)
+        {
+            b = new buffer;
+            buffers.push_back(b);
+            return b;
+        }
+
+        while(!recycled.pop_wait(b, vl::time(1)))
+        {}
+        return b;
+    }
+
+    /// writer thread
+    void run()
+    {
+        std::vector<char> block(BLOCK_SIZE + BUFFER_SIZE + MAX_LINE);
+        size_t size = 0;
+
+        while(true)
+        {
+            buffer *b = nullptr;
+            if(!filled.pop_wait(b, vl::time(1)))
+            { continue; }
+            if(b == nullptr)
+            { break; }
+
+            size_t pos = 0;
+            while(pos < b->used)
+            {
+                if(size >= BLOCK_SIZE)
+                {
+                    write_block(&block[0], size);
+                    size = 0;
+                }
+                pos = format(b->data, pos, &block[0], size);
+            }
+
+            b->used = 0;
+            recycled.push(b);
+        }
+
+        write_block(&block[0], size);
+    }
+
+    /// @brief format the record at pos, returns the position of the next one
+    size_t format(const char *data, size_t pos, char *block, size_t &size)
+    {
+        if(data[pos] == PRIME)
+        {
+            uint64_t n;
+            uint16_t thread;
+            std::memcpy(&n, data + pos + 1, sizeof(n));
+            std::memcpy(&thread, data + pos + 1 + sizeof(n), sizeof(thread));
+
+            if(output_mode == BINARY)
+            {
+                std::memcpy(block + size, &n, sizeof(n));
+                size += sizeof(n);
+            }
+            else
+            {
+                char *p = format_decimal(n, block + size);
+                p = append(p, " is a prime");
+                if(thread != NO_THREAD)
+                {
+                    p = append(p, " (thread: ");
+                    p = format_decimal(thread, p);
+                    *p++ = ')';
+                }
+                *p++ = '\n';
+                size = size_t(p - block);
+            }
+            return pos + PRIME_RECORD;
+        }
+
+        assert(data[pos] == TEXT_LINE);
+        uint32_t n;
+        std::memcpy(&n, data + pos + 1, sizeof(n));
+        if(output_mode == TEXT)
+        {
+            std::memcpy(block + size, data + pos + TEXT_HEADER, n);
+            size += n;
+        }
+        return pos + TEXT_HEADER + n;
+    }
+
+    static char *append(char *p, const char *s)
+    {
+        size_t const n = std::strlen(s);
+        std::memcpy(p, s, n);
+        return p + n;
+    }
+
+    void write_block(const char *data, size_t size)
+    {
+        if(size > 0)
+        {
+            written += std::fwrite(data, 1, size, file);
+        }
+    }
+
+    std::FILE *file;
+    mode output_mode;
+    size_t max_in_flight;
+
+    // producer only
+    buffer *current;
+    std::vector<buffer *> buffers;
+
+    // filled buffers to the writer and empty ones back
+    fifo<buffer *, spin_park> filled;
+    fifo<buffer *, spin_park> recycled;
+
+    // writer thread only (read after close)
+    size_t written;
+
+    text_buf stream;
+    bool closed;
+    std::thread writer;
+};
+
+#endif  // RESULT_WRITER_HPP
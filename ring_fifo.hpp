@@ -0,0 +1,338 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file ring_fifo.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef RING_FIFO_HPP
+#define RING_FIFO_HPP
+
+#include <atomic>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "cache_line.hpp"
+#include "wait.hpp"
+
+/** @class ring_fifo
+ *  @desc Non locking bounded queue (first in, first out buffer) backed by an array
+ *  Same rules as fifo: one reader and one writer and the responsibilities never change.
+ *
+ *  Elements are stored in a preallocated ring of N slots so push and pop never allocate.
+ *  head is only written by the reader and tail only by the writer, both live on their own
+ *  cache line. Each side keeps a private copy of the other side's index and only reloads
+ *  the shared one when the copy says the buffer is full (writer) or empty (reader).
+ *
+ *  N has to be a power of two so the index wraps with a mask instead of a division.
+ *  Slots hold raw memory, elements are constructed on push and destroyed when popped.
+ *  Wait is the strategy pop_wait uses when the buffer is empty (see wait.hpp).
+*/
+template<typename T, size_t N, typename Wait = busy_spin>
+class ring_fifo
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "ring_fifo capacity has to be a power of two");
+
+public:
+    /// Constructor
+    ring_fifo()
+        : head(0)
+        , cached_tail(0)
+        , tail(0)
+        , cached_head(0)
+        , buffer(std::allocator<T>().allocate(N))
+    {}
+
+    /// Destructor
+    ~ring_fifo()
+    {
+        // elements the reader never got to
+        for(size_t i = head.load(); i != tail.load(); ++i)
+        {
+            buffer[i & MASK].~T();
+        }
+        std::allocator<T>().deallocate(buffer, N);
+    }
+
+    /// @brief push data to back, waits for the reader if the buffer is full
+    /// @param data element to push
+    /// @throws only if copying data throws
+    void push(T const &data)
+    {
+        emplace(data);
+    }
+
+    /// @brief push data to back, waits for the reader if the buffer is full
+    /// @param data element to move into the buffer
+    /// @throws only if moving data throws
+    void push(T &&data)
+    {
+        emplace(std::move(data));
+    }
+
+    /// @brief construct an element in place at the back, waits for the reader if the buffer is full
+    /// @param args arguments passed to the constructor of T
+    /// @throws only if the constructor throws
+    template<typename... Args>
+    void emplace(Args&&... args)
+    {
+        while(!has_room())
+        {
+            std::this_thread::yield();
+        }
+        construct_back(std::forward<Args>(args)...);
+    }
+
+    /// @brief push data to back if there is room
+    /// @param data element to push
+    /// @return true if pushed, false if the buffer was full
+    /// @throws only if copying data throws
+    bool try_push(T const &data)
+    {
+        return try_emplace(data);
+    }
+
+    /// @brief push data to back if there is room
+    /// @param data element to move into the buffer, left untouched if the buffer was full
+    /// @return true if pushed, false if the buffer was full
+    /// @throws only if moving data throws
+    bool try_push(T &&data)
+    {
+        return try_emplace(std::move(data));
+    }
+
+    /// @brief construct an element in place at the back if there is room
+    /// @param args arguments passed to the constructor of T
+    /// @return true if pushed, false if the buffer was full
+    /// @throws only if the constructor throws
+    template<typename... Args>
+    bool try_emplace(Args&&... args)
+    {
+        if(!has_room())
+        {
+            return false;
+        }
+        construct_back(std::forward<Args>(args)...);
+        return true;
+    }
+
+    /// @brief push n elements to back, waits for the reader if they don't fit
+    /// Publishes once for every run of elements that fits in the free space.
+    /// @param first iterator to the first element
+    /// @param n how many elements to push
+    /// @throws only if copying an element throws, runs published before it stay in the buffer
+    template<typename InputIt>
+    void push_n(InputIt first, size_t n)
+    {
+        while(n > 0)
+        {
+            size_t const t = tail.load(std::memory_order_relaxed);
+            size_t room = N - (t - cached_head);
+            if(room < n)
+            {
+                cached_head = head.load(std::memory_order_acquire);
+                room = N - (t - cached_head);
+            }
+            if(room == 0)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            size_t const count = room < n ? room : n;
+            size_t i = 0;
+            try
+            {
+                for(; i < count; ++i, ++first)
+                {
+                    new (&buffer[(t + i) & MASK]) T(*first);
+                }
+            }
+            catch(...)
+            {
+                // nothing of this run was published yet
+                while(i > 0)
+                {
+                    --i;
+                    buffer[(t + i) & MASK].~T();
+                }
+                throw;
+            }
+            tail.store(t + count, std::memory_order_release);
+            waiter.notify();
+            n -= count;
+        }
+    }
+
+    /// @brief pop data from front
+    /// @return the popped element
+    /// @throws on an empty buffer
+    T pop()
+    {
+        if(empty())
+        {
+            throw std::string("empty");
+        }
+
+        size_t const h = head.load(std::memory_order_relaxed);
+        T data(std::move(buffer[h & MASK]));
+        buffer[h & MASK].~T();
+        head.store(h + 1, std::memory_order_release);
+        return data;
+    }
+
+    /// @brief pop data from front if there is any
+    /// @param data OUT the popped element is moved here
+    /// @return true if an element was popped, false if the buffer was empty
+    /// @throws only if moving the element throws
+    bool try_pop(T &data)
+    {
+        return consume_n([&data](T &elem) { data = std::move(elem); }, 1) == 1;
+    }
+
+    /// @brief use the front element in place and pop it
+    /// Avoids copying large elements out of the buffer.
+    /// @param f functor called with a reference to the element, must not throw
+    /// @return true if an element was consumed, false if the buffer was empty
+    template<typename F>
+    bool consume(F f)
+    {
+        return consume_n(f, 1) == 1;
+    }
+
+    /// @brief pop up to max elements, head is moved once for all of them
+    /// @param out output iterator the elements are moved to
+    /// @param max maximum number of elements to pop
+    /// @return number of elements popped
+    template<typename OutputIt>
+    size_t pop_n(OutputIt out, size_t max)
+    {
+        return consume_n([&out](T &data) { *out = std::move(data); ++out; }, max);
+    }
+
+    /// @brief call f for every element that is in the buffer at the moment
+    /// head is moved once at the end so f must not throw.
+    /// @param f functor called with a reference to every element in order
+    /// @return number of elements consumed
+    template<typename F>
+    size_t consume_all(F f)
+    {
+        return consume_n(f, N);
+    }
+
+    /// @brief wait until there is data to read
+    /// @param timeout how long to wait at most
+    /// @return true if there is data, false if we timed out
+    bool wait(vl::time const &timeout)
+    {
+        return waiter.wait([this]() { return !empty(); }, timeout);
+    }
+
+    /// @brief pop data from front, waits for data if the buffer is empty
+    /// @param data OUT the popped element is moved here
+    /// @param timeout how long to wait at most
+    /// @return true if an element was popped, false if we timed out
+    /// @throws only if moving the element throws
+    bool pop_wait(T &data, vl::time const &timeout)
+    {
+        return wait(timeout) && try_pop(data);
+    }
+
+    /// @brief is this buffer empty, only valid from the reader
+    /// @return true if empty, false otherwise
+    bool empty() const
+    {
+        size_t const h = head.load(std::memory_order_relaxed);
+        if(h == cached_tail)
+        {
+            cached_tail = tail.load(std::memory_order_acquire);
+        }
+        return h == cached_tail;
+    }
+
+    /// @brief for compatibility with fifo, the slots are allocated in the constructor
+    void reserve(size_t)
+    {}
+
+    /// @brief how many elements fit in the buffer
+    static size_t capacity()
+    {
+        return N;
+    }
+
+private:
+    // not copyable, the indexes are shared with another thread
+    ring_fifo(ring_fifo const &);
+    ring_fifo &operator=(ring_fifo const &);
+
+    /// @brief is there a free slot at the back, only valid from the writer
+    bool has_room()
+    {
+        size_t const t = tail.load(std::memory_order_relaxed);
+        if(t - cached_head == N)
+        {
+            cached_head = head.load(std::memory_order_acquire);
+        }
+        return t - cached_head != N;
+    }
+
+    /// @brief construct the element in the back slot and publish it, has_room has to be checked first
+    template<typename... Args>
+    void construct_back(Args&&... args)
+    {
+        size_t const t = tail.load(std::memory_order_relaxed);
+        new (&buffer[t & MASK]) T(std::forward<Args>(args)...);
+        tail.store(t + 1, std::memory_order_release);
+        waiter.notify();
+    }
+
+    /// @brief call f for up to max elements and publish the new head once
+    /// The elements are destroyed after f.
+    template<typename F>
+    size_t consume_n(F f, size_t max)
+    {
+        size_t const h = head.load(std::memory_order_relaxed);
+        cached_tail = tail.load(std::memory_order_acquire);
+        size_t count = cached_tail - h;
+        if(count > max)
+        { count = max; }
+
+        for(size_t i = 0; i < count; ++i)
+        {
+            f(buffer[(h + i) & MASK]);
+            buffer[(h + i) & MASK].~T();
+        }
+
+        if(count > 0)
+        {
+            head.store(h + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    static const size_t MASK = N - 1;
+
+    // leading pad so the reader line isn't shared with whatever is before us
+    char pad0[CACHE_LINE_SIZE];
+
+    // reader side: written by pop, read by push when it thinks we are full
+    std::atomic<size_t> head;
+    mutable size_t cached_tail;
+    char pad1[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+    // writer side: written by push, read by pop when it thinks we are empty
+    std::atomic<size_t> tail;
+    size_t cached_head;
+    char pad2[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+    // only the pointer is here, the slots themselves are on the heap
+    T *buffer;
+    Wait waiter;
+};
+
+#endif  // RING_FIFO_HPP
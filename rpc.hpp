@@ -0,0 +1,258 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file rpc.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef RPC_HPP
+#define RPC_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+template<typename Response>
+class rpc_client;
+
+/// @brief handle to a response that hasn't necessarily arrived yet
+/// Just the correlation id, copying it is free. Valid as long as the rpc_client.
+template<typename Response>
+class rpc_future
+{
+public:
+    rpc_future()
+        : client(nullptr)
+        , corr_id(0)
+    {}
+
+    /// @brief correlation id, put it in the request and the responder copies it to the response
+    uint64_t id() const
+    {
+        return corr_id;
+    }
+
+    /// @brief has the response arrived
+    bool ready() const
+    {
+        return client->ready(*this);
+    }
+
+    /// @brief take the response, only once and only when ready
+    /// @throws std::string if it isn't ready or was taken already (or went to a callback)
+    Response get()
+    {
+        return client->take(*this);
+    }
+
+private:
+    friend class rpc_client<Response>;
+
+    rpc_future(rpc_client<Response> *c, uint64_t i)
+        : client(c)
+        , corr_id(i)
+    {}
+
+    rpc_client<Response> *client;
+    uint64_t corr_id;
+};
+
+/** @class rpc_client
+ *  @desc Request and response matching for the caller side of a pair of queues
+ *  Every call gets a correlation id that goes out with the request, the responder copies
+ *  it to the response. When the response comes in the reader hands it to complete() which
+ *  finds the call, runs its callback or keeps the response for the future.
+ *  Replaces counting sent and received messages by hand: the caller knows which requests
+ *  are outstanding and can wait for exactly the ones it needs.
+ *
+ *  Waiting is done by a pump the caller gives: a function that waits on the response queue
+ *  (the queue's wait sleeps until a push wakes it up) and dispatches what came in to
+ *  complete(). when_all returns as soon as the last response has been dispatched.
+ *
+ *      rpc_future<Res> f = rpc.call();
+ *      requests.push(Req{ f.id(), ... });
+ *      rpc.when_all(futures, [&]() { responses.wait(timeout); responses.consume_all(
+ *          [&](Res &r) { rpc.complete(r.id, r); }); });
+ *
+ *  Ids are a slot index and a generation, a slot is reused once its response is taken,
+ *  a late or duplicate response for an old call is ignored.
+ *  Not thread safe, all calls from the thread that reads the responses.
+*/
+template<typename Response>
+class rpc_client
+{
+public:
+    typedef std::function<void(Response &)> callback;
+    typedef rpc_future<Response> future;
+
+    /// @brief Constructor
+    /// @param n_reserve outstanding calls to allocate for up front, more are added when needed
+    explicit rpc_client(size_t n_reserve = 0)
+        : n_outstanding(0)
+    {
+        slots.reserve(n_reserve);
+        free_slots.reserve(n_reserve);
+    }
+
+    /// @brief start a call
+    /// @param on_response called with the response by complete, the future doesn't keep it then
+    /// @return future with the correlation id for the request
+    future call(callback on_response = callback())
+    {
+        if(free_slots.empty())
+        {
+            free_slots.push_back(uint32_t(slots.size()));
+            slots.push_back(slot());
+        }
+        uint32_t const i = free_slots.back();
+        free_slots.pop_back();
+
+        slot &s = slots[i];
+        s.used = true;
+        s.done = false;
+        s.on_response = on_response;
+        ++n_outstanding;
+        return future(this, make_id(i, s.generation));
+    }
+
+    /// @brief a response arrived
+    /// @param id correlation id from the response
+    /// @param r the response, the callback can modify it, otherwise it's copied for the future
+    /// @return false if no call is waiting for this id (late, duplicate or bogus)
+    bool complete(uint64_t id, Response &r)
+    {
+        slot *s = find(id);
+        if(s == nullptr || s->done)
+        {
+            return false;
+        }
+
+        s->done = true;
+        --n_outstanding;
+        if(s->on_response)
+        {
+            // nobody will take it, the slot can go right away
+            callback cb;
+            std::swap(cb, s->on_response);
+            release(uint32_t(id));
+            cb(r);
+        }
+        else
+        {
+            s->response = r;
+        }
+        return true;
+    }
+
+    /// @brief has the response for f arrived (or gone to its callback)
+    bool ready(future const &f) const
+    {
+        slot const *s = find(f.id());
+        return s == nullptr || s->done;
+    }
+
+    /// @brief wait for the responses of all the futures
+    /// @param futures the calls to wait for
+    /// @param pump waits for responses and hands them to complete, called until all are ready
+    template<typename Pump>
+    void when_all(std::vector<future> const &futures, Pump pump)
+    {
+        for(size_t i = 0; i < futures.size(); )
+        {
+            if(ready(futures[i]))
+            { ++i; }
+            else
+            { pump(); }
+        }
+    }
+
+    /// @brief wait until no call is outstanding, for calls with callbacks
+    template<typename Pump>
+    void wait_idle(Pump pump)
+    {
+        while(n_outstanding > 0)
+        {
+            pump();
+        }
+    }
+
+    /// @brief calls without a response yet
+    size_t outstanding() const
+    {
+        return n_outstanding;
+    }
+
+private:
+    friend class rpc_future<Response>;
+
+    struct slot
+    {
+        slot()
+            : generation(0)
+            , used(false)
+            , done(false)
+        {}
+
+        uint32_t generation;
+        bool used;
+        bool done;
+        Response response;
+        callback on_response;
+    };
+
+    // not copyable, the futures point to us
+    rpc_client(rpc_client const &);
+    rpc_client &operator=(rpc_client const &);
+
+    static uint64_t make_id(uint32_t index, uint32_t generation)
+    {
+        return (uint64_t(generation) << 32) | index;
+    }
+
+    /// @brief the slot of a call that hasn't been taken yet, nullptr if there is none
+    slot *find(uint64_t id)
+    {
+        uint32_t const i = uint32_t(id);
+        if(i >= slots.size() || !slots[i].used || slots[i].generation != uint32_t(id >> 32))
+        {
+            return nullptr;
+        }
+        return &slots[i];
+    }
+
+    slot const *find(uint64_t id) const
+    {
+        return const_cast<rpc_client *>(this)->find(id);
+    }
+
+    Response take(future const &f)
+    {
+        slot *s = find(f.id());
+        if(s == nullptr || !s->done)
+        {
+            throw std::string("rpc_client: response isn't ready or was already taken");
+        }
+        Response r = std::move(s->response);
+        release(uint32_t(f.id()));
+        return r;
+    }
+
+    void release(uint32_t i)
+    {
+        slot &s = slots[i];
+        s.used = false;
+        // the old ids don't match anymore
+        ++s.generation;
+        s.response = Response();
+        free_slots.push_back(i);
+    }
+
+    std::vector<slot> slots;
+    std::vector<uint32_t> free_slots;
+    size_t n_outstanding;
+};
+
+#endif  // RPC_HPP
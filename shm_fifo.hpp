@@ -0,0 +1,491 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file shm_fifo.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef SHM_FIFO_HPP
+#define SHM_FIFO_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "cache_line.hpp"
+#include "wait.hpp"
+
+/// Create a new shared memory segment or open one another process created
+enum shm_mode
+{
+    SHM_CREATE,
+    SHM_OPEN
+};
+
+/** @class shm_segment
+ *  @desc Named shared memory (shm_open and mmap)
+ *  The creator owns the name and removes it when destroyed, the mapping itself goes away
+ *  when every process has unmapped it. A segment left behind by a creator that crashed
+ *  is replaced by the next create with the same name.
+ *
+ *  POSIX only, on Windows the constructor throws.
+*/
+class shm_segment
+{
+public:
+    /// @brief Constructor, maps the segment
+    /// @param name segment name, starts with a slash: "/my_queue"
+    /// @param size bytes, an opened segment has to be at least this large
+    /// @param mode create a new one (zero filled) or open an existing one
+    /// @throws std::string if the segment can't be created, opened or mapped
+    shm_segment(std::string const &name, size_t size, shm_mode mode)
+        : seg_name(name)
+        , addr(nullptr)
+        , len(size)
+        , owner(mode == SHM_CREATE)
+    {
+#ifdef _WIN32
+        throw std::string("shm_segment: not supported on Windows");
+#else
+        int fd = -1;
+        if(owner)
+        {
+            fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if(fd < 0 && errno == EEXIST)
+            {
+                // left over from a run that didn't clean up
+                ::shm_unlink(name.c_str());
+                fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            }
+            if(fd >= 0 && ::ftruncate(fd, off_t(size)) != 0)
+            {
+                ::close(fd);
+                ::shm_unlink(name.c_str());
+                throw std::string("shm_segment: failed to size ") + name;
+            }
+        }
+        else
+        {
+            fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+            struct stat st;
+            if(fd >= 0 && (::fstat(fd, &st) != 0 || size_t(st.st_size) < size))
+            {
+                ::close(fd);
+                throw std::string("shm_segment: too small ") + name;
+            }
+        }
+        if(fd < 0)
+        {
+            throw std::string("shm_segment: failed to open ") + name;
+        }
+
+        void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        // the mapping keeps the memory, the descriptor isn't needed anymore
+        ::close(fd);
+        if(p == MAP_FAILED)
+        {
+            if(owner)
+            { ::shm_unlink(name.c_str()); }
+            throw std::string("shm_segment: failed to map ") + name;
+        }
+        addr = p;
+#endif
+    }
+
+    /// Destructor, unmaps and the creator removes the name
+    ~shm_segment()
+    {
+#ifndef _WIN32
+        if(addr != nullptr)
+        { ::munmap(addr, len); }
+        unlink();
+#endif
+    }
+
+    /// @brief remove the name now, processes that have it mapped keep using it
+    /// Only does something in the creator.
+    void unlink()
+    {
+#ifndef _WIN32
+        if(owner)
+        {
+            ::shm_unlink(seg_name.c_str());
+            owner = false;
+        }
+#endif
+    }
+
+    void *data() const
+    {
+        return addr;
+    }
+
+    size_t size() const
+    {
+        return len;
+    }
+
+    std::string const &name() const
+    {
+        return seg_name;
+    }
+
+private:
+    // not copyable, owns the mapping
+    shm_segment(shm_segment const &);
+    shm_segment &operator=(shm_segment const &);
+
+    std::string seg_name;
+    void *addr;
+    size_t len;
+    bool owner;
+};
+
+/** @class shm_fifo
+ *  @desc fifo between two processes, in a shared memory segment
+ *  Same rules and the same algorithm as fifo: a linked list where the writer only touches
+ *  the back, the reader only moves the divider and the writer reclaims the nodes the reader
+ *  has passed. Pointers mean different things in different processes so the links are
+ *  indexes into a fixed pool of N nodes that lives in the segment with the queue state.
+ *  Push and pop are plain loads and stores on the shared memory, the kernel is only
+ *  involved when the reader sleeps (futex, spin_park_shared).
+ *
+ *  At most N - 1 elements are queued, push waits (yields) for the reader when the pool
+ *  is empty and try_push fails.
+ *
+ *  T has to be trivially copyable and must not contain pointers (they'd point to the
+ *  other process's memory). Both processes have to use the same T and N.
+ *
+ *  One process creates the queue and the other opens it with the same name,
+ *  either one can be the writer.
+*/
+template<typename T, size_t N = 1024>
+class shm_fifo
+{
+    static_assert(std::is_trivially_copyable<T>::value, "shm_fifo elements have to be trivially copyable");
+    static_assert(N >= 2 && N < 0xffffffffu, "shm_fifo needs 2 to 2^32 - 2 nodes");
+
+private:
+    /// end of a list
+    static constexpr uint32_t NIL = 0xffffffffu;
+    /// set when the creator has initialised the segment
+    static constexpr uint64_t MAGIC = 0x6d715f73686d6631ull;
+
+    struct node
+    {
+        T data;
+        std::atomic<uint32_t> next;
+    };
+
+    /// everything is in the segment so either process can be the writer
+    struct header
+    {
+        std::atomic<uint64_t> magic;
+        uint32_t capacity;
+        uint32_t element_size;
+        char pad0[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>) - 2*sizeof(uint32_t)];
+
+        // reader side
+        std::atomic<uint32_t> divider;
+        char pad1[CACHE_LINE_SIZE - sizeof(std::atomic<uint32_t>)];
+
+        // writer side, only touched by the writer
+        uint32_t front;
+        uint32_t back;
+        uint32_t free_list;
+        uint32_t free_count;
+        char pad2[CACHE_LINE_SIZE - 4*sizeof(uint32_t)];
+
+        spin_park_shared waiter;
+    };
+
+public:
+    /// @brief bytes of shared memory the queue needs
+    static size_t segment_size()
+    {
+        return sizeof(header) + sizeof(node)*N;
+    }
+
+    /// @brief Constructor
+    /// @param name segment name, starts with a slash
+    /// @param mode SHM_CREATE builds an empty queue, SHM_OPEN attaches to one
+    /// @throws std::string if the segment fails or an opened one isn't a matching queue
+    shm_fifo(std::string const &name, shm_mode mode)
+        : segment(name, segment_size(), mode)
+        , head(static_cast<header *>(segment.data()))
+        , nodes(reinterpret_cast<node *>(static_cast<char *>(segment.data()) + sizeof(header)))
+    {
+        if(mode == SHM_CREATE)
+        {
+            new (head) header;
+            head->capacity = uint32_t(N);
+            head->element_size = uint32_t(sizeof(T));
+
+            // node 0 is the first divider, the rest are free
+            for(uint32_t i = 0; i < N; ++i)
+            {
+                new (&nodes[i].next) std::atomic<uint32_t>(i + 1 < N ? i + 1 : NIL);
+            }
+            nodes[0].next.store(NIL, std::memory_order_relaxed);
+            head->divider.store(0, std::memory_order_relaxed);
+            head->front = head->back = 0;
+            head->free_list = N > 1 ? 1 : NIL;
+            head->free_count = uint32_t(N - 1);
+
+            // the opener checks this last
+            head->magic.store(MAGIC, std::memory_order_release);
+        }
+        else if(head->magic.load(std::memory_order_acquire) != MAGIC
+                || head->capacity != N || head->element_size != sizeof(T))
+        {
+            throw std::string("shm_fifo: ") + name + " isn't a queue of this type";
+        }
+    }
+
+    /// @brief push data to back, waits for the reader if every node is in use
+    void push(T const &data)
+    {
+        while(!try_push(data))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    /// @brief push data to back if there is a free node
+    /// @return true if pushed, false if the queue is full
+    bool try_push(T const &data)
+    {
+        uint32_t const n = get_node();
+        if(n == NIL)
+        {
+            return false;
+        }
+
+        nodes[n].data = data;
+        nodes[n].next.store(NIL, std::memory_order_relaxed);
+        nodes[head->back].next.store(n, std::memory_order_release);
+        head->back = n;
+        head->waiter.notify();
+        return true;
+    }
+
+    /// @brief nothing to do, a push is visible right away
+    /// For code that works with socket_fifo too, it sends on flush.
+    void flush()
+    {}
+
+    /// @brief pop data from front if there is any
+    /// @param data OUT the popped element
+    /// @return true if an element was popped, false if the buffer was empty
+    bool try_pop(T &data)
+    {
+        return consume_n([&data](T const &elem) { data = elem; }, 1) == 1;
+    }
+
+    /// @brief call f for every element in the buffer, the divider is moved once at the end
+    /// @param f functor called with a reference to every element in order, must not throw
+    /// @return number of elements consumed
+    template<typename F>
+    size_t consume_all(F f)
+    {
+        return consume_n(f, size_t(-1));
+    }
+
+    /// @brief wait until there is data to read
+    /// @param timeout how long to wait at most
+    /// @return true if there is data, false if we timed out
+    bool wait(vl::time const &timeout)
+    {
+        return head->waiter.wait([this]() { return !empty(); }, timeout);
+    }
+
+    /// @brief pop data from front, waits for data if the buffer is empty
+    bool pop_wait(T &data, vl::time const &timeout)
+    {
+        return wait(timeout) && try_pop(data);
+    }
+
+    /// @brief is this buffer empty, only valid from the reader
+    bool empty() const
+    {
+        uint32_t const d = head->divider.load(std::memory_order_relaxed);
+        return nodes[d].next.load(std::memory_order_acquire) == NIL;
+    }
+
+    /// @brief remove the name, the processes that have the queue open keep using it
+    /// Call when every process has opened it so a crash can't leave it behind.
+    void unlink()
+    {
+        segment.unlink();
+    }
+
+    /// @brief how many elements fit in the queue
+    static size_t capacity()
+    {
+        return N - 1;
+    }
+
+private:
+    // not copyable, owns the mapping
+    shm_fifo(shm_fifo const &);
+    shm_fifo &operator=(shm_fifo const &);
+
+    template<typename F>
+    size_t consume_n(F f, size_t max)
+    {
+        uint32_t d = head->divider.load(std::memory_order_relaxed);
+        size_t count = 0;
+        while(count < max)
+        {
+            uint32_t const tmp = nodes[d].next.load(std::memory_order_acquire);
+            if(tmp == NIL)
+            { break; }
+
+            f(nodes[tmp].data);
+            d = tmp;
+            ++count;
+        }
+
+        if(count > 0)
+        {
+            head->divider.store(d, std::memory_order_release);
+        }
+        return count;
+    }
+
+    /// @brief a free node, reclaims what the reader has passed if the list is empty
+    uint32_t get_node()
+    {
+        if(head->free_list == NIL)
+        {
+            reclaim();
+        }
+        uint32_t const n = head->free_list;
+        if(n != NIL)
+        {
+            head->free_list = nodes[n].next.load(std::memory_order_relaxed);
+            --head->free_count;
+        }
+        return n;
+    }
+
+    /// @brief move everything the reader is done with to the free list
+    void reclaim()
+    {
+        // acquire so the reader is done with the data before we overwrite it
+        uint32_t const d = head->divider.load(std::memory_order_acquire);
+        while(head->front != d)
+        {
+            uint32_t const tmp = head->front;
+            head->front = nodes[tmp].next.load(std::memory_order_relaxed);
+            nodes[tmp].next.store(head->free_list, std::memory_order_relaxed);
+            head->free_list = tmp;
+            ++head->free_count;
+        }
+    }
+
+    shm_segment segment;
+    header *head;
+    node *nodes;
+};
+
+/** @class shm_doorbell
+ *  @desc One wake up for many shm_fifos, in its own shared memory segment
+ *  A reader of several queues can't sleep on all of their waiters at once. The writers
+ *  ring the bell after they push and the reader sleeps on the bell instead.
+ *
+ *      uint32_t const seen = bell.rings();
+ *      ... read every queue ...
+ *      bell.wait(seen, timeout);
+ *
+ *  wait returns right away if anybody rang after rings() was read, nothing is missed
+ *  between reading the queues and going to sleep. ring is async signal safe (an atomic add
+ *  and a futex wake), a SIGCHLD handler can ring it.
+*/
+class shm_doorbell
+{
+public:
+    /// @brief Constructor
+    /// @param name segment name, starts with a slash
+    /// @param mode SHM_CREATE builds a new bell, SHM_OPEN attaches to one
+    /// @throws std::string if the segment fails or an opened one isn't a doorbell
+    shm_doorbell(std::string const &name, shm_mode mode)
+        : segment(name, sizeof(header), mode)
+        , head(static_cast<header *>(segment.data()))
+    {
+        if(mode == SHM_CREATE)
+        {
+            new (head) header;
+            head->magic.store(MAGIC, std::memory_order_release);
+        }
+        else if(head->magic.load(std::memory_order_acquire) != MAGIC)
+        {
+            throw std::string("shm_doorbell: ") + name + " isn't a doorbell";
+        }
+    }
+
+    /// @brief wake the reader, any process
+    void ring()
+    {
+        head->count.fetch_add(1, std::memory_order_release);
+        head->waiter.notify();
+    }
+
+    /// @brief how many times it has rung, read before looking at the queues
+    uint32_t rings() const
+    {
+        return head->count.load(std::memory_order_acquire);
+    }
+
+    /// @brief sleep until it rings again
+    /// @param seen value of rings() from before the queues were read
+    /// @return true if it rang, false if we timed out
+    bool wait(uint32_t seen, vl::time const &timeout)
+    {
+        return head->waiter.wait([this, seen]() { return rings() != seen; }, timeout);
+    }
+
+    /// @brief remove the name now, only the creator, see shm_segment
+    void unlink()
+    {
+        segment.unlink();
+    }
+
+private:
+    static constexpr uint64_t MAGIC = 0x6d715f62656c6c31ull;
+
+    struct header
+    {
+        header()
+            : magic(0)
+            , count(0)
+        {}
+
+        std::atomic<uint64_t> magic;
+        std::atomic<uint32_t> count;
+        char pad[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>) - sizeof(std::atomic<uint32_t>)];
+        spin_park_shared waiter;
+    };
+
+    // not copyable, owns the mapping
+    shm_doorbell(shm_doorbell const &);
+    shm_doorbell &operator=(shm_doorbell const &);
+
+    shm_segment segment;
+    header *head;
+};
+
+#endif  // SHM_FIFO_HPP
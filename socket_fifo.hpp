@@ -0,0 +1,594 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file socket_fifo.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef SOCKET_FIFO_HPP
+#define SOCKET_FIFO_HPP
+
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "chrono.hpp"
+
+/// Parsed endpoint, "unix:/path/to/socket" or "tcp:host:port"
+/// tcp is meant for other machines, tcp:127.0.0.1:port is the loopback for testing.
+struct socket_address
+{
+    socket_address()
+        : is_unix(true)
+        , port(0)
+    {}
+
+    bool is_unix;
+    /// socket file for unix, host name or address for tcp
+    std::string host;
+    uint16_t port;
+
+    /// @brief parse an endpoint string
+    /// @throws std::string if it isn't unix:PATH or tcp:HOST:PORT
+    static socket_address parse(std::string const &str)
+    {
+        socket_address a;
+        if(str.compare(0, 5, "unix:") == 0 && str.size() > 5)
+        {
+            a.host = str.substr(5);
+            return a;
+        }
+        std::string::size_type const colon = str.rfind(':');
+        if(str.compare(0, 4, "tcp:") == 0 && colon != std::string::npos && colon > 4)
+        {
+            char *end = nullptr;
+            unsigned long const p = std::strtoul(str.c_str() + colon + 1, &end, 10);
+            if(*end == '\0' && end != str.c_str() + colon + 1 && p <= 0xffff)
+            {
+                a.is_unix = false;
+                a.host = str.substr(4, colon - 4);
+                a.port = uint16_t(p);
+                return a;
+            }
+        }
+        throw std::string("socket_address: expected unix:PATH or tcp:HOST:PORT, got ") + str;
+    }
+
+    std::string str() const
+    {
+        return is_unix ? "unix:" + host : "tcp:" + host + ":" + std::to_string(port);
+    }
+};
+
+#ifndef _WIN32
+namespace socket_detail
+{
+    /// @brief sockaddr for an address, resolves tcp host names
+    inline socklen_t to_sockaddr(socket_address const &a, sockaddr_storage &out)
+    {
+        std::memset(&out, 0, sizeof(out));
+        if(a.is_unix)
+        {
+            sockaddr_un *un = reinterpret_cast<sockaddr_un *>(&out);
+            if(a.host.size() >= sizeof(un->sun_path))
+            { throw std::string("socket_address: path too long ") + a.host; }
+            un->sun_family = AF_UNIX;
+            std::memcpy(un->sun_path, a.host.c_str(), a.host.size() + 1);
+            return socklen_t(sizeof(sockaddr_un));
+        }
+
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *res = nullptr;
+        if(::getaddrinfo(a.host.c_str(), std::to_string(a.port).c_str(), &hints, &res) != 0 || res == nullptr)
+        { throw std::string("socket_address: can't resolve ") + a.host; }
+        std::memcpy(&out, res->ai_addr, res->ai_addrlen);
+        socklen_t const len = res->ai_addrlen;
+        ::freeaddrinfo(res);
+        return len;
+    }
+
+    /// @brief the calls never block, waits are done with poll so they can time out
+    inline void set_options(int fd, bool is_unix)
+    {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        if(!is_unix)
+        {
+            // we batch ourselves, Nagle would only add latency to the last batch
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+    }
+
+    /// @brief wait for events on a socket
+    /// @return true if something happened, false on timeout
+    inline bool poll_for(int fd, short events, vl::time const &timeout)
+    {
+        pollfd p = { fd, events, 0 };
+        int const ms = int(timeout.sec*1000 + (timeout.usec + 999)/1000);
+        int const ret = ::poll(&p, 1, ms);
+        return ret > 0;
+    }
+}
+#endif
+
+/** @class socket_listener
+ *  @desc Accepts the connections for socket_fifo
+ *  A unix socket file is removed when the listener is destroyed. Port 0 picks a free port,
+ *  address() has the real one.
+ *
+ *  POSIX only, on Windows the constructor throws.
+*/
+class socket_listener
+{
+public:
+    /// @brief Constructor, binds and listens
+    /// @param addr where to listen, unix:PATH or tcp:HOST:PORT
+    /// @throws std::string if the socket can't be bound
+    explicit socket_listener(std::string const &addr)
+        : fd(-1)
+        , where(socket_address::parse(addr))
+    {
+#ifdef _WIN32
+        throw std::string("socket_listener: not supported on Windows");
+#else
+        sockaddr_storage sa;
+        socklen_t const len = socket_detail::to_sockaddr(where, sa);
+        fd = ::socket(sa.ss_family, SOCK_STREAM, 0);
+        if(fd < 0)
+        { throw std::string("socket_listener: no socket for ") + addr; }
+
+        if(where.is_unix)
+        {
+            // left over from a run that didn't clean up
+            ::unlink(where.host.c_str());
+        }
+        else
+        {
+            int one = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        }
+        if(::bind(fd, reinterpret_cast<sockaddr *>(&sa), len) != 0 || ::listen(fd, 64) != 0)
+        {
+            ::close(fd);
+            throw std::string("socket_listener: failed to listen on ") + addr;
+        }
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        if(!where.is_unix && where.port == 0)
+        {
+            sockaddr_in in;
+            socklen_t in_len = sizeof(in);
+            ::getsockname(fd, reinterpret_cast<sockaddr *>(&in), &in_len);
+            where.port = ntohs(in.sin_port);
+        }
+#endif
+    }
+
+    ~socket_listener()
+    {
+#ifndef _WIN32
+        if(fd >= 0)
+        { ::close(fd); }
+        if(where.is_unix)
+        { ::unlink(where.host.c_str()); }
+#endif
+    }
+
+    /// @brief next connection
+    /// @param timeout how long to wait for one
+    /// @return connected socket for socket_fifo, -1 if nobody connected in time
+    int accept(vl::time const &timeout)
+    {
+#ifdef _WIN32
+        return -1;
+#else
+        if(!socket_detail::poll_for(fd, POLLIN, timeout))
+        { return -1; }
+        int const c = ::accept(fd, nullptr, nullptr);
+        if(c >= 0)
+        { socket_detail::set_options(c, where.is_unix); }
+        return c;
+#endif
+    }
+
+    /// @brief where we are listening, with the real port
+    std::string address() const
+    {
+        return where.str();
+    }
+
+private:
+    // not copyable, owns the socket
+    socket_listener(socket_listener const &);
+    socket_listener &operator=(socket_listener const &);
+
+    int fd;
+    socket_address where;
+};
+
+/// @brief connect to a socket_listener, retries until it's there
+/// @param addr unix:PATH or tcp:HOST:PORT
+/// @param timeout how long to keep trying
+/// @return connected socket for socket_fifo
+/// @throws std::string if the address is bad or we couldn't connect in time
+inline int socket_connect(std::string const &addr, vl::time const &timeout)
+{
+#ifdef _WIN32
+    throw std::string("socket_connect: not supported on Windows");
+#else
+    socket_address const where = socket_address::parse(addr);
+    sockaddr_storage sa;
+    socklen_t const len = socket_detail::to_sockaddr(where, sa);
+
+    vl::chrono clock;
+    while(true)
+    {
+        int const fd = ::socket(sa.ss_family, SOCK_STREAM, 0);
+        if(fd < 0)
+        { throw std::string("socket_connect: no socket for ") + addr; }
+        // blocking connect, the listener's backlog answers right away
+        if(::connect(fd, reinterpret_cast<sockaddr *>(&sa), len) == 0)
+        {
+            socket_detail::set_options(fd, where.is_unix);
+            return fd;
+        }
+        ::close(fd);
+
+        if(clock.elapsed() >= timeout)
+        { throw std::string("socket_connect: failed to connect to ") + addr; }
+        // not listening yet
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+#endif
+}
+
+/** @class socket_fifo
+ *  @desc fifo over a stream socket, to another process or another machine
+ *  Same push and pop calls as the other queues, one end pushes and the other pops.
+ *  Every message is a frame: a header with the length and the bytes of T padded to 8, so
+ *  the reader can check it's getting what it expects.
+ *
+ *  Pushes are collected and sent as one writev (sendmsg) when the batch is full or on
+ *  flush(), so a burst of small messages is a single system call. Messages are only
+ *  sent by flush, call it when a burst is done.
+ *
+ *  The reader receives into a preallocated buffer with as few recv calls as possible and
+ *  the handlers get a reference to the message in that buffer, nothing is copied out.
+ *
+ *  T has to be trivially copyable and must not contain pointers, both ends use the same T.
+ *  A closed or broken connection isn't an error: pushes are dropped and closed() tells.
+ *
+ *  The socket comes from socket_listener::accept or socket_connect (or socketpair),
+ *  the queue owns it. POSIX only.
+*/
+template<typename T>
+class socket_fifo
+{
+    static_assert(std::is_trivially_copyable<T>::value, "socket_fifo elements have to be trivially copyable");
+    static_assert(alignof(T) <= 8, "socket_fifo elements are read in place, 8 byte alignment at most");
+
+private:
+    /// in front of every message
+    struct frame_header
+    {
+        uint32_t length;
+        uint32_t reserved;
+    };
+
+    static constexpr size_t PAYLOAD = (sizeof(T) + 7) & ~size_t(7);
+    static constexpr size_t FRAME = sizeof(frame_header) + PAYLOAD;
+    static constexpr size_t IOV_PER_FRAME = PAYLOAD == sizeof(T) ? 2 : 3;
+#ifdef IOV_MAX
+    static constexpr size_t MAX_IOV = IOV_MAX;
+#else
+    static constexpr size_t MAX_IOV = 16;
+#endif
+
+public:
+    /// messages sent with one system call at most
+    static constexpr size_t MAX_BATCH = MAX_IOV / IOV_PER_FRAME;
+
+    /// @brief Constructor
+    /// @param socket connected stream socket, non blocking (the helpers set that up)
+    /// @param buffer_size bytes of the receive buffer, at least two messages
+    explicit socket_fifo(int socket, size_t buffer_size = 64*1024)
+        : fd(socket)
+        , rx_size(buffer_size < 2*FRAME ? 2*FRAME : buffer_size)
+        , rx(new uint64_t[(rx_size + 7)/8])
+        , rx_begin(0)
+        , rx_end(0)
+        , peer_closed(false)
+    {
+        header.length = uint32_t(sizeof(T));
+        header.reserved = 0;
+        out.reserve(MAX_BATCH);
+#ifndef _WIN32
+        // in case the socket came from somewhere else
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    }
+
+    /// Destructor, sends what's left and closes the socket
+    ~socket_fifo()
+    {
+#ifndef _WIN32
+        flush();
+        ::close(fd);
+#endif
+    }
+
+    /// @brief queue data for sending, sends the batch if it's full
+    void push(T const &data)
+    {
+        out.push_back(data);
+        if(out.size() >= MAX_BATCH)
+        {
+            flush();
+        }
+    }
+
+    /// @brief construct the element in the batch
+    template<typename... Args>
+    void emplace(Args&&... args)
+    {
+        push(T(std::forward<Args>(args)...));
+    }
+
+    /// @brief send everything pushed so far, waits while the socket buffer is full
+    void flush()
+    {
+#ifndef _WIN32
+        if(out.empty())
+        { return; }
+        if(peer_closed)
+        {
+            out.clear();
+            return;
+        }
+
+        static const char zeros[8] = {};
+        iovec iov[MAX_BATCH*IOV_PER_FRAME];
+        size_t n_iov = 0;
+        for(size_t i = 0; i < out.size(); ++i)
+        {
+            iov[n_iov].iov_base = &header;
+            iov[n_iov++].iov_len = sizeof(header);
+            iov[n_iov].iov_base = &out[i];
+            iov[n_iov++].iov_len = sizeof(T);
+            if(IOV_PER_FRAME == 3)
+            {
+                iov[n_iov].iov_base = const_cast<char *>(zeros);
+                iov[n_iov++].iov_len = PAYLOAD - sizeof(T);
+            }
+        }
+
+        // the kernel can take less than everything, continue where it stopped
+        iovec *next = iov;
+        while(n_iov > 0)
+        {
+            msghdr msg;
+            std::memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = next;
+            msg.msg_iovlen = n_iov;
+            // writev with flags, a dead reader is closed() instead of SIGPIPE
+            ssize_t sent = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+            if(sent < 0)
+            {
+                if(errno == EINTR)
+                { continue; }
+                if(errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    socket_detail::poll_for(fd, POLLOUT, vl::time(1));
+                    continue;
+                }
+                peer_closed = true;
+                break;
+            }
+            while(n_iov > 0 && size_t(sent) >= next->iov_len)
+            {
+                sent -= ssize_t(next->iov_len);
+                ++next;
+                --n_iov;
+            }
+            if(n_iov > 0)
+            {
+                next->iov_base = static_cast<char *>(next->iov_base) + sent;
+                next->iov_len -= size_t(sent);
+            }
+        }
+#endif
+        out.clear();
+    }
+
+    /// @brief pop data from front if there is any
+    /// @param data OUT the popped element
+    /// @return true if an element was popped, false if nothing has arrived
+    bool try_pop(T &data)
+    {
+        return consume([&data](T &elem) { data = elem; });
+    }
+
+    /// @brief call f for the front element if there is one
+    /// @return true if an element was consumed
+    template<typename F>
+    bool consume(F f)
+    {
+        return consume_n(f, 1) == 1;
+    }
+
+    /// @brief call f for every element that has arrived
+    /// @param f functor called with a reference to every element (in the receive buffer) in order
+    /// @return number of elements consumed
+    template<typename F>
+    size_t consume_all(F f)
+    {
+        return consume_n(f, size_t(-1));
+    }
+
+    /// @brief wait until there is data to read
+    /// @param timeout how long to wait at most
+    /// @return true if there is data, false if we timed out or the connection is closed
+    bool wait(vl::time const &timeout)
+    {
+#ifndef _WIN32
+        vl::chrono clock;
+        while(!has_frame())
+        {
+            receive();
+            if(has_frame())
+            { break; }
+            vl::time const elapsed = clock.elapsed();
+            if(peer_closed || elapsed >= timeout)
+            { return false; }
+            socket_detail::poll_for(fd, POLLIN, timeout - elapsed);
+        }
+#endif
+        return has_frame();
+    }
+
+    /// @brief pop data from front, waits for data if nothing has arrived
+    bool pop_wait(T &data, vl::time const &timeout)
+    {
+        return wait(timeout) && try_pop(data);
+    }
+
+    /// @brief has nothing arrived, only valid from the reader
+    bool empty() const
+    {
+        receive();
+        return !has_frame();
+    }
+
+    /// @brief has the other end gone away (or the connection failed)
+    bool closed() const
+    {
+        return peer_closed;
+    }
+
+    /// @brief the socket, for polling several queues at once (POLLIN)
+    /// Check empty() first, frames already received aren't seen by poll.
+    int native_handle() const
+    {
+        return fd;
+    }
+
+private:
+    // not copyable, owns the socket
+    socket_fifo(socket_fifo const &);
+    socket_fifo &operator=(socket_fifo const &);
+
+    char *rx_data() const
+    {
+        return reinterpret_cast<char *>(rx.get());
+    }
+
+    bool has_frame() const
+    {
+        return rx_end - rx_begin >= FRAME;
+    }
+
+    /// @brief read what has arrived into the buffer, never blocks
+    /// @return true if the buffer filled up, there could be more waiting
+    bool receive() const
+    {
+#ifdef _WIN32
+        return false;
+#else
+        // make room at the end, only a partial frame is moved
+        if(rx_size - rx_end < FRAME)
+        {
+            std::memmove(rx_data(), rx_data() + rx_begin, rx_end - rx_begin);
+            rx_end -= rx_begin;
+            rx_begin = 0;
+        }
+        while(rx_end < rx_size && !peer_closed)
+        {
+            ssize_t const n = ::recv(fd, rx_data() + rx_end, rx_size - rx_end, 0);
+            if(n > 0)
+            {
+                rx_end += size_t(n);
+                continue;
+            }
+            if(n < 0 && errno == EINTR)
+            { continue; }
+            if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            { return false; }
+            // orderly shutdown or a broken connection
+            peer_closed = true;
+        }
+        return rx_end == rx_size;
+#endif
+    }
+
+    template<typename F>
+    size_t consume_n(F f, size_t max)
+    {
+        size_t count = 0;
+        bool more = true;
+        while(count < max && more)
+        {
+            more = receive();
+            if(!has_frame())
+            { break; }
+
+            while(count < max && has_frame())
+            {
+                frame_header h;
+                std::memcpy(&h, rx_data() + rx_begin, sizeof(h));
+                if(h.length != sizeof(T))
+                {
+                    throw std::string("socket_fifo: frame of ") + std::to_string(h.length)
+                        + " bytes, expected " + std::to_string(sizeof(T));
+                }
+                f(*reinterpret_cast<T *>(rx_data() + rx_begin + sizeof(h)));
+                rx_begin += FRAME;
+                ++count;
+            }
+        }
+        if(rx_begin == rx_end)
+        {
+            rx_begin = rx_end = 0;
+        }
+        return count;
+    }
+
+    int fd;
+    frame_header header;
+    // messages waiting for flush
+    std::vector<T> out;
+
+    // receiving is done by the const empty() too, it only moves data from the kernel to us
+    size_t rx_size;
+    std::unique_ptr<uint64_t[]> rx;
+    mutable size_t rx_begin;
+    mutable size_t rx_end;
+    mutable bool peer_closed;
+};
+
+#endif  // SOCKET_FIFO_HPP
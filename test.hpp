@@ -0,0 +1,34 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef TEST_HPP
+#define TEST_HPP
+
+#include <iostream>
+
+/// Helpers shared by the test executables, each one is a single translation unit.
+/// main returns test_result() so ctest sees the failures.
+
+static int n_failed = 0;
+
+template<typename T>
+void check(T a, T b, const char *msg)
+{
+    if (!(a == b))
+    {
+        std::cerr << "TEST FAILED : " << msg << std::endl;
+        ++n_failed;
+    }
+}
+
+inline int test_result()
+{
+    return n_failed == 0 ? 0 : 1;
+}
+
+#endif  // TEST_HPP
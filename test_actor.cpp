@@ -0,0 +1,197 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_actor.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "actor.hpp"
+#include "test.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Update
+{
+    int sender;
+    int seq;
+};
+
+/// messages from every sender come in the order they were sent
+void test_order()
+{
+    const int N_SENDERS = 3;
+    const int N = 10000;
+
+    actor_system sys(2, 16);
+    std::vector<int> last(N_SENDERS, 0);
+    bool in_order = true;
+    long count = 0;
+    actor<Update> *a = sys.spawn<Update>([&last, &in_order, &count](Update &u)
+    {
+        in_order = in_order && u.seq == last[u.sender] + 1;
+        last[u.sender] = u.seq;
+        ++count;
+    });
+
+    std::vector<std::thread> senders;
+    for(int s = 0; s < N_SENDERS; ++s)
+    {
+        senders.push_back(std::thread([a, s]()
+        {
+            for(int i = 1; i <= N; ++i)
+            {
+                a->send(Update{ s, i });
+                if(i % 256 == 0)
+                { std::this_thread::yield(); }
+            }
+        }));
+    }
+    for(size_t s = 0; s < senders.size(); ++s)
+    {
+        senders[s].join();
+    }
+    sys.shutdown();
+
+    check(count, (long)N_SENDERS*N, "every message handled");
+    check(in_order, true, "in order per sender");
+
+    actor_stats st = a->stats();
+    check(st.sent, (size_t)N_SENDERS*N, "sent");
+    check(st.processed, st.sent, "processed");
+    check(st.depth, (size_t)0, "mailbox empty");
+    check(st.turns > 0, true, "turns");
+    // a turn that found nothing isn't counted
+    check(st.turns <= st.processed, true, "every turn handled something");
+    check(st.max_depth > 0, true, "max depth");
+    check(st.max_depth <= st.sent, true, "max depth no more than sent");
+    check(st.run_time.count() > 0, true, "run time");
+}
+
+/// a busy actor gives the thread up after its budget
+void test_budget()
+{
+    const size_t BUDGET = 8;
+    const int N = 100;
+
+    actor_system sys(1, BUDGET);
+    std::vector<char> log;
+    actor<int> *a = sys.spawn<int>([&log](int &) { log.push_back('a'); });
+    actor<int> *b = sys.spawn<int>([&log](int &) { log.push_back('b'); });
+    // gate holds the thread while the mailboxes fill up
+    std::atomic<bool> open(false);
+    actor<int> *gate = sys.spawn<int>([&open](int &)
+    {
+        while(!open.load())
+        { std::this_thread::yield(); }
+    });
+
+    gate->send(0);
+    for(int i = 0; i < N; ++i)
+    {
+        a->send(i);
+        b->send(i);
+    }
+    open.store(true);
+    sys.shutdown();
+
+    check(log.size(), (size_t)2*N, "all handled");
+    // the first actor can't run longer than its budget before the other gets a turn
+    size_t longest = 0;
+    size_t run = 0;
+    for(size_t i = 0; i < log.size(); ++i)
+    {
+        run = (i > 0 && log[i] == log[i-1]) ? run + 1 : 1;
+        longest = run > longest ? run : longest;
+    }
+    check(longest, BUDGET, "runs of one actor at most the budget");
+    check(a->stats().turns, (size_t)N/BUDGET + 1, "turns of a");
+    check(a->stats().max_depth, (size_t)N, "depth when the first turn started");
+}
+
+/// hundreds of stateful actors on two threads sending to each other
+void test_many()
+{
+    const int N_ACTORS = 500;
+    const int N_ROUNDS = 20;
+
+    struct Token
+    {
+        int hops;
+    };
+
+    actor_system sys(2);
+    std::vector<actor<Token> *> ring(N_ACTORS, nullptr);
+    std::vector<int> seen(N_ACTORS, 0);
+    for(int i = 0; i < N_ACTORS; ++i)
+    {
+        // state in the handler, the next actor is looked up when it runs
+        ring[i] = sys.spawn<Token>([&ring, &seen, i, N_ACTORS](Token &t)
+        {
+            ++seen[i];
+            if(t.hops > 1)
+            {
+                ring[(i + 1) % N_ACTORS]->send(Token{ t.hops - 1 });
+            }
+        }, 4);
+    }
+
+    for(int i = 0; i < N_ACTORS; ++i)
+    {
+        ring[i]->send(Token{ N_ROUNDS });
+    }
+    sys.shutdown();
+
+    check(sys.actor_count(), (size_t)N_ACTORS, "actors");
+    long total = 0;
+    bool same = true;
+    for(int i = 0; i < N_ACTORS; ++i)
+    {
+        total += seen[i];
+        same = same && seen[i] == N_ROUNDS;
+    }
+    check(total, (long)N_ACTORS*N_ROUNDS, "every hop");
+    check(same, true, "every actor got every round");
+
+    std::vector<actor_stats> stats = sys.stats();
+    check(stats.size(), (size_t)N_ACTORS, "stats for every actor");
+    size_t processed = 0;
+    for(size_t i = 0; i < stats.size(); ++i)
+    {
+        processed += stats[i].processed;
+    }
+    check(processed, (size_t)N_ACTORS*N_ROUNDS, "processed");
+}
+
+/// one sender, the cheaper mailbox
+void test_spsc()
+{
+    const int N = 10000;
+    actor_system sys(2, 32);
+    long sum = 0;
+    actor<int, spsc_mailbox> *a = sys.spawn<int, spsc_mailbox>([&sum](int &v) { sum += v; });
+    for(int i = 1; i <= N; ++i)
+    {
+        a->send(i);
+    }
+    sys.shutdown();
+    check(sum, (long)N*(N + 1)/2, "spsc mailbox");
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING actor test" << std::endl;
+
+    test_order();
+    test_budget();
+    test_many();
+    test_spsc();
+
+    std::cout << "actor test ENDED" << std::endl;
+
+    return test_result();
+}
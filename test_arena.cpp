@@ -0,0 +1,93 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_arena.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "arena.hpp"
+#include "fifo.hpp"
+#include "test.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <thread>
+
+/// payloads released by another thread come back to the owner and are reused
+void test_threaded_release()
+{
+    const size_t N = 10000;
+
+    payload_arena arena;
+    fifo<size_t *, spin_yield> to_reader;
+    bool ok = true;
+
+    std::thread reader([&to_reader, &ok]()
+    {
+        size_t *p = nullptr;
+        for(size_t i = 0; i < N; ++i)
+        {
+            if(!to_reader.pop_wait(p, vl::time(5)))
+            {
+                ok = false;
+                return;
+            }
+            ok = ok && p[0] == i && p[i % 16] == i;
+            payload_arena::release(p);
+        }
+    });
+
+    for(size_t i = 0; i < N; ++i)
+    {
+        size_t *p = arena.allocate_array<size_t>(16);
+        for(size_t j = 0; j < 16; ++j)
+        { p[j] = i; }
+        to_reader.push(p);
+    }
+    reader.join();
+
+    check(ok, true, "payload_arena threaded payloads");
+    arena.collect();
+    check(arena.allocated(), (size_t)0, "payload_arena threaded release");
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING arena test" << std::endl;
+
+    payload_arena arena;
+
+    char *a = static_cast<char *>(arena.allocate(10));
+    char *b = static_cast<char *>(arena.allocate(100));
+    std::memset(a, 1, 10);
+    std::memset(b, 2, 100);
+    check(arena.allocated(), (size_t)2, "payload_arena allocated");
+    check(a != b, true, "payload_arena distinct blocks");
+    check((size_t)a % alignof(std::max_align_t), (size_t)0, "payload_arena alignment");
+
+    // released blocks are reused once the owner has collected them
+    payload_arena::release(a);
+    check(arena.allocated(), (size_t)2, "payload_arena not collected");
+    arena.collect();
+    check(arena.allocated(), (size_t)1, "payload_arena collected");
+    char *c = static_cast<char *>(arena.allocate(20));
+    check(c == a, true, "payload_arena reuse");
+
+    // larger than any size class
+    char *big = static_cast<char *>(arena.allocate(16*1024*1024));
+    big[16*1024*1024 - 1] = 3;
+
+    payload_arena::release(b);
+    payload_arena::release(c);
+    payload_arena::release(big);
+    payload_arena::release(nullptr);
+    arena.collect();
+    check(arena.allocated(), (size_t)0, "payload_arena all released");
+
+    test_threaded_release();
+
+    std::cout << "arena test ENDED" << std::endl;
+
+    return test_result();
+}
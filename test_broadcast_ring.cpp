@@ -0,0 +1,226 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_broadcast_ring.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "broadcast_ring.hpp"
+#include "test.hpp"
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef broadcast_ring<size_t, 16, spin_yield> gated_t;
+
+/// torn copies show up as a != ~b
+struct pair_entry
+{
+    uint64_t a;
+    uint64_t b;
+};
+typedef broadcast_ring<pair_entry, 64, spin_yield, BROADCAST_LOSSY> lossy_t;
+
+const vl::time TIMEOUT(10);
+
+void test_gated()
+{
+    gated_t ring(2);
+
+    // nobody to wait for
+    for(size_t i = 0; i < 3*gated_t::capacity(); ++i)
+    { ring.push(i); }
+    check(ring.position(), (uint64_t)48, "publish without readers");
+
+    gated_t::reader first(ring);
+    check(first.empty(), true, "a new reader starts at the end");
+    ring.push(100);
+    ring.push(101);
+
+    gated_t::reader *second = new gated_t::reader(ring);
+    ring.push(102);
+
+    std::vector<size_t> got;
+    check(first.consume_all([&got](size_t const &v) { got.push_back(v); }), (size_t)3, "first reader count");
+    check(got == std::vector<size_t>{ 100, 101, 102 }, true, "first reader sees everything after joining");
+
+    size_t v = 0;
+    check(second->try_read(v), true, "second reader has one");
+    check(v, (size_t)102, "second reader starts where it joined");
+    check(second->try_read(v), false, "second reader up to date");
+
+    // the second reader stops, the ring fills up to it
+    size_t pushed = 0;
+    while(ring.try_push(pushed))
+    { ++pushed; }
+    check(pushed, gated_t::capacity(), "gated by the slowest reader");
+    check(first.consume_all([](size_t const &) {}), gated_t::capacity(), "first reader catches up");
+    check(ring.try_push(0), false, "still gated by the second reader");
+
+    bool thrown = false;
+    try { gated_t::reader third(ring); }
+    catch(std::string const &) { thrown = true; }
+    check(thrown, true, "too many readers");
+    check(ring.readers(), (size_t)2, "readers");
+
+    // leaving lets the writer go on
+    delete second;
+    check(ring.readers(), (size_t)1, "reader left");
+    check(ring.try_push(0), true, "not gated by a reader that left");
+}
+
+void test_gated_strings()
+{
+    broadcast_ring<std::string, 4> ring;
+    broadcast_ring<std::string, 4>::reader r(ring);
+    bool same = true;
+    for(size_t i = 0; i < 20; ++i)
+    {
+        ring.push(std::string(100, char('a' + i)));
+        std::string s;
+        same = same && r.try_read(s) && s == std::string(100, char('a' + i));
+    }
+    // some left in the ring for the destructor
+    ring.push("left");
+    check(same, true, "strings through the ring");
+}
+
+/// every reader sees every entry in order
+void test_gated_threaded()
+{
+    const size_t N_READERS = 8;
+    const size_t N_ENTRIES = 100000;
+
+    gated_t ring;
+    std::vector<size_t> sums(N_READERS, 0);
+    std::vector<int> in_order(N_READERS, 0);
+
+    // join before the writer starts so nobody misses the start
+    std::vector<gated_t::reader *> readers;
+    for(size_t r = 0; r < N_READERS; ++r)
+    { readers.push_back(new gated_t::reader(ring)); }
+
+    std::vector<std::thread> threads;
+    for(size_t r = 0; r < N_READERS; ++r)
+    {
+        threads.push_back(std::thread([&, r]()
+        {
+            size_t expected = 0;
+            bool ok = true;
+            while(expected < N_ENTRIES && readers[r]->wait(TIMEOUT))
+            {
+                readers[r]->consume_all([&](size_t const &v)
+                {
+                    ok = ok && v == expected;
+                    sums[r] += v;
+                    ++expected;
+                });
+            }
+            in_order[r] = ok && expected == N_ENTRIES;
+        }));
+    }
+
+    for(size_t i = 0; i < N_ENTRIES; ++i)
+    { ring.push(i); }
+
+    for(size_t r = 0; r < N_READERS; ++r)
+    {
+        threads[r].join();
+        delete readers[r];
+    }
+
+    bool all = true;
+    for(size_t r = 0; r < N_READERS; ++r)
+    { all = all && in_order[r] && sums[r] == N_ENTRIES*(N_ENTRIES - 1)/2; }
+    check(all, true, "gated every reader sees every entry");
+}
+
+void test_lossy()
+{
+    lossy_t ring;
+    lossy_t::reader r(ring);
+    size_t const n = 3*lossy_t::capacity();
+    for(uint64_t i = 0; i < n; ++i)
+    { ring.push(pair_entry{ i, ~i }); }
+    // the writer never waits
+    check(ring.try_push(pair_entry{ n, ~uint64_t(n) }), true, "lossy never full");
+
+    std::vector<uint64_t> got;
+    r.consume_all([&got](pair_entry const &e) { got.push_back(e.a); });
+    check(got.size(), lossy_t::capacity(), "lapped reader gets what is in the ring");
+    check(got.front(), uint64_t(n + 1 - lossy_t::capacity()), "oldest entry still in the ring");
+    check(r.missed(), uint64_t(n + 1 - lossy_t::capacity()), "missed count");
+}
+
+/// readers skip but never see a torn or out of order entry
+void test_lossy_threaded()
+{
+    const size_t N_READERS = 4;
+    const uint64_t N_ENTRIES = 200000;
+
+    lossy_t ring;
+    std::vector<lossy_t::reader *> readers;
+    for(size_t r = 0; r < N_READERS; ++r)
+    { readers.push_back(new lossy_t::reader(ring)); }
+
+    std::vector<int> ok(N_READERS, 0);
+    std::vector<uint64_t> seen(N_READERS, 0);
+    std::vector<std::thread> threads;
+    for(size_t r = 0; r < N_READERS; ++r)
+    {
+        threads.push_back(std::thread([&, r]()
+        {
+            lossy_t::reader &rd = *readers[r];
+            bool good = true;
+            uint64_t last = 0;
+            bool first = true;
+            while(rd.position() < N_ENTRIES && rd.wait(TIMEOUT))
+            {
+                rd.consume_all([&](pair_entry const &e)
+                {
+                    good = good && e.b == ~e.a && (first || e.a > last);
+                    first = false;
+                    last = e.a;
+                    ++seen[r];
+                });
+            }
+            ok[r] = good && rd.position() == N_ENTRIES && seen[r] + rd.missed() == N_ENTRIES;
+        }));
+    }
+
+    for(uint64_t i = 0; i < N_ENTRIES; ++i)
+    {
+        ring.push(pair_entry{ i, ~i });
+        if(i % 1024 == 0)
+        { std::this_thread::yield(); }
+    }
+
+    for(size_t r = 0; r < N_READERS; ++r)
+    {
+        threads[r].join();
+        delete readers[r];
+    }
+
+    bool all = true;
+    for(size_t r = 0; r < N_READERS; ++r)
+    { all = all && ok[r]; }
+    check(all, true, "lossy readers see whole entries in order");
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING broadcast_ring test" << std::endl;
+
+    test_gated();
+    test_gated_strings();
+    test_gated_threaded();
+    test_lossy();
+    test_lossy_threaded();
+
+    std::cout << "broadcast_ring test ENDED" << std::endl;
+
+    return test_result();
+}
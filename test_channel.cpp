@@ -0,0 +1,89 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_channel.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "channel.hpp"
+#include "fifo.hpp"
+#include "mpsc_fifo.hpp"
+#include "test.hpp"
+
+#include <iostream>
+#include <string>
+#include <thread>
+
+template<typename T> using spsc = fifo<T>;
+template<typename T> using mpsc = mpsc_fifo<T, spin_park>;
+
+struct PingMsg
+{
+    int seq;
+};
+
+struct TextMsg
+{
+    std::string text;
+};
+
+struct ExitMsg
+{};
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING channel test" << std::endl;
+
+    {
+        channel<spsc, PingMsg, TextMsg, ExitMsg> chan;
+        check(chan.empty(), true, "channel not empty");
+
+        chan.send(PingMsg{ 1 });
+        chan.emplace<TextMsg>(TextMsg{ "hello" });
+        chan.send(PingMsg{ 2 });
+        chan.send(ExitMsg());
+
+        int pings = 0;
+        std::string text;
+        bool exit = false;
+        // one handler per type, in any order
+        check(chan.dispatch([&pings](PingMsg &m) { pings += m.seq; },
+                    [&text](TextMsg &m) { text = m.text; },
+                    [&exit](ExitMsg &) { exit = true; }), true, "channel dispatch");
+        check(pings, 1, "channel dispatch ping");
+
+        check(chan.dispatch_all([&exit](ExitMsg &) { exit = true; },
+                    [&pings](PingMsg &m) { pings += m.seq; },
+                    [&text](TextMsg &m) { text = m.text; }), (size_t)3, "channel dispatch_all");
+        check(pings, 3, "channel dispatch_all ping");
+        check(text, std::string("hello"), "channel dispatch_all text");
+        check(exit, true, "channel dispatch_all exit");
+        check(chan.empty(), true, "channel not empty");
+    }
+
+    {
+        // many writers, catch all handler for the rest of the types
+        channel<mpsc, PingMsg, ExitMsg> chan;
+        const int N = 1000;
+        std::thread a([&chan]() { for(int i = 0; i < N; ++i) { chan.send(PingMsg{ 1 }); } chan.send(ExitMsg()); });
+        std::thread b([&chan]() { for(int i = 0; i < N; ++i) { chan.send(PingMsg{ 1 }); } chan.send(ExitMsg()); });
+
+        int pings = 0;
+        int exits = 0;
+        while(exits < 2 && chan.wait(vl::time(5)))
+        {
+            chan.dispatch_all([&pings](PingMsg &m) { pings += m.seq; },
+                    [&exits](auto &) { ++exits; });
+        }
+        a.join();
+        b.join();
+
+        check(pings, 2*N, "channel many writers");
+        check(exits, 2, "channel many writers exit");
+    }
+
+    std::cout << "channel test ENDED" << std::endl;
+
+    return test_result();
+}
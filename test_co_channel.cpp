@@ -0,0 +1,183 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_co_channel.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "co_channel.hpp"
+#include "test.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+co_task producer(co_channel<int> &out, int n, size_t &max_size)
+{
+    for(int i = 1; i <= n; ++i)
+    {
+        co_await out.push(i);
+        max_size = out.size() > max_size ? out.size() : max_size;
+    }
+    out.close();
+}
+
+co_task consumer(co_channel<int> &in, long &sum, int &count)
+{
+    while(std::optional<int> v = co_await in.pop())
+    {
+        // in order
+        if(*v != count + 1)
+        { co_return; }
+        sum += *v;
+        ++count;
+    }
+}
+
+void test_pipeline()
+{
+    co_executor exec;
+    co_channel<int> chan(exec, 2);
+    long sum = 0;
+    int count = 0;
+    size_t max_size = 0;
+
+    // the consumer first so it waits on an empty channel
+    exec.spawn(consumer(chan, sum, count));
+    exec.spawn(producer(chan, 1000, max_size));
+    check(exec.size(), (size_t)2, "two tasks");
+    exec.run();
+
+    check(count, 1000, "every value in order");
+    check(sum, 1000L*1001/2, "sum");
+    check(max_size <= 2, true, "never over the capacity");
+    check(exec.size(), (size_t)0, "tasks finished");
+}
+
+co_task push_closed(co_channel<int> &out, bool &accepted)
+{
+    accepted = co_await out.push(1);
+}
+
+co_task thrower(bool fail)
+{
+    if(fail)
+    { throw std::string("from a task"); }
+    co_return;
+}
+
+void test_close()
+{
+    co_executor exec;
+    co_channel<int> chan(exec, 1);
+    check(chan.try_push(1), true, "try_push");
+    check(chan.try_push(2), false, "try_push full");
+    int v = 0;
+    check(chan.try_pop(v) && v == 1, true, "try_pop");
+
+    chan.close();
+    bool accepted = true;
+    exec.spawn(push_closed(chan, accepted));
+    exec.run();
+    check(accepted, false, "push to a closed channel");
+
+    // the task waiting forever is destroyed with the executor
+    {
+        co_executor other;
+        co_channel<int> never(other, 1);
+        long sum = 0;
+        int count = 0;
+        other.spawn(consumer(never, sum, count));
+        check(other.poll(), (size_t)1, "started");
+        check(other.poll(), (size_t)0, "waiting, nothing to resume");
+    }
+}
+
+void test_exception()
+{
+    co_executor exec;
+    exec.spawn(thrower(true));
+    bool thrown = false;
+    try { exec.run(); }
+    catch(std::string const &) { thrown = true; }
+    check(thrown, true, "exception out of run");
+    check(exec.size(), (size_t)0, "thrower is gone");
+}
+
+/// one stream of updates to an object
+co_task stream(co_channel<int> &in, std::atomic<long> &total)
+{
+    long sum = 0;
+    while(std::optional<int> v = co_await in.pop())
+    {
+        sum += *v;
+    }
+    total.fetch_add(sum);
+}
+
+/// thousands of streams on two threads, fed from a third
+void test_many()
+{
+    const size_t N_STREAMS = 10000;
+    const size_t N_THREADS = 2;
+    const int N_UPDATES = 10;
+
+    std::atomic<long> total(0);
+    std::vector<std::unique_ptr<co_executor> > execs;
+    std::vector<std::unique_ptr<co_channel<int> > > chans;
+    for(size_t t = 0; t < N_THREADS; ++t)
+    {
+        execs.emplace_back(new co_executor);
+    }
+    for(size_t i = 0; i < N_STREAMS; ++i)
+    {
+        co_executor &e = *execs[i % N_THREADS];
+        chans.emplace_back(new co_channel<int>(e, 4));
+        e.spawn(stream(*chans.back(), total));
+    }
+
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < N_THREADS; ++t)
+    {
+        threads.push_back(std::thread([&execs, t]() { execs[t]->run(); }));
+    }
+
+    long expected = 0;
+    for(int u = 1; u <= N_UPDATES; ++u)
+    {
+        for(size_t i = 0; i < N_STREAMS; ++i)
+        {
+            chans[i]->post(u);
+            expected += u;
+        }
+    }
+    for(size_t i = 0; i < N_STREAMS; ++i)
+    {
+        co_channel<int> *c = chans[i].get();
+        execs[i % N_THREADS]->post([c]() { c->close(); });
+    }
+
+    for(size_t t = 0; t < threads.size(); ++t)
+    {
+        threads[t].join();
+    }
+    check(total.load(), expected, "every update to every stream");
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING co_channel test" << std::endl;
+
+    test_pipeline();
+    test_close();
+    test_exception();
+    test_many();
+
+    std::cout << "co_channel test ENDED" << std::endl;
+
+    return test_result();
+}
@@ -0,0 +1,237 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_delta_log.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "delta_log.hpp"
+#include "broadcast_ring.hpp"
+#include "mpsc_fifo.hpp"
+#include "fifo.hpp"
+#include "test.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// add to one counter of the state
+struct delta
+{
+    uint32_t key;
+    int32_t add;
+};
+
+const size_t N_KEYS = 16;
+typedef std::vector<int64_t> state_t;
+typedef delta_log<delta, state_t> log_t;
+
+void apply_delta(state_t &s, delta const &d)
+{
+    s[d.key] += d.add;
+}
+
+delta make_delta(uint64_t seq)
+{
+    delta d = { uint32_t(seq*7 % N_KEYS), int32_t(seq % 13) - 6 };
+    return d;
+}
+
+void test_log()
+{
+    log_t log(100, state_t(N_KEYS, 0), apply_delta);
+    state_t producer(N_KEYS, 0);
+
+    for(uint64_t i = 0; i < 50; ++i)
+    {
+        check(log.append(make_delta(i)), i, "sequence numbers");
+        apply_delta(producer, make_delta(i));
+    }
+    check(log.compactions(), (size_t)0, "no compaction under the limit");
+
+    log_t::batch b = log.since(0);
+    check(b.has_snapshot, false, "everything still in the log");
+    check(b.deltas.size(), (size_t)50, "whole log");
+    check(log.since(log.next_seq()).deltas.empty(), true, "up to date");
+
+    bool thrown = false;
+    try { log.since(log.next_seq() + 1); }
+    catch(std::string const &) { thrown = true; }
+    check(thrown, true, "future sequence throws");
+
+    for(uint64_t i = 50; i < 1000; ++i)
+    {
+        log.append(make_delta(i));
+        apply_delta(producer, make_delta(i));
+    }
+    check(log.compactions() > 0, true, "compacted");
+    check(log.size() <= 100, true, "retention limit");
+    check(log.next_seq(), (uint64_t)1000, "next sequence");
+
+    // a consumer that restarted from nothing
+    state_t fresh(N_KEYS, 0);
+    b = log.since(0);
+    check(b.has_snapshot, true, "snapshot for an old sequence");
+    check(b.first, log.first_seq(), "deltas after the snapshot");
+    uint64_t applied = apply_batch(b, fresh, 0, apply_delta);
+    check(applied, (uint64_t)1000, "caught up");
+    check(fresh == producer, true, "snapshot and deltas rebuild the state");
+
+    // one that is a bit behind and already has some of the batch
+    state_t behind(N_KEYS, 0);
+    uint64_t behind_applied = apply_batch(log.since(0), behind, 0, apply_delta);
+    for(uint64_t i = 1000; i < 1010; ++i)
+    {
+        log.append(make_delta(i));
+        apply_delta(producer, make_delta(i));
+    }
+    log_t::batch overlap = log.since(995);
+    apply_delta(behind, make_delta(1000));
+    behind_applied = 1001;
+    behind_applied = apply_batch(overlap, behind, behind_applied, apply_delta);
+    check(behind_applied, (uint64_t)1010, "overlapping batch");
+    check(behind == producer, true, "overlap applied once");
+}
+
+/// Live updates go out on a lossy ring, a consumer that misses some asks the producer
+/// for a catch up and keeps going from there.
+struct entry
+{
+    uint64_t seq;
+    delta d;
+};
+typedef broadcast_ring<entry, 64, spin_yield, BROADCAST_LOSSY> live_t;
+
+struct request
+{
+    size_t consumer;
+    uint64_t since;
+};
+
+void test_catch_up()
+{
+    const size_t N_CONSUMERS = 3;
+    const uint64_t N_DELTAS = 20000;
+    const vl::time TIMEOUT(0, 1000);
+
+    live_t live;
+    mpsc_fifo<request, spin_yield> requests;
+    std::vector<fifo<log_t::batch *, spin_yield> *> replies;
+    std::vector<live_t::reader *> readers;
+    for(size_t c = 0; c < N_CONSUMERS; ++c)
+    {
+        replies.push_back(new fifo<log_t::batch *, spin_yield>);
+        readers.push_back(new live_t::reader(live));
+    }
+
+    std::atomic<size_t> done(0);
+    std::vector<state_t> states(N_CONSUMERS, state_t(N_KEYS, 0));
+    std::vector<size_t> catch_ups(N_CONSUMERS, 0);
+
+    std::vector<std::thread> consumers;
+    for(size_t c = 0; c < N_CONSUMERS; ++c)
+    {
+        consumers.push_back(std::thread([&, c]()
+        {
+            live_t::reader &rd = *readers[c];
+            state_t &state = states[c];
+            uint64_t applied = 0;
+            // one past the newest sequence seen on the live ring
+            uint64_t seen = 0;
+            bool asked = false;
+            size_t n_read = 0;
+            while(applied < N_DELTAS)
+            {
+                log_t::batch *b = nullptr;
+                if(replies[c]->try_pop(b))
+                {
+                    applied = apply_batch(*b, state, applied, apply_delta);
+                    delete b;
+                    ++catch_ups[c];
+                    // live entries that came in while we waited were skipped, ask again if we still miss some
+                    asked = applied < seen;
+                    if(asked)
+                    { requests.push(request{ c, applied }); }
+                }
+
+                rd.wait(TIMEOUT);
+                rd.consume_all([&](entry const &e)
+                {
+                    seen = e.seq + 1;
+                    if(e.seq == applied)
+                    {
+                        apply_delta(state, e.d);
+                        ++applied;
+                    }
+                    else if(e.seq > applied && !asked)
+                    {
+                        // missed something, the live entries are skipped until the batch comes
+                        requests.push(request{ c, applied });
+                        asked = true;
+                    }
+                    // the first consumer is slow and falls behind
+                    if(c == 0 && ++n_read % 200 == 0)
+                    { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+                });
+            }
+            done.fetch_add(1);
+        }));
+    }
+
+    log_t log(1024, state_t(N_KEYS, 0), apply_delta);
+    state_t producer(N_KEYS, 0);
+    auto serve = [&]()
+    {
+        request r;
+        while(requests.try_pop(r))
+        { replies[r.consumer]->push(new log_t::batch(log.since(r.since))); }
+    };
+
+    for(uint64_t i = 0; i < N_DELTAS; ++i)
+    {
+        delta const d = make_delta(i);
+        apply_delta(producer, d);
+        live.push(entry{ log.append(d), d });
+        if(i % 64 == 0)
+        {
+            serve();
+            std::this_thread::yield();
+        }
+    }
+    while(done.load() < N_CONSUMERS)
+    {
+        serve();
+        std::this_thread::yield();
+    }
+
+    bool same = true;
+    for(size_t c = 0; c < N_CONSUMERS; ++c)
+    {
+        consumers[c].join();
+        same = same && states[c] == producer;
+        delete readers[c];
+        log_t::batch *b = nullptr;
+        while(replies[c]->try_pop(b))
+        { delete b; }
+        delete replies[c];
+    }
+    check(same, true, "every consumer ends up with the producer state");
+    check(catch_ups[0] > 0, true, "the slow consumer caught up from the log");
+    check(log.compactions() > 0, true, "log compacted during the run");
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING delta_log test" << std::endl;
+
+    test_log();
+    test_catch_up();
+
+    std::cout << "delta_log test ENDED" << std::endl;
+
+    return test_result();
+}
@@ -7,16 +7,182 @@
 */
 
 #include "fifo.hpp"
+#include "ring_fifo.hpp"
+#include "test.hpp"
 
 #include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <iterator>
+#include <memory>
 
-template<typename T>
-void check(T a, T b, const char *msg)
+void test_ring_fifo()
 {
-    if (!(a == b))
+    ring_fifo<int, 4> ring;
+
+    check(ring.empty(), true, "ring_fifo not empty");
+    check(ring.try_push(1), true, "ring_fifo push");
+    check(ring.try_push(2), true, "ring_fifo push");
+    check(ring.try_push(3), true, "ring_fifo push");
+    check(ring.try_push(4), true, "ring_fifo push");
+    check(ring.try_push(5), false, "ring_fifo push to full");
+
+    check(ring.pop(), 1, "ring_fifo pop");
+    check(ring.pop(), 2, "ring_fifo pop");
+
+    // wrap around the end of the array
+    ring.push(5);
+    ring.push(6);
+    check(ring.try_push(7), false, "ring_fifo push to full");
+
+    check(ring.pop(), 3, "ring_fifo pop");
+    check(ring.pop(), 4, "ring_fifo pop");
+    check(ring.pop(), 5, "ring_fifo pop");
+    check(ring.empty(), false, "ring_fifo empty");
+    check(ring.pop(), 6, "ring_fifo pop");
+    check(ring.empty(), true, "ring_fifo not empty");
+}
+
+void test_fifo_pool()
+{
+    fifo<int> fifo;
+
+    fifo.reserve(4);
+    check(fifo.pool_size(), (size_t)4, "fifo reserve");
+
+    fifo.push(1);
+    fifo.push(2);
+    fifo.push(3);
+    check(fifo.pool_size(), (size_t)1, "fifo push uses the pool");
+
+    check(fifo.pop(), 1, "fifo pop");
+    check(fifo.pop(), 2, "fifo pop");
+    check(fifo.pop(), 3, "fifo pop");
+
+    // takes the last free node and returns the three nodes the reader went past
+    fifo.push(4);
+    check(fifo.pool_size(), (size_t)3, "fifo push reclaims nodes");
+    check(fifo.pop(), 4, "fifo pop recycled node");
+    check(fifo.empty(), true, "fifo not empty");
+}
+
+/// push_n, pop_n and consume_all on either buffer
+template<typename Buffer>
+void test_batch(Buffer &buffer, const char *msg)
+{
+    int values[] = { 1, 2, 3, 4, 5, 6 };
+
+    buffer.push_n(values, 6);
+    check(buffer.empty(), false, msg);
+
+    std::vector<int> out;
+    check(buffer.pop_n(std::back_inserter(out), 2), (size_t)2, msg);
+    check(out.size(), (size_t)2, msg);
+    check(out.at(1), 2, msg);
+
+    int sum = 0;
+    check(buffer.consume_all([&sum](int &v) { sum += v; }), (size_t)4, msg);
+    check(sum, 3 + 4 + 5 + 6, msg);
+    check(buffer.empty(), true, msg);
+    check(buffer.consume_all([&sum](int &v) { sum += v; }), (size_t)0, msg);
+
+    // batch again after the buffer has been drained (recycled nodes / wrapped ring)
+    buffer.push_n(values, 3);
+    check(buffer.pop(), 1, msg);
+    check(buffer.pop_n(std::back_inserter(out), 10), (size_t)2, msg);
+    check(out.back(), 3, msg);
+}
+
+/// counts live instances so we can check the buffers destroy what they construct
+struct tracked
+{
+    static int alive;
+
+    tracked(int v) : value(v) { ++alive; }
+    tracked(tracked const &o) : value(o.value) { ++alive; }
+    ~tracked() { --alive; }
+
+    int value;
+};
+int tracked::alive = 0;
+
+/// move only elements and in place use
+template<typename Buffer>
+void test_move(Buffer &buffer, const char *msg)
+{
+    buffer.emplace(new int(1));
+    std::unique_ptr<int> p(new int(2));
+    buffer.push(std::move(p));
+    buffer.emplace(new int(3));
+    check(p.get() == nullptr, true, msg);
+
+    std::unique_ptr<int> out;
+    check(buffer.try_pop(out), true, msg);
+    check(*out, 1, msg);
+
+    int seen = 0;
+    check(buffer.consume([&seen](std::unique_ptr<int> &v) { seen = *v; }), true, msg);
+    check(seen, 2, msg);
+
+    std::vector< std::unique_ptr<int> > rest;
+    check(buffer.pop_n(std::back_inserter(rest), 5), (size_t)1, msg);
+    check(*rest.at(0), 3, msg);
+
+    check(buffer.try_pop(out), false, msg);
+    check(buffer.consume([&seen](std::unique_ptr<int> &v) { seen = *v; }), false, msg);
+}
+
+/// push a sequence from one thread and read it in an other, checks ordering
+template<typename Buffer>
+void test_threaded(Buffer &buffer, const char *msg)
+{
+    const int N = 100000;
+    std::thread writer([&buffer]()
+    {
+        for(int i = 0; i < N; ++i)
+        { buffer.push(i); }
+    });
+
+    bool in_order = true;
+    for(int i = 0; i < N; ++i)
     {
-        std::cerr << "TEST FAILED : " << msg << std::endl;
+        while(buffer.empty())
+        { std::this_thread::yield(); }
+        in_order = in_order && buffer.pop() == i;
     }
+    writer.join();
+
+    check(in_order, true, msg);
+    check(buffer.empty(), true, msg);
+}
+
+/// pop_wait with a writer that keeps pausing so the reader has to park
+template<typename Buffer>
+void test_pop_wait(Buffer &buffer, const char *msg)
+{
+    int data = -1;
+    check(buffer.pop_wait(data, vl::time(0, 1000)), false, msg);
+
+    const int N = 200;
+    std::thread writer([&buffer]()
+    {
+        for(int i = 0; i < N; ++i)
+        {
+            if(i % 20 == 0)
+            { std::this_thread::sleep_for(std::chrono::milliseconds(2)); }
+            buffer.push(i);
+        }
+    });
+
+    bool in_order = true;
+    for(int i = 0; i < N; ++i)
+    {
+        in_order = in_order && buffer.pop_wait(data, vl::time(5)) && data == i;
+    }
+    writer.join();
+
+    check(in_order, true, msg);
 }
 
 int main(int argc, char **argv)
@@ -37,5 +203,45 @@ int main(int argc, char **argv)
     check(fifo.pop(), 4, "fifo pop");
     check(fifo.empty(), true, "fifo not empty");
 
+    test_fifo_pool();
+    test_ring_fifo();
+
+    ::fifo<int> batch;
+    test_batch(batch, "fifo batch");
+    ring_fifo<int, 8> ring_batch;
+    test_batch(ring_batch, "ring_fifo batch");
+
+    ::fifo< std::unique_ptr<int> > moved;
+    test_move(moved, "fifo move only");
+    ring_fifo<std::unique_ptr<int>, 4> ring_moved;
+    test_move(ring_moved, "ring_fifo move only");
+
+    // elements left in the buffer are destroyed with it, popped ones right away
+    {
+        ::fifo<tracked> f;
+        ring_fifo<tracked, 4> r;
+        f.emplace(1); f.emplace(2); f.push(tracked(3));
+        r.emplace(1); r.emplace(2); r.push(tracked(3));
+        check(tracked::alive, 6, "fifo construct in place");
+        check(f.pop().value, 1, "fifo pop tracked");
+        check(r.pop().value, 1, "ring_fifo pop tracked");
+        check(tracked::alive, 4, "fifo destroy popped");
+    }
+    check(tracked::alive, 0, "fifo destroy leftovers");
+
+    ::fifo<int> threaded;
+    test_threaded(threaded, "fifo threaded order");
+    ring_fifo<int, 64> ring;
+    test_threaded(ring, "ring_fifo threaded order");
+
+    ::fifo<int, spin_park> parked;
+    test_pop_wait(parked, "fifo pop_wait spin_park");
+    ::fifo<int, spin_yield> yielded;
+    test_pop_wait(yielded, "fifo pop_wait spin_yield");
+    ring_fifo<int, 16, spin_park> ring_parked;
+    test_pop_wait(ring_parked, "ring_fifo pop_wait spin_park");
+
     std::cout << "fifo test ENDED" << std::endl;
+
+    return test_result();
 }
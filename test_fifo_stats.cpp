@@ -0,0 +1,110 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_fifo_stats.cpp
+*
+*   Under a copyleft.
+*/
+
+// Compiled with FIFO_STATS (see CMakeLists.txt)
+
+#include "fifo.hpp"
+#include "test.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <iterator>
+
+void test_counters()
+{
+    fifo<int> buffer;
+    int values[] = { 1, 2, 3, 4, 5 };
+
+    int data = 0;
+    check(buffer.try_pop(data), false, "try_pop on empty");
+
+    buffer.push(1);
+    buffer.push(2);
+    buffer.push_n(values, 5);
+
+    fifo_stats s = buffer.stats();
+    check(s.pushes, (uint64_t)7, "pushes");
+    check(s.pops, (uint64_t)0, "no pops");
+    check(s.depth, (uint64_t)7, "depth");
+    check(s.high_water, (uint64_t)7, "high water");
+    check(s.empty_polls, (uint64_t)1, "empty poll");
+
+    check(buffer.pop(), 1, "pop");
+    std::vector<int> out;
+    check(buffer.pop_n(std::back_inserter(out), 4), (size_t)4, "pop_n");
+    s = buffer.stats();
+    check(s.pops, (uint64_t)5, "pops");
+    check(s.depth, (uint64_t)2, "depth after pops");
+
+    // the writer sees the pops on its next push
+    buffer.push(8);
+    check(buffer.consume_all([](int &) {}), (size_t)3, "consume_all");
+    check(buffer.consume_all([](int &) {}), (size_t)0, "consume_all on empty");
+    s = buffer.stats();
+    check(s.pushes, (uint64_t)8, "pushes");
+    check(s.pops, (uint64_t)8, "pops");
+    check(s.depth, (uint64_t)0, "drained");
+    check(s.high_water, (uint64_t)7, "high water stays");
+    check(s.empty_polls, (uint64_t)2, "empty polls");
+}
+
+/// a monitor reads the counters while the writer and reader are busy
+void test_monitor()
+{
+    const uint64_t N = 100000;
+    fifo<int> buffer;
+    std::atomic<bool> done(false);
+
+    std::thread writer([&buffer, N]()
+    {
+        for(uint64_t i = 0; i < N; ++i)
+        { buffer.push(int(i)); }
+    });
+
+    bool sane = true;
+    std::thread monitor([&buffer, &done, &sane, N]()
+    {
+        while(!done.load())
+        {
+            fifo_stats s = buffer.stats();
+            sane = sane && s.pops <= N && s.pushes <= N && s.depth <= N;
+            std::this_thread::yield();
+        }
+    });
+
+    uint64_t got = 0;
+    while(got < N)
+    {
+        got += buffer.consume_all([](int &) {});
+        std::this_thread::yield();
+    }
+    writer.join();
+    done.store(true);
+    monitor.join();
+
+    fifo_stats s = buffer.stats();
+    check(sane, true, "monitor saw sane values");
+    check(s.pushes, N, "threaded pushes");
+    check(s.pops, N, "threaded pops");
+    check(s.depth, (uint64_t)0, "threaded depth");
+    check(s.high_water >= 1 && s.high_water <= N, true, "threaded high water");
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING fifo stats test" << std::endl;
+
+    test_counters();
+    test_monitor();
+
+    std::cout << "fifo stats test ENDED" << std::endl;
+
+    return test_result();
+}
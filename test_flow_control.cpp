@@ -0,0 +1,179 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_flow_control.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "flow_control.hpp"
+#include "fifo.hpp"
+#include "channel.hpp"
+#include "ws_scheduler.hpp"
+#include "test.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+template<typename T> using inbox = fifo<T, spin_park>;
+template<typename T> using bounded_inbox = bounded_fifo<T, inbox>;
+
+struct WorkMsg
+{
+    int n;
+};
+
+struct StopMsg
+{
+};
+
+const vl::time TIMEOUT(5);
+
+void test_credits()
+{
+    credit_counter unbounded;
+    check(unbounded.try_acquire(), true, "no limit");
+    check(unbounded.in_use(), (size_t)0, "nothing counted");
+
+    size_t n_high = 0;
+    size_t n_low = 0;
+    credit_counter c(4);
+    c.set_watermarks(3, 1, [&n_high]() { ++n_high; }, [&n_low]() { ++n_low; });
+
+    check(c.try_acquire() && c.try_acquire(), true, "below the limit");
+    check(n_high, (size_t)0, "not high yet");
+    check(c.try_acquire(), true, "to the high mark");
+    check(n_high, (size_t)1, "high water");
+    check(c.try_acquire(), true, "to the limit");
+    check(c.try_acquire(), false, "full");
+    check(c.acquire(vl::time(0, 1000)), false, "times out when full");
+    check(n_high, (size_t)1, "high water only once");
+
+    c.release(2);
+    check(n_low, (size_t)0, "not low yet");
+    check(c.in_use(), (size_t)2, "in use");
+    c.release(1);
+    check(n_low, (size_t)1, "low water");
+    check(c.available(), (size_t)3, "credits back");
+
+    // the pair again
+    c.try_acquire();
+    c.try_acquire();
+    check(n_high, (size_t)2, "high water again");
+}
+
+void test_bounded()
+{
+    bounded_inbox<int> q(3);
+    check(q.try_push(1) && q.try_push(2) && q.try_push(3), true, "up to the capacity");
+    check(q.try_push(4), false, "full");
+    check(q.push(4, OVERFLOW_FAIL), false, "fail policy");
+
+    int sum = 0;
+    check(q.consume_all([&sum](int &v) { sum += v; }), (size_t)3, "drain");
+    check(sum, 6, "drained in order");
+    check(q.credits().available(), (size_t)3, "credits back after the drain");
+
+    // a slow reader, the writer waits for it instead of queueing everything
+    const int N = 2000;
+    bounded_inbox<int> slow(8);
+    size_t max_depth = 0;
+    std::thread reader([&slow, &max_depth, N]()
+    {
+        int expect = 0;
+        while(expect < N && slow.wait(TIMEOUT))
+        {
+            size_t const depth = slow.credits().in_use();
+            max_depth = depth > max_depth ? depth : max_depth;
+            slow.consume_all([&expect, N](int &v) { expect += v == expect ? 1 : N; });
+            std::this_thread::yield();
+        }
+    });
+    for(int i = 0; i < N; ++i)
+    {
+        slow.push(i);
+    }
+    reader.join();
+    check(max_depth <= 8, true, "never more than the capacity");
+    check(slow.empty(), true, "all read");
+}
+
+void test_channel()
+{
+    channel<bounded_inbox, WorkMsg, StopMsg> chan(2);
+    chan.send(WorkMsg{ 1 });
+    chan.send(StopMsg());
+
+    int sum = 0;
+    size_t n_stop = 0;
+    chan.dispatch_all(
+        [&sum](WorkMsg &m) { sum += m.n; },
+        [&n_stop](StopMsg &) { ++n_stop; });
+    check(sum + int(n_stop), 2, "through a bounded channel");
+}
+
+void test_scheduler()
+{
+    typedef ws_scheduler<int, inbox> sched_t;
+
+    // nobody is running the workers so nothing drains
+    sched_t sched(3, vl::time(0, 1000), 2);
+    check(sched.submit(0, 1, OVERFLOW_FAIL) && sched.submit(0, 2, OVERFLOW_FAIL), true, "room");
+    check(sched.submit(0, 3, OVERFLOW_FAIL), false, "worker 0 full");
+    check(sched.submit(0, 3, OVERFLOW_SPILL), true, "spilled");
+    check(sched.credits(1).in_use(), (size_t)1, "to the next one");
+    check(sched.submit(0, 4, OVERFLOW_SPILL) && sched.submit(0, 5, OVERFLOW_SPILL)
+            && sched.submit(0, 6, OVERFLOW_SPILL), true, "spill fills the others");
+    check(sched.submit(0, 7, OVERFLOW_FAIL), false, "all full");
+    check(sched.credits(2).in_use(), (size_t)2, "worker 2 full");
+    bool touched = false;
+    sched.submit(0, 7, OVERFLOW_FAIL, [&touched](int &) { touched = true; });
+    check(touched, false, "before_push not called on a failed submit");
+
+    // a worker runs one, the blocked submit gets the credit and only then sets the task
+    std::atomic<bool> submitted(false);
+    std::thread coordinator([&sched, &submitted]()
+    {
+        sched.submit(0, 0, OVERFLOW_SPILL, [](int &t) { t = 7; });
+        submitted.store(true);
+    });
+    int task = 0;
+    check(sched.next(0, task), true, "worker 0 runs one");
+    coordinator.join();
+    check(submitted.load(), true, "blocked submit went through");
+
+    // run everything with the workers, every task once
+    sched.shutdown();
+    std::atomic<int> sum(task);
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i < 3; ++i)
+    {
+        workers.push_back(std::thread([&sched, &sum, i]()
+        {
+            int t = 0;
+            while(sched.next(i, t))
+            { sum.fetch_add(t); }
+        }));
+    }
+    for(size_t i = 0; i < workers.size(); ++i)
+    { workers[i].join(); }
+    check(sum.load(), 1+2+3+4+5+6+7, "every task once");
+    check(sched.credits(0).in_use() + sched.credits(1).in_use() + sched.credits(2).in_use(),
+            (size_t)0, "every credit back");
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING flow control test" << std::endl;
+
+    test_credits();
+    test_bounded();
+    test_channel();
+    test_scheduler();
+
+    std::cout << "flow control test ENDED" << std::endl;
+
+    return test_result();
+}
@@ -0,0 +1,105 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_mpsc_fifo.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "mpsc_fifo.hpp"
+#include "test.hpp"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <iterator>
+#include <memory>
+
+struct item
+{
+    size_t writer;
+    size_t seq;
+};
+
+/// every writer pushes a sequence, the reader checks that each writer's sequence is in order
+template<typename Wait>
+void test_writers(const char *msg)
+{
+    const size_t N_WRITERS = 4;
+    const size_t N = 20000;
+
+    mpsc_fifo<item, Wait> queue;
+    std::vector<std::thread> writers;
+    for(size_t w = 0; w < N_WRITERS; ++w)
+    {
+        writers.push_back(std::thread([&queue, w]()
+        {
+            for(size_t i = 0; i < N; ++i)
+            {
+                item it = { w, i };
+                queue.push(it);
+            }
+        }));
+    }
+
+    std::vector<size_t> next(N_WRITERS, 0);
+    bool in_order = true;
+    size_t received = 0;
+    while(received < N_WRITERS*N)
+    {
+        if(!queue.wait(vl::time(5)))
+        {
+            break;
+        }
+        received += queue.consume_all([&next, &in_order](item const &it)
+        {
+            in_order = in_order && it.seq == next[it.writer];
+            ++next[it.writer];
+        });
+    }
+
+    for(size_t w = 0; w < N_WRITERS; ++w)
+    {
+        writers.at(w).join();
+    }
+
+    check(received, N_WRITERS*N, msg);
+    check(in_order, true, msg);
+    check(queue.empty(), true, msg);
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING mpsc_fifo test" << std::endl;
+
+    mpsc_fifo<int> fifo;
+    check(fifo.empty(), true, "mpsc_fifo not empty");
+    fifo.push(1);
+    fifo.emplace(2);
+    fifo.push(3);
+    check(fifo.pop(), 1, "mpsc_fifo pop");
+
+    int data = 0;
+    check(fifo.try_pop(data), true, "mpsc_fifo try_pop");
+    check(data, 2, "mpsc_fifo try_pop");
+    check(fifo.consume([&data](int &v) { data = v; }), true, "mpsc_fifo consume");
+    check(data, 3, "mpsc_fifo consume");
+    check(fifo.try_pop(data), false, "mpsc_fifo try_pop empty");
+    check(fifo.empty(), true, "mpsc_fifo not empty");
+
+    mpsc_fifo< std::unique_ptr<int> > moved;
+    moved.emplace(new int(4));
+    moved.emplace(new int(5));
+    std::vector< std::unique_ptr<int> > out;
+    check(moved.pop_n(std::back_inserter(out), 8), (size_t)2, "mpsc_fifo pop_n");
+    check(*out.at(1), 5, "mpsc_fifo pop_n");
+    // left in the buffer, freed by the destructor
+    moved.emplace(new int(6));
+
+    test_writers<busy_spin>("mpsc_fifo writers busy_spin");
+    test_writers<spin_park>("mpsc_fifo writers spin_park");
+
+    std::cout << "mpsc_fifo test ENDED" << std::endl;
+
+    return test_result();
+}
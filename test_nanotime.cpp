@@ -0,0 +1,87 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_nanotime.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "nanotime.hpp"
+#include "chrono.hpp"
+#include "test.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+
+// all of the arithmetic is usable at compile time
+static_assert(vl::milliseconds(3) + vl::microseconds(5) == vl::nanoseconds(3005000), "duration add");
+static_assert(vl::seconds(1)/vl::milliseconds(1) == 1000, "duration ratio");
+static_assert((vl::seconds(7)/2).count() == 3500000000, "duration divide");
+static_assert(vl::seconds(5000) > vl::seconds(4999), "no overflow past 32 bits");
+static_assert(vl::time_point(vl::seconds(2)) - vl::time_point(vl::seconds(3)) == -vl::seconds(1), "time point difference");
+
+void test_conversions()
+{
+    vl::duration d(vl::time(2, 500));
+    check(d.count(), (int64_t)2000500000, "duration from time");
+    check(d.to_time() == vl::time(2, 500), true, "duration to time");
+    check(vl::nanoseconds(999).to_time() == vl::time(), true, "duration to time truncates");
+    check(vl::nanoseconds(-5).to_time() == vl::time(), true, "negative duration to time");
+
+    std::ostringstream os;
+    os << vl::seconds(1) + vl::milliseconds(2) + vl::nanoseconds(3);
+    check(os.str(), std::string("1s 2ms 3ns"), "duration print");
+}
+
+void test_clock()
+{
+    std::cout << "fast_clock uses " << (vl::fast_clock::uses_tsc() ? "TSC" : "OS clock") << std::endl;
+
+    // never goes backwards on one thread
+    bool monotonic = true;
+    vl::time_point prev = vl::fast_clock::now();
+    for(int i = 0; i < 100000; ++i)
+    {
+        vl::time_point const t = vl::fast_clock::now();
+        monotonic = monotonic && t >= prev;
+        prev = t;
+    }
+    check(monotonic, true, "fast_clock monotonic");
+
+    // agrees with the standard clock over a sleep, give the scheduler a lot of slack
+    auto const std_start = std::chrono::steady_clock::now();
+    vl::time_point const start = vl::fast_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    int64_t const ours = (vl::fast_clock::now() - start).count();
+    int64_t const theirs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - std_start).count();
+    int64_t const diff = ours > theirs ? ours - theirs : theirs - ours;
+    check(ours >= 50000000, true, "fast_clock sleep");
+    check(diff < theirs/20, true, "fast_clock rate");
+
+    // chrono on top of it
+    vl::chrono c;
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    check(c.elapsed_ns() >= vl::milliseconds(2), true, "chrono elapsed_ns");
+    check(c.elapsed() >= vl::time(0, 2000), true, "chrono elapsed");
+
+    vl::stop_chrono sc;
+    sc.stop();
+    vl::duration const stopped = sc.elapsed_ns();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    check(sc.elapsed_ns() == stopped, true, "stop_chrono stopped");
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING nanotime test" << std::endl;
+
+    test_conversions();
+    test_clock();
+
+    std::cout << "nanotime test ENDED" << std::endl;
+
+    return test_result();
+}
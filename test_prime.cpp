@@ -0,0 +1,113 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_prime.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "prime.hpp"
+#include "test.hpp"
+
+#include <iostream>
+#include <limits>
+#include <vector>
+
+/// plain trial division, slow but obviously right
+bool reference_prime(uint64_t n)
+{
+    if(n < 2)
+    { return false; }
+    for(uint64_t d = 2; d*d <= n; ++d)
+    {
+        if(n % d == 0)
+        { return false; }
+    }
+    return true;
+}
+
+std::vector<size_t> range(size_t base, size_t count)
+{
+    std::vector<size_t> out;
+    primes_in_range(base, count, [&out](size_t n) { out.push_back(n); });
+    return out;
+}
+
+/// the sieve against trial division, across segment boundaries
+void test_sieve()
+{
+    // pi(10^6)
+    check(range(0, 1000000).size(), (size_t)78498, "primes below a million");
+
+    // odd sized ranges at odd places
+    size_t const bases[] = { 0, 1, 2, 3, 65530, 999983, 123456789 };
+    bool same = true;
+    for(size_t b = 0; b < sizeof(bases)/sizeof(bases[0]); ++b)
+    {
+        std::vector<size_t> got = range(bases[b], 70001);
+        std::vector<size_t> expected;
+        for(size_t n = bases[b]; n < bases[b] + 70001; ++n)
+        {
+            if(reference_prime(n))
+            { expected.push_back(n); }
+        }
+        same = same && got == expected;
+    }
+    check(same, true, "sieve matches trial division");
+    check(range(0, 0).empty(), true, "empty range");
+}
+
+/// the switch from the sieve to Miller-Rabin
+void test_sieve_limit()
+{
+    size_t const base = size_t(SIEVE_LIMIT - 1000);
+    std::vector<size_t> got = range(base, 2000);
+    bool same = true;
+    size_t j = 0;
+    for(size_t n = base; n < base + 2000; ++n)
+    {
+        if(isPrime(n))
+        {
+            same = same && j < got.size() && got[j] == n;
+            ++j;
+        }
+    }
+    same = same && j == got.size();
+    check(same, true, "sieve limit");
+    check(got.empty(), false, "primes around the sieve limit");
+}
+
+void test_large()
+{
+    // Mersenne primes, strong pseudoprimes and the edges of 64 bits
+    check(isPrime(size_t(2147483647)), true, "2^31 - 1");
+    check(isPrime(size_t(4294967291u)), true, "largest 32 bit prime");
+    check(isPrime(size_t(4294967297ull)), false, "2^32 + 1");
+    check(isPrime(size_t(2305843009213693951ull)), true, "2^61 - 1");
+    check(isPrime(size_t(3215031751ull)), false, "strong pseudoprime to 2, 3, 5, 7");
+    check(isPrime(size_t(3825123056546413051ull)), false, "strong pseudoprime to bases up to 23");
+    check(isPrime(size_t(18446744073709551557ull)), true, "largest 64 bit prime");
+    check(isPrime(std::numeric_limits<size_t>::max()), false, "largest size_t");
+
+    // a range running off the end of size_t
+    std::vector<size_t> top = range(std::numeric_limits<size_t>::max() - 60, 1000);
+    check(top.size(), (size_t)1, "primes at the top of size_t");
+    check(top.at(0), size_t(18446744073709551557ull), "largest 64 bit prime in range");
+
+    // the old trial division overflowed an int here and looped forever
+    check(isPrime(size_t(1000000007)), true, "10^9 + 7");
+    check(isPrime(size_t(1000000007)*3), false, "3 * (10^9 + 7)");
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING prime test" << std::endl;
+
+    test_sieve();
+    test_sieve_limit();
+    test_large();
+
+    std::cout << "prime test ENDED" << std::endl;
+
+    return test_result();
+}
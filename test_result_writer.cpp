@@ -0,0 +1,126 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_result_writer.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "result_writer.hpp"
+#include "test.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+std::string decimal(uint64_t v)
+{
+    char buf[20];
+    return std::string(buf, format_decimal(v, buf));
+}
+
+std::string read_file(const char *filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+void test_format()
+{
+    check(decimal(0), std::string("0"), "format 0");
+    check(decimal(9), std::string("9"), "format 9");
+    check(decimal(10), std::string("10"), "format 10");
+    check(decimal(99), std::string("99"), "format 99");
+    check(decimal(100), std::string("100"), "format 100");
+    check(decimal(1000000007), std::string("1000000007"), "format 10^9 + 7");
+    check(decimal(std::numeric_limits<uint64_t>::max()), std::string("18446744073709551615"),
+            "format largest 64 bit");
+
+    check(result_writer::mode_for("out.bin") == result_writer::BINARY, true, "mode for .bin");
+    check(result_writer::mode_for("out.txt") == result_writer::TEXT, true, "mode for .txt");
+    check(result_writer::mode_for("bin") == result_writer::TEXT, true, "mode for short name");
+}
+
+/// enough records to go through every buffer several times
+void test_text()
+{
+    const char *filename = "test_result_writer.txt";
+    std::stringstream expected;
+    size_t bytes = 0;
+    {
+        // two buffers so the producer has to wait for the writer
+        result_writer out(filename, result_writer::TEXT, 2);
+        std::ostream log(out.text_stream());
+        log << "first line" << std::endl;
+        expected << "first line" << std::endl;
+        for(uint64_t i = 0; i < 100000; ++i)
+        {
+            if(i % 10000 == 0)
+            {
+                log << "at " << i << std::endl;
+                expected << "at " << i << std::endl;
+            }
+            uint16_t const thread = i % 3 == 0 ? result_writer::NO_THREAD : uint16_t(i % 7);
+            out.prime(i*7919, thread);
+            expected << i*7919 << " is a prime";
+            if(thread != result_writer::NO_THREAD)
+            { expected << " (thread: " << thread << ")"; }
+            expected << "\n";
+        }
+        // no endl, close still writes it
+        log << "last";
+        expected << "last";
+        out.close();
+        bytes = out.bytes_written();
+    }
+
+    std::string const got = read_file(filename);
+    check(got == expected.str(), true, "text output in order");
+    check(bytes, got.size(), "bytes written");
+    std::remove(filename);
+}
+
+void test_binary()
+{
+    const char *filename = "test_result_writer.bin";
+    {
+        result_writer out(filename, result_writer::BINARY);
+        out.text("dropped in binary mode\n");
+        for(uint64_t i = 0; i < 50000; ++i)
+        {
+            out.prime(i*i, uint16_t(i));
+        }
+    }
+
+    std::string const got = read_file(filename);
+    check(got.size(), (size_t)50000*sizeof(uint64_t), "binary size");
+    bool same = got.size() == 50000*sizeof(uint64_t);
+    for(uint64_t i = 0; same && i < 50000; ++i)
+    {
+        uint64_t n;
+        std::memcpy(&n, got.data() + i*sizeof(n), sizeof(n));
+        same = n == i*i;
+    }
+    check(same, true, "binary output in order");
+    std::remove(filename);
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING result_writer test" << std::endl;
+
+    test_format();
+    test_text();
+    test_binary();
+
+    std::cout << "result_writer test ENDED" << std::endl;
+
+    return test_result();
+}
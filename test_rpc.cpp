@@ -0,0 +1,143 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_rpc.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "rpc.hpp"
+#include "fifo.hpp"
+#include "test.hpp"
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Request
+{
+    uint64_t id;
+    int value;
+    bool stop;
+};
+
+struct Response
+{
+    uint64_t id;
+    int value;
+};
+
+typedef rpc_client<Response> client_t;
+
+const vl::time TIMEOUT(5);
+
+void test_single()
+{
+    client_t rpc;
+    rpc_future<Response> a = rpc.call();
+    rpc_future<Response> b = rpc.call();
+    check(a.id() != b.id(), true, "unique ids");
+    check(rpc.outstanding(), (size_t)2, "two outstanding");
+    check(a.ready(), false, "not ready");
+
+    // out of order
+    Response r = { b.id(), 2 };
+    check(rpc.complete(b.id(), r), true, "b completes");
+    check(b.ready(), true, "b ready");
+    check(a.ready(), false, "a still waiting");
+    check(rpc.complete(b.id(), r), false, "duplicate ignored");
+
+    r = Response{ a.id(), 1 };
+    rpc.complete(a.id(), r);
+    check(a.get().value, 1, "a response");
+    check(b.get().value, 2, "b response");
+    check(rpc.outstanding(), (size_t)0, "none outstanding");
+
+    bool thrown = false;
+    try { a.get(); }
+    catch(std::string const &) { thrown = true; }
+    check(thrown, true, "only once");
+
+    // the slot is reused, the old id doesn't match it
+    rpc_future<Response> c = rpc.call();
+    r = Response{ a.id(), 3 };
+    check(rpc.complete(a.id(), r), false, "stale id ignored");
+    check(c.ready(), false, "new call not completed by the stale one");
+
+    int got = 0;
+    rpc_future<Response> d = rpc.call([&got](Response &res) { got = res.value; });
+    r = Response{ d.id(), 4 };
+    rpc.complete(d.id(), r);
+    check(got, 4, "callback");
+    check(d.ready(), true, "ready after the callback");
+    check(rpc.complete(12345, r), false, "unknown id");
+}
+
+/// requests to a thread over a fifo pair, when_all sleeps on the response queue
+void test_threaded()
+{
+    const int N = 1000;
+    fifo<Request, spin_park> requests;
+    fifo<Response, spin_park> responses;
+
+    std::thread server([&requests, &responses]()
+    {
+        Request req;
+        while(requests.pop_wait(req, TIMEOUT) && !req.stop)
+        {
+            responses.push(Response{ req.id, req.value*2 });
+        }
+    });
+
+    client_t rpc(N);
+    std::vector<rpc_future<Response> > futures;
+    // sleeps until the server pushes
+    auto pump = [&rpc, &responses]()
+    {
+        responses.wait(TIMEOUT);
+        responses.consume_all([&rpc](Response &r) { rpc.complete(r.id, r); });
+    };
+
+    long callback_sum = 0;
+    for(int i = 0; i < N; ++i)
+    {
+        if(i % 2 == 0)
+        { futures.push_back(rpc.call()); }
+        else
+        { futures.push_back(rpc.call([&callback_sum](Response &r) { callback_sum += r.value; })); }
+        requests.push(Request{ futures.back().id(), i, false });
+    }
+    rpc.when_all(futures, pump);
+    check(rpc.outstanding(), (size_t)0, "all answered");
+
+    long sum = 0;
+    for(int i = 0; i < N; i += 2)
+    { sum += futures[i].get().value; }
+    check(sum + callback_sum, (long)N*(N - 1), "responses matched");
+
+    // wait_idle for callbacks only
+    int n_done = 0;
+    for(int i = 0; i < 10; ++i)
+    {
+        rpc_future<Response> f = rpc.call([&n_done](Response &) { ++n_done; });
+        requests.push(Request{ f.id(), i, false });
+    }
+    rpc.wait_idle(pump);
+    check(n_done, 10, "wait_idle");
+
+    requests.push(Request{ 0, 0, true });
+    server.join();
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING rpc test" << std::endl;
+
+    test_single();
+    test_threaded();
+
+    std::cout << "rpc test ENDED" << std::endl;
+
+    return test_result();
+}
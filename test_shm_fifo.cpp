@@ -0,0 +1,199 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_shm_fifo.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "shm_fifo.hpp"
+#include "test.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct sample
+{
+    uint64_t seq;
+    double value;
+};
+
+typedef shm_fifo<sample, 16> small_t;
+typedef shm_fifo<uint64_t, 256> numbers_t;
+
+const vl::time TIMEOUT(5);
+
+std::string unique_name(const char *what)
+{
+    return std::string("/mq_test_") + what + "_" + std::to_string(::getpid());
+}
+
+/// both ends in this process
+void test_single()
+{
+    std::string const name = unique_name("single");
+    small_t writer(name, SHM_CREATE);
+    small_t reader(name, SHM_OPEN);
+
+    check(reader.empty(), true, "starts empty");
+    size_t pushed = 0;
+    while(writer.try_push(sample{ pushed, pushed*0.5 }))
+    { ++pushed; }
+    check(pushed, small_t::capacity(), "fixed pool");
+
+    sample s = { 0, 0 };
+    bool in_order = true;
+    for(size_t i = 0; i < 5; ++i)
+    { in_order = in_order && reader.try_pop(s) && s.seq == i && s.value == i*0.5; }
+    check(in_order, true, "in order");
+
+    // the popped nodes are reused
+    check(writer.try_push(sample{ 100, 0 }), true, "push after pop");
+    size_t rest = reader.consume_all([&s](sample const &e) { s = e; });
+    check(rest, small_t::capacity() - 5 + 1, "consume the rest");
+    check(s.seq, (uint64_t)100, "last one");
+    check(reader.empty(), true, "empty again");
+
+    bool thrown = false;
+    try { numbers_t wrong(name, SHM_OPEN); }
+    catch(std::string const &) { thrown = true; }
+    check(thrown, true, "opening with the wrong type throws");
+
+    thrown = false;
+    try { small_t missing(unique_name("missing"), SHM_OPEN); }
+    catch(std::string const &) { thrown = true; }
+    check(thrown, true, "opening a missing queue throws");
+}
+
+/// numbers to a child process and their squares back
+void test_processes()
+{
+    const uint64_t N = 100000;
+    std::string const to_name = unique_name("to");
+    std::string const from_name = unique_name("from");
+    numbers_t to(to_name, SHM_CREATE);
+    numbers_t from(from_name, SHM_CREATE);
+
+    pid_t const child = ::fork();
+    if(child == 0)
+    {
+        // sees the segments the parent created, the copies of the handles are not used
+        int status = 1;
+        try
+        {
+            numbers_t in(to_name, SHM_OPEN);
+            numbers_t out(from_name, SHM_OPEN);
+            uint64_t v = 0;
+            while(in.pop_wait(v, TIMEOUT) && v != 0)
+            { out.push(v*v); }
+            status = v == 0 ? 0 : 1;
+        }
+        catch(std::string const &)
+        {}
+        // skip the destructors of the parent's handles
+        ::_exit(status);
+    }
+
+    uint64_t sum = 0;
+    uint64_t expected = 0;
+    uint64_t received = 0;
+    for(uint64_t i = 1; i <= N; ++i)
+    {
+        expected += i*i;
+        while(!to.try_push(i))
+        {
+            received += from.consume_all([&sum](uint64_t const &v) { sum += v; });
+            from.wait(vl::time(0, 100));
+        }
+        received += from.consume_all([&sum](uint64_t const &v) { sum += v; });
+    }
+    to.push(0);
+    while(received < N && from.wait(TIMEOUT))
+    {
+        received += from.consume_all([&sum](uint64_t const &v) { sum += v; });
+    }
+
+    int status = -1;
+    ::waitpid(child, &status, 0);
+    check(WIFEXITED(status) && WEXITSTATUS(status) == 0, true, "child exited cleanly");
+    check(received, N, "every reply");
+    check(sum, expected, "replies match");
+}
+
+/// children ring one bell, the parent sleeps on it
+void test_doorbell()
+{
+    const uint32_t N_CHILDREN = 3;
+    std::string const name = unique_name("bell");
+    shm_doorbell bell(name, SHM_CREATE);
+
+    uint32_t const seen = bell.rings();
+    check(bell.wait(seen, vl::time(0, 1000)), false, "no ring times out");
+
+    std::vector<pid_t> children;
+    for(uint32_t c = 0; c < N_CHILDREN; ++c)
+    {
+        pid_t const child = ::fork();
+        if(child == 0)
+        {
+            int status = 1;
+            try
+            {
+                shm_doorbell b(name, SHM_OPEN);
+                b.ring();
+                status = 0;
+            }
+            catch(std::string const &)
+            {}
+            ::_exit(status);
+        }
+        children.push_back(child);
+    }
+
+    // every wake up is for at least one ring
+    while(bell.rings() - seen < N_CHILDREN)
+    {
+        uint32_t const now = bell.rings();
+        if(!bell.wait(now, TIMEOUT))
+        { break; }
+    }
+    check(bell.rings() - seen, N_CHILDREN, "every ring");
+
+    bool clean = true;
+    for(size_t c = 0; c < children.size(); ++c)
+    {
+        int status = -1;
+        ::waitpid(children[c], &status, 0);
+        clean = clean && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    check(clean, true, "children exited cleanly");
+
+    bool opened = true;
+    try
+    {
+        shm_doorbell other(unique_name("nobell"), SHM_OPEN);
+    }
+    catch(std::string const &)
+    {
+        opened = false;
+    }
+    check(opened, false, "a bell that doesn't exist doesn't open");
+    bell.unlink();
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING shm_fifo test" << std::endl;
+
+    test_single();
+    test_processes();
+    test_doorbell();
+
+    std::cout << "shm_fifo test ENDED" << std::endl;
+
+    return test_result();
+}
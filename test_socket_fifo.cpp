@@ -0,0 +1,220 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_socket_fifo.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "socket_fifo.hpp"
+#include "channel.hpp"
+#include "test.hpp"
+
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+/// odd size so the frames are padded
+struct sample
+{
+    uint64_t seq;
+    char tag[5];
+};
+
+struct PingMsg
+{
+    uint32_t id;
+};
+
+struct QuitMsg
+{
+};
+
+template<typename T> using sock_queue_t = socket_fifo<T>;
+typedef channel<sock_queue_t, PingMsg, QuitMsg> sock_channel_t;
+
+const vl::time TIMEOUT(5);
+
+void test_address()
+{
+    socket_address a = socket_address::parse("unix:/tmp/x.sock");
+    check(a.is_unix, true, "unix address");
+    check(a.host, std::string("/tmp/x.sock"), "unix path");
+
+    a = socket_address::parse("tcp:127.0.0.1:4000");
+    check(a.is_unix, false, "tcp address");
+    check(a.host, std::string("127.0.0.1"), "tcp host");
+    check(a.port, (uint16_t)4000, "tcp port");
+    check(a.str(), std::string("tcp:127.0.0.1:4000"), "back to a string");
+
+    const char *bad[] = { "udp:1.2.3.4:5", "tcp:host", "tcp:host:99999", "unix:", "" };
+    for(size_t i = 0; i < sizeof(bad)/sizeof(bad[0]); ++i)
+    {
+        bool thrown = false;
+        try { socket_address::parse(bad[i]); }
+        catch(std::string const &) { thrown = true; }
+        check(thrown, true, "bad address throws");
+    }
+}
+
+/// both ends in this thread
+void test_single()
+{
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    socket_fifo<sample> writer(fds[0]);
+    // small buffer so the frames wrap around it
+    socket_fifo<sample> reader(fds[1], 100);
+
+    check(reader.empty(), true, "starts empty");
+    writer.push(sample{ 0, "a" });
+    check(reader.empty(), true, "nothing before flush");
+    writer.flush();
+    check(reader.wait(TIMEOUT), true, "sent on flush");
+
+    sample s = { 99, "" };
+    check(reader.try_pop(s), true, "pop");
+    check(s.seq, (uint64_t)0, "first");
+    check(std::string(s.tag), std::string("a"), "contents");
+    check(reader.try_pop(s), false, "only one");
+
+    // more than a batch, the full ones go without flush
+    const size_t N = socket_fifo<sample>::MAX_BATCH*3 + 7;
+    for(size_t i = 1; i <= N; ++i)
+    { writer.push(sample{ i, "b" }); }
+    writer.flush();
+
+    size_t received = 0;
+    uint64_t next = 1;
+    bool in_order = true;
+    while(received < N && reader.wait(TIMEOUT))
+    {
+        received += reader.consume_all([&in_order, &next](sample &e)
+        {
+            in_order = in_order && e.seq == next++;
+        });
+    }
+    check(received, N, "all of them");
+    check(in_order, true, "in order");
+    check(reader.closed(), false, "still open");
+}
+
+/// wrong element type on the other end
+void test_mismatch()
+{
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    socket_fifo<uint32_t> writer(fds[0]);
+    socket_fifo<sample> reader(fds[1]);
+    for(uint32_t i = 0; i < 10; ++i)
+    { writer.push(i); }
+    writer.flush();
+
+    bool thrown = false;
+    try
+    {
+        reader.wait(TIMEOUT);
+        reader.consume_all([](sample &) {});
+    }
+    catch(std::string const &) { thrown = true; }
+    check(thrown, true, "wrong frame size throws");
+}
+
+/// numbers to a thread over a listener and their squares back, then the writer goes away
+void test_echo(std::string const &addr)
+{
+    const uint64_t N = 100000;
+    socket_listener listener(addr);
+    std::string const where = listener.address();
+
+    std::thread echo([where]()
+    {
+        socket_fifo<uint64_t> in(socket_connect(where, TIMEOUT));
+        socket_fifo<uint64_t> out(socket_connect(where, TIMEOUT));
+        while(in.wait(TIMEOUT))
+        {
+            in.consume_all([&out](uint64_t &n) { out.push(n*n); });
+            out.flush();
+        }
+    });
+
+    // the echo connects in order
+    int const to_fd = listener.accept(TIMEOUT);
+    int const from_fd = listener.accept(TIMEOUT);
+    check(to_fd >= 0 && from_fd >= 0, true, "accepted");
+
+    socket_fifo<uint64_t> from(from_fd);
+    uint64_t sum = 0;
+    uint64_t expected = 0;
+    uint64_t received = 0;
+    {
+        socket_fifo<uint64_t> to(to_fd);
+        for(uint64_t i = 1; i <= N; ++i)
+        {
+            expected += i*i;
+            to.push(i);
+            if(i % 1000 == 0)
+            {
+                to.flush();
+                received += from.consume_all([&sum](uint64_t &v) { sum += v; });
+            }
+        }
+        // closes when it goes out of scope
+    }
+    while(received < N && from.wait(TIMEOUT))
+    {
+        received += from.consume_all([&sum](uint64_t &v) { sum += v; });
+    }
+    echo.join();
+
+    check(received, N, "every reply");
+    check(sum, expected, "replies match");
+    from.wait(TIMEOUT);
+    check(from.closed(), true, "closed when the echo quit");
+}
+
+/// typed messages with the queue under a channel
+void test_channel()
+{
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    sock_channel_t out(fds[0]);
+    sock_channel_t in(fds[1]);
+
+    out.send(PingMsg{ 1 });
+    out.send(PingMsg{ 2 });
+    out.send(QuitMsg());
+    out.flush();
+
+    uint32_t sum = 0;
+    size_t n_quit = 0;
+    size_t n = 0;
+    while(n < 3 && in.wait(TIMEOUT))
+    {
+        n += in.dispatch_all(
+            [&sum](PingMsg &m) { sum += m.id; },
+            [&n_quit](QuitMsg &) { ++n_quit; });
+    }
+    check(sum, (uint32_t)3, "pings");
+    check(n_quit, (size_t)1, "quit");
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING socket_fifo test" << std::endl;
+
+    test_address();
+    test_single();
+    test_mismatch();
+    test_echo("unix:/tmp/mq_test_socket_" + std::to_string(::getpid()));
+    // port 0, the listener picks one
+    test_echo("tcp:127.0.0.1:0");
+    test_channel();
+
+    std::cout << "socket_fifo test ENDED" << std::endl;
+
+    return test_result();
+}
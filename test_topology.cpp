@@ -0,0 +1,155 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_topology.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "topology.hpp"
+#include "ws_scheduler.hpp"
+#include "fifo.hpp"
+#include "test.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+template<typename T> using inbox = fifo<T, spin_park>;
+
+const char *FAKE_SYS = "test_topology_sys";
+
+void write_file(std::string const &path, std::string const &content)
+{
+    std::ofstream out(path.c_str());
+    out << content << std::endl;
+}
+
+/// two packages (one NUMA node each) with two cores of two hardware threads
+/// numbered like Linux does: the first threads of every core, then the siblings
+void make_fake_sys()
+{
+    std::filesystem::remove_all(FAKE_SYS);
+    std::filesystem::create_directory(FAKE_SYS);
+    write_file(std::string(FAKE_SYS) + "/online", "0-7");
+    for(int c = 0; c < 8; ++c)
+    {
+        std::string const dir = std::string(FAKE_SYS) + "/cpu" + std::to_string(c);
+        int const package = (c % 4)/2;
+        std::filesystem::create_directories(dir + "/topology");
+        std::filesystem::create_directory(dir + "/node" + std::to_string(package));
+        write_file(dir + "/topology/core_id", std::to_string(c % 2));
+        write_file(dir + "/topology/physical_package_id", std::to_string(package));
+    }
+}
+
+void test_cpu_list()
+{
+    check(parse_cpu_list("0-3,8,10-11") == std::vector<int>{ 0, 1, 2, 3, 8, 10, 11 }, true, "cpu list");
+    check(parse_cpu_list("5") == std::vector<int>{ 5 }, true, "single cpu");
+    check(parse_cpu_list("").empty(), true, "empty cpu list");
+    check(parse_cpu_list("3-1").empty(), true, "backwards range");
+    check(parse_cpu_list("x").empty(), true, "broken cpu list");
+}
+
+void test_read()
+{
+    make_fake_sys();
+    cpu_topology topo = cpu_topology::read(FAKE_SYS);
+    check(topo.size(), (size_t)8, "cpus");
+    check(topo.n_cores(), (size_t)4, "cores");
+    check(topo.n_packages(), (size_t)2, "packages");
+    check(topo.n_nodes(), (size_t)2, "nodes");
+    check(topo.node_of(6), 1, "node of cpu 6");
+    check(topo.node_of(42), -1, "node of a missing cpu");
+    check(topo[4].smt, 1, "second hardware thread");
+    check(topo[1].smt, 0, "first hardware thread");
+
+    check(topo.plan(PLACE_COMPACT, 8) == std::vector<int>{ 0, 4, 1, 5, 2, 6, 3, 7 }, true, "compact plan");
+    check(topo.plan(PLACE_SCATTER, 8) == std::vector<int>{ 0, 2, 1, 3, 4, 6, 5, 7 }, true, "scatter plan");
+    check(topo.plan(PLACE_NO_SMT, 6) == std::vector<int>{ 0, 1, 2, 3, 0, 1 }, true, "nosmt plan wraps");
+    check(topo.plan(PLACE_NONE, 3) == std::vector<int>(3, -1), true, "no placement");
+
+    // nothing to read, one core per cpu
+    cpu_topology fallback = cpu_topology::read(std::string(FAKE_SYS) + "/missing");
+    check(fallback.size() > 0, true, "fallback topology");
+    check(fallback.n_cores(), fallback.size(), "fallback has no SMT");
+
+    std::filesystem::remove_all(FAKE_SYS);
+
+    check(parse_placement("scatter"), PLACE_SCATTER, "parse placement");
+    check(std::string(placement_name(PLACE_NO_SMT)), std::string("nosmt"), "placement name");
+    bool thrown = false;
+    try { parse_placement("everywhere"); }
+    catch(std::string const &) { thrown = true; }
+    check(thrown, true, "unknown placement throws");
+}
+
+/// on this machine
+void test_pin()
+{
+    cpu_topology topo = cpu_topology::detect();
+    std::clog << "topology: " << topo << std::endl;
+    check(topo.size() > 0, true, "detected cpus");
+
+    int const last = topo[topo.size() - 1].cpu;
+    int ran_on = -2;
+    bool pinned = false;
+    run_on_cpu(last, [&ran_on, &pinned, last]()
+    {
+        // run_on_cpu pinned us already, pinning again has to work too
+        pinned = pin_this_thread(last);
+        ran_on = current_cpu();
+    });
+    check(pinned, true, "pinned");
+    check(ran_on, last, "running on the pinned cpu");
+    check(pin_this_thread(-1), false, "negative cpu isn't pinned");
+}
+
+/// worker state rebuilt on another thread still works
+void test_attach()
+{
+    ws_scheduler<size_t, inbox> sched(2);
+    cpu_topology topo = cpu_topology::detect();
+    std::vector<int> cpus = topo.plan(PLACE_COMPACT, 2);
+    for(size_t i = 0; i < 2; ++i)
+    {
+        run_on_cpu(cpus[i], [&sched, i]() { sched.attach(i, 16); });
+    }
+
+    std::vector<size_t> sum(2, 0);
+    std::vector<std::thread> workers;
+    for(size_t w = 0; w < 2; ++w)
+    {
+        workers.push_back(std::thread([&sched, &sum, w]()
+        {
+            size_t task = 0;
+            while(sched.next(w, task))
+            { sum[w] += task; }
+        }));
+    }
+    for(size_t i = 1; i <= 100; ++i)
+    { sched.submit(i % 2, i); }
+    sched.shutdown();
+    for(size_t w = 0; w < 2; ++w)
+    { workers[w].join(); }
+
+    check(sum[0] + sum[1], (size_t)5050, "attached workers run every task");
+    check(sched.stats(0).executed + sched.stats(1).executed, (size_t)100, "attached executed count");
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING topology test" << std::endl;
+
+    test_cpu_list();
+    test_read();
+    test_pin();
+    test_attach();
+
+    std::cout << "topology test ENDED" << std::endl;
+
+    return test_result();
+}
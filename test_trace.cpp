@@ -0,0 +1,116 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_trace.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "trace.hpp"
+#include "test.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/// every value lands in a bucket whose range contains it, with bounded error
+void test_buckets()
+{
+    bool contained = true;
+    bool precise = true;
+    bool ordered = true;
+    size_t prev = 0;
+    for(uint64_t v = 0; v < (uint64_t(1) << 62); v = v < 100000 ? v + 1 : v + v/7)
+    {
+        size_t const i = latency_histogram::index(v);
+        contained = contained && i < latency_histogram::N_BUCKETS && latency_histogram::highest(i) >= v
+            && (i == 0 || latency_histogram::highest(i - 1) < v);
+        precise = precise && latency_histogram::highest(i) - v <= v/latency_histogram::SUB_COUNT;
+        ordered = ordered && i >= prev;
+        prev = i;
+    }
+    check(contained, true, "histogram value in its bucket");
+    check(precise, true, "histogram bucket error");
+    check(ordered, true, "histogram buckets ordered");
+    check(latency_histogram::index(uint64_t(-1)) < latency_histogram::N_BUCKETS, true, "histogram max value");
+}
+
+void test_percentiles()
+{
+    latency_histogram h;
+    check(h.percentile(50), (uint64_t)0, "empty histogram");
+
+    // 1 .. 1000 ns
+    for(uint64_t v = 1; v <= 1000; ++v)
+    {
+        h.record(v);
+    }
+    check(h.count(), (uint64_t)1000, "histogram count");
+    check(h.min(), (uint64_t)1, "histogram min");
+    check(h.max(), (uint64_t)1000, "histogram max");
+    check(h.mean(), 500.5, "histogram mean");
+
+    uint64_t const p50 = h.percentile(50);
+    uint64_t const p99 = h.percentile(99);
+    check(p50 >= 500 && p50 <= 500 + 500/32, true, "histogram p50");
+    check(p99 >= 990 && p99 <= 1000, true, "histogram p99");
+    check(h.percentile(100), (uint64_t)1000, "histogram p100");
+}
+
+void test_sink()
+{
+    trace_sink sink(1);
+
+    msg_trace t;
+    t.start(7);
+    // fake stamps so the hops are known
+    for(size_t p = 0; p < TRACE_POINTS; ++p)
+    {
+        t.stamps[p] = 1000 + p*10;
+    }
+    sink.add(t, 2);
+    sink.add(t, 3);
+
+    check(sink.hop(TRACE_POPPED).count(), (uint64_t)2, "sink hop count");
+    check(sink.hop(TRACE_POPPED).max(), (uint64_t)10, "sink hop value");
+    check(sink.total().max(), (uint64_t)(10*(TRACE_POINTS - 1)), "sink total");
+
+    // only one trail is kept for the trace file
+    std::ostringstream os;
+    sink.write_chrome_trace(os);
+    std::string const json = os.str();
+    check(json.find("traceEvents") != std::string::npos, true, "chrome trace events");
+    check(json.find("\"compute\"") != std::string::npos, true, "chrome trace compute");
+    check(json.find("\"tid\": 3") != std::string::npos, true, "chrome trace worker track");
+    check(json.find("\"tid\": 4") == std::string::npos, true, "chrome trace limit");
+
+    std::ostringstream table;
+    sink.print(table);
+    check(table.str().find("result queued") != std::string::npos, true, "sink print");
+
+    // stamps out of order count as 0, not as a wrapped around huge value
+    t.stamps[TRACE_POPPED] = t.stamps[TRACE_PUSHED] - 5;
+    sink.add(t, 2);
+    check(sink.hop(TRACE_POPPED).min(), (uint64_t)0, "sink hop backwards");
+    check(sink.hop(TRACE_RESULT_PUSHED).max() < 1000, true, "sink hop after backwards");
+    check(sink.total().max(), (uint64_t)(10*(TRACE_POINTS - 1)), "sink total after backwards");
+
+    // a point that was never stamped drops the trail
+    t.stamps[TRACE_RESULT_POPPED] = 0;
+    sink.add(t, 2);
+    check(sink.total().count(), (uint64_t)3, "sink unstamped not counted");
+    check(sink.dropped(), (size_t)1, "sink dropped");
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING trace test" << std::endl;
+
+    test_buckets();
+    test_percentiles();
+    test_sink();
+
+    std::cout << "trace test ENDED" << std::endl;
+
+    return test_result();
+}
@@ -0,0 +1,78 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_workload.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "workload.hpp"
+#include "test.hpp"
+
+#include <iostream>
+#include <string>
+
+/// best of a few runs, the first one can hit page faults or a context switch
+vl::duration best_run(workload &w, double us)
+{
+    vl::duration best = vl::seconds(1000);
+    for(int i = 0; i < 5; ++i)
+    {
+        vl::time_point const start = vl::fast_clock::now();
+        w.run_us(us);
+        vl::duration const took = vl::fast_clock::now() - start;
+        if(took < best)
+        { best = took; }
+    }
+    return best;
+}
+
+/// a calibrated run takes about as long as asked, lots of slack for a busy machine
+void test_profile(workload_profile p)
+{
+    std::string const name = workload_name(p);
+    check(parse_workload(name) == p, true, "parse workload name");
+
+    workload_calibration const cal = calibrate_workload(p);
+    check(cal.units_per_ns > 0, true, (name + " calibrated").c_str());
+    std::cout << name << " : " << cal.units_per_ns*1000 << " units per us" << std::endl;
+
+    workload w(cal);
+    w.run(vl::milliseconds(1));
+
+    // calibration and runs both slow down when the machine is busy, only check that a run
+    // scales with the time asked and doesn't take far longer
+    vl::duration const best_short = best_run(w, 500);
+    vl::duration const best_long = best_run(w, 5000);
+    check(best_long > best_short, true, (name + " run time scales").c_str());
+    check(best_long < vl::milliseconds(100), true, (name + " run time").c_str());
+
+    vl::time_point const start = vl::fast_clock::now();
+    w.run(vl::duration());
+    check(vl::fast_clock::now() - start < vl::milliseconds(1), true, (name + " zero run").c_str());
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING workload test" << std::endl;
+
+    test_profile(WORKLOAD_ALU);
+    test_profile(WORKLOAD_CACHE);
+    test_profile(WORKLOAD_DRAM);
+    test_profile(WORKLOAD_STATE);
+
+    bool threw = false;
+    try
+    {
+        parse_workload("nope");
+    }
+    catch(std::string const &)
+    {
+        threw = true;
+    }
+    check(threw, true, "unknown workload");
+
+    std::cout << "workload test ENDED" << std::endl;
+
+    return test_result();
+}
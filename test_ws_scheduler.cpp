@@ -0,0 +1,215 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file test_ws_scheduler.cpp
+*
+*   Under a copyleft.
+*/
+
+#include "ws_deque.hpp"
+#include "ws_scheduler.hpp"
+#include "fifo.hpp"
+#include "test.hpp"
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+template<typename T> using inbox = fifo<T, spin_park>;
+
+void test_deque()
+{
+    ws_deque<int> deque(2);
+    int x = 0;
+
+    check(deque.take(x), false, "ws_deque take empty");
+    check(deque.steal(x), false, "ws_deque steal empty");
+
+    // grows past the initial capacity
+    for(int i = 0; i < 10; ++i)
+    { deque.push(i); }
+    check(deque.size(), (size_t)10, "ws_deque size");
+
+    // owner is LIFO, thieves get the oldest
+    check(deque.take(x), true, "ws_deque take");
+    check(x, 9, "ws_deque take from bottom");
+    check(deque.steal(x), true, "ws_deque steal");
+    check(x, 0, "ws_deque steal from top");
+
+    int sum = 0;
+    while(deque.take(x))
+    { sum += x; }
+    check(sum, 1+2+3+4+5+6+7+8, "ws_deque take rest");
+    check(deque.empty(), true, "ws_deque not empty");
+}
+
+/// owner pushes and takes while thieves steal, every element is taken exactly once
+void test_deque_threaded()
+{
+    const int N = 50000;
+    const size_t N_THIEVES = 3;
+
+    ws_deque<int> deque;
+    std::vector<std::atomic<int> > seen(N);
+    for(int i = 0; i < N; ++i)
+    { seen[i].store(0); }
+    std::atomic<bool> done(false);
+
+    std::vector<std::thread> thieves;
+    for(size_t t = 0; t < N_THIEVES; ++t)
+    {
+        thieves.push_back(std::thread([&]()
+        {
+            int x = 0;
+            while(!done.load() || !deque.empty())
+            {
+                if(deque.steal(x))
+                { seen[x].fetch_add(1); }
+                else
+                { std::this_thread::yield(); }
+            }
+        }));
+    }
+
+    int x = 0;
+    for(int i = 0; i < N; ++i)
+    {
+        deque.push(i);
+        if(i % 3 == 0 && deque.take(x))
+        { seen[x].fetch_add(1); }
+    }
+    while(deque.take(x))
+    { seen[x].fetch_add(1); }
+    done.store(true);
+
+    for(size_t t = 0; t < N_THIEVES; ++t)
+    { thieves[t].join(); }
+
+    bool once = true;
+    for(int i = 0; i < N; ++i)
+    { once = once && seen[i].load() == 1; }
+    check(once, true, "ws_deque every element taken once");
+}
+
+/// all the tasks are given to one worker, the others have to steal them
+void test_scheduler()
+{
+    const size_t N_WORKERS = 4;
+    const size_t N_TASKS = 100;
+
+    ws_scheduler<size_t, inbox> sched(N_WORKERS);
+    std::vector<std::atomic<int> > runs(N_TASKS);
+    for(size_t i = 0; i < N_TASKS; ++i)
+    { runs[i].store(0); }
+
+    std::vector<std::thread> workers;
+    for(size_t w = 0; w < N_WORKERS; ++w)
+    {
+        workers.push_back(std::thread([&sched, &runs, w]()
+        {
+            size_t task = 0;
+            while(sched.next(w, task))
+            {
+                runs[task].fetch_add(1);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }));
+    }
+
+    for(size_t i = 0; i < N_TASKS; ++i)
+    { sched.submit(0, i); }
+    sched.shutdown();
+
+    for(size_t w = 0; w < N_WORKERS; ++w)
+    { workers[w].join(); }
+
+    bool once = true;
+    for(size_t i = 0; i < N_TASKS; ++i)
+    { once = once && runs[i].load() == 1; }
+    check(once, true, "ws_scheduler every task run once");
+
+    size_t executed = 0;
+    size_t stolen = 0;
+    for(size_t w = 0; w < N_WORKERS; ++w)
+    {
+        executed += sched.stats(w).executed;
+        stolen += sched.stats(w).stolen;
+    }
+    check(executed, N_TASKS, "ws_scheduler executed count");
+    check(stolen > 0, true, "ws_scheduler idle workers steal");
+    check(sched.stats(0).stolen, (size_t)0, "ws_scheduler owner doesn't steal");
+
+    worker_queue_stats const q = sched.queue_stats(0);
+    check(q.pushed, (uint64_t)N_TASKS, "ws_scheduler queue pushed");
+    check(q.stolen, (uint64_t)stolen, "ws_scheduler queue stolen");
+    check(q.taken + q.stolen, (uint64_t)N_TASKS, "ws_scheduler queue taken");
+    check(q.depth, (uint64_t)0, "ws_scheduler queue drained");
+    check(q.high_water > 0, true, "ws_scheduler queue high water");
+    check(sched.queue_stats(1).pushed, (uint64_t)0, "ws_scheduler queue of another worker");
+}
+
+/// tasks queued behind a long one are run by the idle worker, woken up by submit
+void test_behind_busy()
+{
+    const size_t N_TASKS = 10;
+    const size_t LONG = 1000;
+
+    // long idle wait so only a wake up from submit gets worker 1 going in time
+    ws_scheduler<size_t, inbox> sched(2, vl::time(10));
+    std::atomic<bool> long_running(false);
+    std::atomic<size_t> done_before_long(0);
+    std::atomic<size_t> done(0);
+
+    std::vector<std::thread> workers;
+    for(size_t w = 0; w < 2; ++w)
+    {
+        workers.push_back(std::thread([&, w]()
+        {
+            size_t task = 0;
+            while(sched.next(w, task))
+            {
+                if(task == LONG)
+                {
+                    long_running.store(true);
+                    // until the rest are done, or give up after a while
+                    for(int i = 0; i < 2000 && done.load() < N_TASKS; ++i)
+                    { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+                    done_before_long.store(done.load());
+                }
+                else
+                { done.fetch_add(1); }
+            }
+        }));
+    }
+
+    // give worker 1 time to go to sleep
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    sched.submit(0, LONG);
+    while(!long_running.load())
+    { std::this_thread::yield(); }
+    for(size_t i = 0; i < N_TASKS; ++i)
+    { sched.submit(0, i); }
+    sched.shutdown();
+
+    for(size_t w = 0; w < 2; ++w)
+    { workers[w].join(); }
+
+    check(done_before_long.load(), N_TASKS, "ws_scheduler tasks behind a busy worker run elsewhere");
+    check(sched.stats(1).stolen, N_TASKS, "ws_scheduler idle worker stole them");
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "STARTING ws_scheduler test" << std::endl;
+
+    test_deque();
+    test_deque_threaded();
+    test_scheduler();
+    test_behind_busy();
+
+    std::cout << "ws_scheduler test ENDED" << std::endl;
+
+    return test_result();
+}
@@ -15,6 +15,7 @@
 
 /// Interface
 #include "time.hpp"
+#include "nanotime.hpp"
 
 // Necessary for debug assertions
 #include <cassert>
@@ -27,6 +28,13 @@
 #include <time.h>
 #endif
 
+// The time stamp counter is only used where we know how to read and check it
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(_WIN32)
+#define VL_FAST_CLOCK_TSC
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
 /// Should not be available anywhere else as this is operating system specific
 namespace
 {
@@ -41,6 +49,88 @@ vl::time convert_large_integer(LARGE_INTEGER const &ticks, LARGE_INTEGER const &
 }
 #endif
 
+/// OS monotonic clock in nanoseconds
+int64_t os_now_ns(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER tps;
+    QueryPerformanceFrequency(&tps);
+    LARGE_INTEGER ticks;
+    QueryPerformanceCounter(&ticks);
+    // split so the multiply doesn't overflow
+    return (ticks.QuadPart/tps.QuadPart)*1000000000
+        + (ticks.QuadPart%tps.QuadPart)*1000000000/tps.QuadPart;
+#else
+    timespec ts;
+    if( 0 != ::clock_gettime(CLOCK_MONOTONIC, &ts) )
+    {
+        std::string desc("Failed to get time from Monotonic clock.");
+        throw desc;
+    }
+    return int64_t(ts.tv_sec)*1000000000 + ts.tv_nsec;
+#endif
+}
+
+/// ns = base_ns + (ticks - base_ticks)*mult >> TSC_SHIFT
+const unsigned TSC_SHIFT = 32;
+/// How long we compare the counter against the OS clock
+const int64_t CALIBRATION_NS = 10000000;
+
+/// Scale from time stamp counter ticks to nanoseconds, calibrated once
+struct tsc_scale
+{
+    tsc_scale(void)
+        : use_tsc(false)
+        , base_ticks(0)
+        , base_ns(0)
+        , mult(0)
+    {
+        calibrate();
+    }
+
+    void calibrate(void)
+    {
+#ifdef VL_FAST_CLOCK_TSC
+        // invariant TSC: constant rate in all power states, otherwise it's useless as a clock
+        unsigned a, b, c, d;
+        if(!__get_cpuid(0x80000007, &a, &b, &c, &d) || !(d & (1u << 8)))
+        { return; }
+
+        int64_t const t0 = os_now_ns();
+        uint64_t const c0 = __rdtsc();
+        int64_t t1;
+        uint64_t c1;
+        do
+        {
+            t1 = os_now_ns();
+            c1 = __rdtsc();
+        }
+        while(t1 - t0 < CALIBRATION_NS);
+
+        if(c1 <= c0)
+        { return; }
+
+        mult = (uint64_t(t1 - t0) << TSC_SHIFT)/(c1 - c0);
+        if(mult == 0)
+        { return; }
+
+        base_ticks = c1;
+        base_ns = t1;
+        use_tsc = true;
+#endif
+    }
+
+    bool use_tsc;
+    uint64_t base_ticks;
+    int64_t base_ns;
+    uint64_t mult;
+};
+
+/// Calibrated during static initialisation, before main, so now() is a plain read.
+/// A static initialiser in another file that runs before this one sees it zeroed
+/// (use_tsc false) and gets the OS clock, which is the same time base.
+tsc_scale tsc;
+
 }   // unamed namespace
 
 
@@ -79,7 +169,7 @@ vl::get_system_time(void)
     if( 0 != ::clock_gettime(CLOCK_MONOTONIC, &ts) )
     {
         std::string desc("Failed to get time from Monotonic clock.");
-        throw desc();
+        throw desc;
     }
     return time(ts.tv_sec, ts.tv_nsec/1000);
 #endif
@@ -225,3 +315,54 @@ vl::time::_check_usecs(void)
         usec = usec%(uint32_t)1e6;
     }
 }
+
+/// ---------------------------- Nanotime --------------------------------------
+std::ostream &
+vl::operator<<(std::ostream& os, vl::duration d)
+{
+    int64_t ns = d.count();
+    if( ns < 0 )
+    {
+        os << "-";
+        ns = -ns;
+    }
+    if( ns >= 1000000000 )
+    {
+        os << ns/1000000000 << "s ";
+        ns = ns%1000000000;
+    }
+    if( ns >= 1000000 )
+    {
+        os << ns/1000000 << "ms ";
+        ns = ns%1000000;
+    }
+    if( ns >= 1000 )
+    {
+        os << ns/1000 << "us ";
+        ns = ns%1000;
+    }
+    os << ns << "ns";
+
+    return os;
+}
+
+vl::time_point
+vl::fast_clock::now(void)
+{
+#ifdef VL_FAST_CLOCK_TSC
+    if( tsc.use_tsc )
+    {
+        // signed, another core can be a few ticks behind the calibration point
+        int64_t const ticks = int64_t(__rdtsc() - tsc.base_ticks);
+        __int128 const ns = ((__int128)ticks*tsc.mult) >> TSC_SHIFT;
+        return vl::time_point(vl::duration(tsc.base_ns + int64_t(ns)));
+    }
+#endif
+    return vl::time_point(vl::duration(os_now_ns()));
+}
+
+bool
+vl::fast_clock::uses_tsc(void)
+{
+    return tsc.use_tsc;
+}
@@ -0,0 +1,314 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file topology.cpp
+*
+*   Under a copyleft.
+*/
+
+/// Interface
+#include "topology.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <set>
+#include <tuple>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/// Should not be available anywhere else as this is operating system specific
+namespace
+{
+/// @brief first line of a file, empty if it can't be read
+std::string read_line(std::string const &path)
+{
+    std::ifstream in(path.c_str());
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+/// @brief a number from a file, def if it can't be read
+int read_int(std::string const &path, int def)
+{
+    std::string const line = read_line(path);
+    if(line.empty())
+    { return def; }
+    char *end = nullptr;
+    long v = std::strtol(line.c_str(), &end, 10);
+    return end == line.c_str() ? def : int(v);
+}
+
+/// @brief NUMA node of a cpu, the cpu directory has a nodeN link for it
+int read_node(std::string const &cpu_dir)
+{
+#ifdef _WIN32
+    return 0;
+#else
+    int node = 0;
+    DIR *dir = opendir(cpu_dir.c_str());
+    if(dir == nullptr)
+    { return node; }
+    while(dirent *e = readdir(dir))
+    {
+        std::string const name = e->d_name;
+        if(name.size() > 4 && name.compare(0, 4, "node") == 0)
+        {
+            node = std::atoi(name.c_str() + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+#endif
+}
+
+/// order of the compact placement: node, package, core and the hardware threads of the core in a row
+bool compact_order(cpu_info const &a, cpu_info const &b)
+{
+    if(a.node != b.node) { return a.node < b.node; }
+    if(a.package != b.package) { return a.package < b.package; }
+    if(a.core != b.core) { return a.core < b.core; }
+    return a.smt < b.smt;
+}
+}   // anon namespace
+
+placement parse_placement(std::string const &name)
+{
+    if(name == "none") { return PLACE_NONE; }
+    if(name == "compact") { return PLACE_COMPACT; }
+    if(name == "scatter") { return PLACE_SCATTER; }
+    if(name == "nosmt") { return PLACE_NO_SMT; }
+    throw std::string("Unknown placement: ") + name;
+}
+
+const char *placement_name(placement p)
+{
+    switch(p)
+    {
+    case PLACE_COMPACT: return "compact";
+    case PLACE_SCATTER: return "scatter";
+    case PLACE_NO_SMT: return "nosmt";
+    default: return "none";
+    }
+}
+
+std::vector<int> parse_cpu_list(std::string const &list)
+{
+    std::vector<int> out;
+    size_t pos = 0;
+    while(pos < list.size())
+    {
+        size_t const comma = std::min(list.find(',', pos), list.size());
+        std::string const item = list.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        char *end = nullptr;
+        long const first = std::strtol(item.c_str(), &end, 10);
+        if(end == item.c_str())
+        { return std::vector<int>(); }
+        long last = first;
+        if(*end == '-')
+        {
+            const char *start = end + 1;
+            last = std::strtol(start, &end, 10);
+            if(end == start || last < first)
+            { return std::vector<int>(); }
+        }
+        for(long c = first; c <= last; ++c)
+        { out.push_back(int(c)); }
+    }
+    return out;
+}
+
+cpu_topology cpu_topology::read(std::string const &root)
+{
+    cpu_topology topo;
+    std::vector<int> const online = parse_cpu_list(read_line(root + "/online"));
+    for(size_t i = 0; i < online.size(); ++i)
+    {
+        std::string const dir = root + "/cpu" + std::to_string(online[i]);
+        cpu_info c;
+        c.cpu = online[i];
+        // missing files on some virtual machines, assume a core of its own
+        c.core = read_int(dir + "/topology/core_id", online[i]);
+        c.package = std::max(read_int(dir + "/topology/physical_package_id", 0), 0);
+        c.node = read_node(dir);
+        c.smt = 0;
+        topo.cpus.push_back(c);
+    }
+    topo.finish();
+    return topo;
+}
+
+cpu_topology cpu_topology::detect()
+{
+    cpu_topology topo = read("/sys/devices/system/cpu");
+
+#if !defined(_WIN32)
+    // taskset, cgroups and the like
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+        std::vector<cpu_info> usable;
+        for(size_t i = 0; i < topo.cpus.size(); ++i)
+        {
+            int const c = topo.cpus[i].cpu;
+            if(c < CPU_SETSIZE && CPU_ISSET(c, &allowed))
+            { usable.push_back(topo.cpus[i]); }
+        }
+        if(!usable.empty())
+        {
+            // a core we can only use one hardware thread of counts as a core without SMT
+            topo.cpus.swap(usable);
+            topo.finish();
+        }
+    }
+#endif
+
+    return topo;
+}
+
+void cpu_topology::finish()
+{
+    if(cpus.empty())
+    {
+        unsigned const n = std::max(std::thread::hardware_concurrency(), 1u);
+        for(unsigned i = 0; i < n; ++i)
+        {
+            cpu_info c = { int(i), int(i), 0, 0, 0 };
+            cpus.push_back(c);
+        }
+    }
+
+    std::sort(cpus.begin(), cpus.end(),
+            [](cpu_info const &a, cpu_info const &b) { return a.cpu < b.cpu; });
+
+    // the lowest id of a core is its first hardware thread
+    for(size_t i = 0; i < cpus.size(); ++i)
+    {
+        cpus[i].smt = 0;
+        for(size_t j = 0; j < i; ++j)
+        {
+            if(cpus[j].package == cpus[i].package && cpus[j].core == cpus[i].core)
+            { ++cpus[i].smt; }
+        }
+    }
+}
+
+size_t cpu_topology::n_cores() const
+{
+    std::set<std::pair<int, int> > cores;
+    for(size_t i = 0; i < cpus.size(); ++i)
+    { cores.insert(std::make_pair(cpus[i].package, cpus[i].core)); }
+    return cores.size();
+}
+
+size_t cpu_topology::n_packages() const
+{
+    std::set<int> packages;
+    for(size_t i = 0; i < cpus.size(); ++i)
+    { packages.insert(cpus[i].package); }
+    return packages.size();
+}
+
+size_t cpu_topology::n_nodes() const
+{
+    std::set<int> nodes;
+    for(size_t i = 0; i < cpus.size(); ++i)
+    { nodes.insert(cpus[i].node); }
+    return nodes.size();
+}
+
+int cpu_topology::node_of(int cpu) const
+{
+    for(size_t i = 0; i < cpus.size(); ++i)
+    {
+        if(cpus[i].cpu == cpu)
+        { return cpus[i].node; }
+    }
+    return -1;
+}
+
+std::vector<int> cpu_topology::plan(placement p, size_t n) const
+{
+    if(p == PLACE_NONE || cpus.empty())
+    { return std::vector<int>(n, -1); }
+
+    std::vector<cpu_info> order = cpus;
+    std::sort(order.begin(), order.end(), compact_order);
+
+    if(p == PLACE_NO_SMT)
+    {
+        order.erase(std::remove_if(order.begin(), order.end(),
+                    [](cpu_info const &c) { return c.smt != 0; }), order.end());
+    }
+    else if(p == PLACE_SCATTER)
+    {
+        // number the cores of each package, then take core k of every package in turn
+        // and the second hardware threads of the cores only after all the first ones
+        std::map<std::pair<int, int>, int> rank;
+        std::map<int, int> n_ranked;
+        for(size_t i = 0; i < order.size(); ++i)
+        {
+            std::pair<int, int> const core(order[i].package, order[i].core);
+            if(rank.find(core) == rank.end())
+            { rank[core] = n_ranked[order[i].package]++; }
+        }
+        auto key = [&rank](cpu_info const &c)
+        {
+            return std::make_tuple(c.smt, rank[std::make_pair(c.package, c.core)], c.node, c.package);
+        };
+        std::stable_sort(order.begin(), order.end(),
+                [&key](cpu_info const &a, cpu_info const &b) { return key(a) < key(b); });
+    }
+
+    std::vector<int> out(n);
+    for(size_t i = 0; i < n; ++i)
+    { out[i] = order[i % order.size()].cpu; }
+    return out;
+}
+
+std::ostream &operator<<(std::ostream &os, cpu_topology const &topo)
+{
+    os << topo.size() << " cpus, " << topo.n_cores() << " cores, " << topo.n_packages()
+        << " packages, " << topo.n_nodes() << " nodes";
+    return os;
+}
+
+bool pin_this_thread(int cpu)
+{
+    if(cpu < 0)
+    { return false; }
+#ifdef _WIN32
+    if(cpu >= int(sizeof(DWORD_PTR)*8))
+    { return false; }
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#else
+    if(cpu >= CPU_SETSIZE)
+    { return false; }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+}
+
+int current_cpu()
+{
+#ifdef _WIN32
+    return int(GetCurrentProcessorNumber());
+#else
+    return sched_getcpu();
+#endif
+}
@@ -0,0 +1,129 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file topology.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef TOPOLOGY_HPP
+#define TOPOLOGY_HPP
+
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// One logical CPU (hardware thread)
+struct cpu_info
+{
+    /// id the OS uses for it
+    int cpu;
+    /// physical core id, unique within the package
+    int core;
+    /// socket
+    int package;
+    /// NUMA node, 0 when the system doesn't tell
+    int node;
+    /// which hardware thread of the core this is, 0 for the first one
+    int smt;
+};
+
+/// How threads are placed on the CPUs
+enum placement
+{
+    /// leave it to the OS
+    PLACE_NONE,
+    /// fill a core (all its hardware threads) before moving to the next one, the threads share caches
+    PLACE_COMPACT,
+    /// spread over the packages and cores first, hardware threads of the same core last
+    PLACE_SCATTER,
+    /// one thread per physical core, never two on SMT siblings
+    PLACE_NO_SMT
+};
+
+/// @brief placement from its name: none, compact, scatter or nosmt
+/// @throws std::string for an unknown name
+placement parse_placement(std::string const &name);
+
+const char *placement_name(placement p);
+
+/// @brief parse a Linux cpu list like "0-3,8,10-11"
+/// @return the cpus in the order they are listed, empty for an empty or broken list
+std::vector<int> parse_cpu_list(std::string const &list);
+
+/** @class cpu_topology
+ *  @desc The CPUs this process can run on and how they relate to each other
+ *  Read from /sys/devices/system/cpu on Linux. Where that isn't available (or it's
+ *  missing the topology files) every CPU is assumed to be a core of its own on a single
+ *  package and node.
+ *
+ *  plan turns a placement policy into a CPU for each thread.
+*/
+class cpu_topology
+{
+public:
+    /// @brief the CPUs of this machine that this process is allowed to run on
+    static cpu_topology detect();
+
+    /// @brief every online CPU described under root, doesn't look at the affinity mask
+    /// @param root directory laid out like /sys/devices/system/cpu
+    static cpu_topology read(std::string const &root);
+
+    /// @brief number of logical CPUs
+    size_t size() const
+    {
+        return cpus.size();
+    }
+
+    /// @brief logical CPU i, sorted by the OS id
+    cpu_info const &operator[](size_t i) const
+    {
+        return cpus[i];
+    }
+
+    size_t n_cores() const;
+    size_t n_packages() const;
+    size_t n_nodes() const;
+
+    /// @brief NUMA node of a CPU, -1 if it's not one of ours
+    int node_of(int cpu) const;
+
+    /// @brief CPU for each of n threads
+    /// More threads than CPUs wrap around to the start of the order.
+    /// @param p policy, PLACE_NONE gives -1 (don't pin) for every thread
+    /// @param n how many threads
+    std::vector<int> plan(placement p, size_t n) const;
+
+private:
+    /// sorts, numbers the hardware threads of each core and fills in the fallback
+    void finish();
+
+    std::vector<cpu_info> cpus;
+};
+
+std::ostream &operator<<(std::ostream &os, cpu_topology const &topo);
+
+/// @brief run the calling thread only on one CPU
+/// @param cpu OS id of the CPU, negative does nothing
+/// @return true if the thread was pinned
+bool pin_this_thread(int cpu);
+
+/// @brief the CPU the calling thread is running on right now, -1 if the OS doesn't tell
+int current_cpu();
+
+/// @brief run f on a thread pinned to cpu and wait for it
+/// Memory first touched in f is allocated on the NUMA node of that CPU (first touch policy),
+/// use it to build the state of a worker before the worker starts.
+template<typename F>
+void run_on_cpu(int cpu, F f)
+{
+    std::thread t([cpu, &f]()
+    {
+        pin_this_thread(cpu);
+        f();
+    });
+    t.join();
+}
+
+#endif  // TOPOLOGY_HPP
@@ -0,0 +1,351 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file trace.hpp
+*
+*   Under a copyleft.
+*/
+
+/*
+ *  Per message latency tracing.
+ *
+ *  A message carries a msg_trace, a fixed array of timestamps that every stage stamps
+ *  as the message goes past. No shared state and no allocation on the way, the trail
+ *  travels inside the message (copied into the reply when the work is done).
+ *
+ *  The last stage hands the finished trail to a trace_sink (single thread) that
+ *  records the time between each pair of stamps into a latency_histogram and keeps
+ *  the trails for a Chrome trace event file (chrome://tracing or ui.perfetto.dev).
+ */
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "nanotime.hpp"
+
+/// Points in the life of a batch, in order
+enum trace_point
+{
+    TRACE_PUSHED = 0,       // coordinator submits it
+    TRACE_POPPED,           // a worker takes it
+    TRACE_RESULT_PUSHED,    // the worker sends the results
+    TRACE_RESULT_POPPED,    // the coordinator reads the results
+    TRACE_POINTS
+};
+
+/// @brief timestamp for a trace in nanoseconds, only differences mean anything
+inline uint64_t trace_now()
+{
+    return uint64_t(vl::fast_clock::now().since_epoch().count());
+}
+
+/// Timestamp trail carried by a message, trivially copyable
+struct msg_trace
+{
+    /// @brief start a new trail, stamps the first point
+    /// @param msg_id identifies the message in the trace file
+    void start(uint32_t msg_id)
+    {
+        std::memset(stamps, 0, sizeof(stamps));
+        id = msg_id;
+        mark(TRACE_PUSHED);
+    }
+
+    /// @brief stamp a point with the current time
+    void mark(trace_point p)
+    {
+        stamps[p] = trace_now();
+    }
+
+    uint64_t stamps[TRACE_POINTS];
+    uint32_t id;
+};
+
+/** @class latency_histogram
+ *  @desc Log linear histogram for latencies (the HDR histogram layout)
+ *  Values below 2^SUB_BITS have a bucket each, above that every power of two range is
+ *  split into 2^SUB_BITS buckets so the error is at most 1/2^SUB_BITS of the value
+ *  (3% with 5 bits) over the whole 64 bit range with a fixed 2K buckets.
+ *  Recording is a few shifts and an increment, not thread safe.
+*/
+class latency_histogram
+{
+public:
+    static const unsigned SUB_BITS = 5;
+    static const uint64_t SUB_COUNT = uint64_t(1) << SUB_BITS;
+    static const size_t N_BUCKETS = (64 - SUB_BITS + 1)*SUB_COUNT;
+
+    latency_histogram()
+        : counts(N_BUCKETS, 0)
+        , total(0)
+        , min_value(uint64_t(-1))
+        , max_value(0)
+        , sum(0)
+    {}
+
+    /// @brief add a value
+    void record(uint64_t v)
+    {
+        ++counts[index(v)];
+        ++total;
+        sum += v;
+        if(v < min_value)
+        { min_value = v; }
+        if(v > max_value)
+        { max_value = v; }
+    }
+
+    /// @brief how many values have been recorded
+    uint64_t count() const
+    { return total; }
+
+    uint64_t min() const
+    { return total == 0 ? 0 : min_value; }
+
+    uint64_t max() const
+    { return max_value; }
+
+    double mean() const
+    { return total == 0 ? 0 : double(sum)/total; }
+
+    /// @brief value at a percentile
+    /// @param p percentile 0 - 100
+    /// @return the highest value that falls in the same bucket as the percentile, 0 if empty
+    uint64_t percentile(double p) const
+    {
+        if(total == 0)
+        { return 0; }
+
+        uint64_t rank = uint64_t(p/100*total + 0.5);
+        if(rank < 1)
+        { rank = 1; }
+        if(rank > total)
+        { rank = total; }
+
+        uint64_t seen = 0;
+        for(size_t i = 0; i < N_BUCKETS; ++i)
+        {
+            seen += counts[i];
+            if(seen >= rank)
+            {
+                uint64_t const v = highest(i);
+                return v < max_value ? v : max_value;
+            }
+        }
+        return max_value;
+    }
+
+    /// @brief bucket for a value
+    static size_t index(uint64_t v)
+    {
+        if(v < SUB_COUNT)
+        { return size_t(v); }
+
+        // position of the highest bit
+        unsigned msb = 0;
+        for(uint64_t x = v; x > 1; x >>= 1)
+        { ++msb; }
+
+        unsigned const shift = msb - SUB_BITS;
+        return size_t((shift + 1)*SUB_COUNT + ((v >> shift) - SUB_COUNT));
+    }
+
+    /// @brief largest value that goes to bucket i
+    static uint64_t highest(size_t i)
+    {
+        if(i < SUB_COUNT)
+        { return i; }
+
+        unsigned const shift = unsigned(i/SUB_COUNT - 1);
+        uint64_t const sub = i % SUB_COUNT + SUB_COUNT;
+        return ((sub + 1) << shift) - 1;
+    }
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t total;
+    uint64_t min_value;
+    uint64_t max_value;
+    uint64_t sum;
+};
+
+/** @class trace_sink
+ *  @desc Collects finished message trails, single thread (the last stage of the pipeline)
+ *  Every hop between two consecutive trace points gets a histogram, plus one for the
+ *  whole trip. The trails themselves are kept (up to a limit) for write_chrome_trace.
+*/
+class trace_sink
+{
+public:
+    /// One finished trail and the worker that ran it
+    struct record
+    {
+        msg_trace trace;
+        uint16_t worker;
+    };
+
+    /// @brief Constructor
+    /// @param max_records how many trails to keep for the trace file, histograms count all of them
+    trace_sink(size_t max_records = 100000)
+        : limit(max_records)
+        , n_dropped(0)
+    {}
+
+    /// @brief add a finished trail
+    /// The stamps come from different threads, a hop that goes backwards (clock skew between
+    /// cores) is counted as 0. A trail with a point that was never stamped is dropped.
+    /// @param t trail with all the points stamped
+    /// @param worker which worker ran the message
+    void add(msg_trace const &t, uint16_t worker)
+    {
+        for(size_t p = 0; p < TRACE_POINTS; ++p)
+        {
+            if(t.stamps[p] == 0)
+            {
+                ++n_dropped;
+                return;
+            }
+        }
+
+        for(size_t p = 1; p < TRACE_POINTS; ++p)
+        {
+            hops[p - 1].record(elapsed(t.stamps[p - 1], t.stamps[p]));
+        }
+        end_to_end.record(elapsed(t.stamps[TRACE_PUSHED], t.stamps[TRACE_POINTS - 1]));
+
+        if(records.size() < limit)
+        {
+            record r = { t, worker };
+            records.push_back(r);
+        }
+    }
+
+    /// @brief histogram for the hop that ends at point p
+    latency_histogram const &hop(trace_point p) const
+    {
+        return hops[p - 1];
+    }
+
+    /// @brief histogram from the first point to the last
+    latency_histogram const &total() const
+    {
+        return end_to_end;
+    }
+
+    /// @brief trails that weren't added because a point was missing
+    size_t dropped() const
+    {
+        return n_dropped;
+    }
+
+    /// @brief name of the hop that ends at point p
+    static const char *hop_name(trace_point p)
+    {
+        static const char *names[TRACE_POINTS] = { "", "queued", "compute", "result queued" };
+        return names[p];
+    }
+
+    /// @brief print the percentiles of every hop in nanoseconds
+    void print(std::ostream &os) const
+    {
+        os << "latency (ns)           count         p50         p90         p99       p99.9         max" << std::endl;
+        for(size_t p = 1; p < TRACE_POINTS; ++p)
+        {
+            print_row(os, hop_name(trace_point(p)), hops[p - 1]);
+        }
+        print_row(os, "total", end_to_end);
+        if(n_dropped > 0)
+        { os << n_dropped << " trails dropped, not every point was stamped" << std::endl; }
+    }
+
+    /// @brief write the kept trails as Chrome trace events (JSON)
+    /// Compute is a slice on the worker's track (tid id + 1), the time spent in the queues
+    /// are async slices on the coordinator's track (tid 0) since they overlap.
+    void write_chrome_trace(std::ostream &os) const
+    {
+        uint64_t base = uint64_t(-1);
+        for(size_t i = 0; i < records.size(); ++i)
+        {
+            if(records[i].trace.stamps[TRACE_PUSHED] < base)
+            { base = records[i].trace.stamps[TRACE_PUSHED]; }
+        }
+
+        os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [" << std::endl;
+        os << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"coordinator\"}}";
+        for(size_t i = 0; i < records.size(); ++i)
+        {
+            record const &r = records[i];
+            uint64_t const *s = r.trace.stamps;
+            unsigned const worker_tid = unsigned(r.worker) + 1;
+
+            async_event(os, "queued", r.trace.id, elapsed(base, s[TRACE_PUSHED]), elapsed(base, s[TRACE_POPPED]));
+            complete_event(os, "compute", r.trace.id, worker_tid, elapsed(base, s[TRACE_POPPED]),
+                    elapsed(s[TRACE_POPPED], s[TRACE_RESULT_PUSHED]));
+            async_event(os, "result queued", r.trace.id, elapsed(base, s[TRACE_RESULT_PUSHED]),
+                    elapsed(base, s[TRACE_RESULT_POPPED]));
+        }
+        os << std::endl << "]}" << std::endl;
+    }
+
+private:
+    static void print_row(std::ostream &os, std::string name, latency_histogram const &h)
+    {
+        name.resize(16, ' ');
+        os << name;
+        print_value(os, h.count());
+        print_value(os, h.percentile(50));
+        print_value(os, h.percentile(90));
+        print_value(os, h.percentile(99));
+        print_value(os, h.percentile(99.9));
+        print_value(os, h.max());
+        os << std::endl;
+    }
+
+    static void print_value(std::ostream &os, uint64_t v)
+    {
+        std::string s = std::to_string(v);
+        if(s.size() < 12)
+        { s.insert(0, 12 - s.size(), ' '); }
+        os << s;
+    }
+
+    /// @brief from stamp a to b, 0 if b is earlier (stamps from different cores)
+    static uint64_t elapsed(uint64_t a, uint64_t b)
+    {
+        return b > a ? b - a : 0;
+    }
+
+    /// trace event timestamps are in microseconds
+    static double us(uint64_t ns)
+    {
+        return double(ns)/1000;
+    }
+
+    static void complete_event(std::ostream &os, const char *name, uint32_t id, unsigned tid, uint64_t ts, uint64_t dur)
+    {
+        os << "," << std::endl << "{\"name\": \"" << name << "\", \"cat\": \"batch\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << tid
+            << ", \"ts\": " << us(ts) << ", \"dur\": " << us(dur) << ", \"args\": {\"batch\": " << id << "}}";
+    }
+
+    static void async_event(std::ostream &os, const char *name, uint32_t id, uint64_t begin, uint64_t end)
+    {
+        os << "," << std::endl << "{\"name\": \"" << name << "\", \"cat\": \"batch\", \"ph\": \"b\", \"pid\": 1, \"tid\": 0, \"id\": " << id
+            << ", \"ts\": " << us(begin) << "}";
+        os << "," << std::endl << "{\"name\": \"" << name << "\", \"cat\": \"batch\", \"ph\": \"e\", \"pid\": 1, \"tid\": 0, \"id\": " << id
+            << ", \"ts\": " << us(end) << "}";
+    }
+
+    latency_histogram hops[TRACE_POINTS - 1];
+    latency_histogram end_to_end;
+    std::vector<record> records;
+    size_t limit;
+    size_t n_dropped;
+};
+
+#endif  // TRACE_HPP
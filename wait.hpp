@@ -0,0 +1,231 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file wait.hpp
+*
+*   Under a copyleft.
+*/
+
+/*
+ *  Wait strategies for the reader side of the queues.
+ *
+ *  The reader calls wait(ready, timeout) which returns when ready() is true
+ *  or the timeout has passed. The writer calls notify() after it has published data.
+ *
+ *  busy_spin  - never gives up the core, lowest latency, burns a full core while idle
+ *  spin_yield - spins for a while then yields to the OS scheduler
+ *  spin_park  - spins for a while then sleeps on a futex, notify only makes a system call
+ *               if the reader is actually sleeping
+ *  spin_park_shared - spin_park for queues in memory shared between processes
+ */
+
+#ifndef WAIT_HPP
+#define WAIT_HPP
+
+#include <atomic>
+#include <thread>
+#include <climits>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <intrin.h>
+#pragma comment(lib, "Synchronization.lib")
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "cache_line.hpp"
+#include "chrono.hpp"
+
+/// How many times we poll before yielding or parking
+const unsigned int WAIT_SPIN_COUNT = 128;
+
+/// @brief hint to the cpu that we are in a spin loop
+inline void cpu_relax()
+{
+#if defined(_WIN32) || defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#endif
+}
+
+/// @class busy_spin
+/// @desc poll until ready, never gives up the core
+struct busy_spin
+{
+    void notify()
+    {}
+
+    template<typename Pred>
+    bool wait(Pred ready, vl::time const &timeout)
+    {
+        vl::chrono clock;
+        for(unsigned int i = 1; !ready(); ++i)
+        {
+            // checking the clock costs more than polling so don't do it every time
+            if(i % WAIT_SPIN_COUNT == 0 && clock.elapsed() >= timeout)
+            {
+                return ready();
+            }
+            cpu_relax();
+        }
+        return true;
+    }
+};
+
+/// @class spin_yield
+/// @desc poll for a while then yield the core to others between polls
+struct spin_yield
+{
+    void notify()
+    {}
+
+    template<typename Pred>
+    bool wait(Pred ready, vl::time const &timeout)
+    {
+        for(unsigned int i = 0; i < WAIT_SPIN_COUNT; ++i)
+        {
+            if(ready())
+            { return true; }
+            cpu_relax();
+        }
+
+        vl::chrono clock;
+        while(!ready())
+        {
+            if(clock.elapsed() >= timeout)
+            {
+                return ready();
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+};
+
+/// @class basic_spin_park
+/// @desc poll for a while then sleep until the writer wakes us up
+/// The writer pays a fence and a load on every notify, the system call only
+/// happens when the reader is sleeping.
+/// Shared uses futexes that work between processes when the object is in shared memory
+/// (the private ones are cheaper but only work inside a process). Windows has no shared
+/// WaitOnAddress so there the shared version polls with yields.
+template<bool Shared>
+class basic_spin_park
+{
+public:
+    basic_spin_park()
+        : epoch(0)
+        , sleepers(0)
+    {}
+
+    void notify()
+    {
+        // pairs with the fence in wait: either we see the sleeper or it sees our data
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(sleepers.load(std::memory_order_relaxed) != 0)
+        {
+            epoch.fetch_add(1, std::memory_order_release);
+            wake(epoch);
+        }
+    }
+
+    template<typename Pred>
+    bool wait(Pred ready, vl::time const &timeout)
+    {
+        for(unsigned int i = 0; i < WAIT_SPIN_COUNT; ++i)
+        {
+            if(ready())
+            { return true; }
+            cpu_relax();
+        }
+
+        vl::chrono clock;
+        while(true)
+        {
+            uint32_t const e = epoch.load(std::memory_order_acquire);
+            sleepers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if(ready())
+            {
+                sleepers.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            vl::time const elapsed = clock.elapsed();
+            if(elapsed >= timeout)
+            {
+                sleepers.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            // returns immediately if the writer has bumped epoch after we read it
+            sleep(epoch, e, timeout - elapsed);
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    static void sleep(std::atomic<uint32_t> &word, uint32_t expected, vl::time const &timeout)
+    {
+#ifdef _WIN32
+        if(!Shared)
+        {
+            DWORD ms = (DWORD)(timeout.sec*1000 + timeout.usec/1000);
+            ::WaitOnAddress(&word, &expected, sizeof(expected), ms);
+            return;
+        }
+        vl::chrono clock;
+        while(word.load(std::memory_order_acquire) == expected && clock.elapsed() < timeout)
+        {
+            std::this_thread::yield();
+        }
+#elif defined(__linux__)
+        timespec ts;
+        ts.tv_sec = timeout.sec;
+        ts.tv_nsec = long(timeout.usec)*1000;
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), Shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE,
+                expected, &ts, nullptr, 0);
+#else
+        // no futex, poll the word with yields
+        vl::chrono clock;
+        while(word.load(std::memory_order_acquire) == expected && clock.elapsed() < timeout)
+        {
+            std::this_thread::yield();
+        }
+#endif
+    }
+
+    static void wake(std::atomic<uint32_t> &word)
+    {
+#ifdef _WIN32
+        if(!Shared)
+        { ::WakeByAddressAll(&word); }
+#elif defined(__linux__)
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), Shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE,
+                INT_MAX, nullptr, nullptr, 0);
+#else
+        (void)word;
+#endif
+    }
+
+    // futex word, bumped by the writer when it wakes sleepers
+    std::atomic<uint32_t> epoch;
+    // how many readers are about to sleep or sleeping
+    std::atomic<uint32_t> sleepers;
+};
+
+/// threads of one process
+typedef basic_spin_park<false> spin_park;
+/// processes sharing the memory the queue is in
+typedef basic_spin_park<true> spin_park_shared;
+
+#endif  // WAIT_HPP
@@ -0,0 +1,265 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file workload.hpp
+*
+*   Under a copyleft.
+*/
+
+/*
+ *  Synthetic work for the samples, stands in for the "complex function" of the use cases.
+ *
+ *  Work is done in units, a unit is 64 steps of one of the profiles:
+ *  alu   - dependent integer arithmetic in registers, no memory traffic
+ *  cache - pointer chasing through a working set that fits the L2 cache
+ *  dram  - streaming reads and writes through a buffer larger than the last level cache
+ *  state - read-modify-write at random places in a large per worker table
+ *
+ *  calibrate_workload measures how many units one thread does per nanosecond when it has
+ *  the machine to itself, once at startup. A run of a given duration does the matching
+ *  number of units, so when threads fight over caches or memory bandwidth the runs take
+ *  longer than asked, the way real memory bound work would.
+ */
+
+#ifndef WORKLOAD_HPP
+#define WORKLOAD_HPP
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cache_line.hpp"
+#include "nanotime.hpp"
+
+enum workload_profile
+{
+    WORKLOAD_ALU,
+    WORKLOAD_CACHE,
+    WORKLOAD_DRAM,
+    WORKLOAD_STATE
+};
+
+/// Working set sizes per workload instance (every worker has its own)
+const size_t WORKLOAD_CACHE_BYTES = 256*1024;
+const size_t WORKLOAD_DRAM_BYTES = 32*1024*1024;
+const size_t WORKLOAD_STATE_BYTES = 8*1024*1024;
+
+/// Steps in a single unit of work
+const size_t WORKLOAD_UNIT_STEPS = 64;
+
+/// @brief profile from its name
+/// @param name alu, cache, dram or state
+/// @throws std::string on an unknown name
+inline workload_profile parse_workload(std::string const &name)
+{
+    if(name == "alu")
+    { return WORKLOAD_ALU; }
+    else if(name == "cache")
+    { return WORKLOAD_CACHE; }
+    else if(name == "dram")
+    { return WORKLOAD_DRAM; }
+    else if(name == "state")
+    { return WORKLOAD_STATE; }
+
+    throw std::string("unknown workload: ") + name;
+}
+
+inline const char *workload_name(workload_profile p)
+{
+    static const char *names[] = { "alu", "cache", "dram", "state" };
+    return names[p];
+}
+
+/// Result of calibrate_workload, cheap to copy to every worker
+struct workload_calibration
+{
+    workload_profile profile;
+    /// units one thread does in a nanosecond
+    double units_per_ns;
+};
+
+/** @class workload
+ *  @desc Does a calibrated amount of work, one per thread
+ *  Allocates and touches its working set in the constructor so the first runs
+ *  don't pay for page faults.
+*/
+class workload
+{
+public:
+    /// @brief Constructor
+    /// @param cal profile and speed from calibrate_workload
+    workload(workload_calibration const &cal)
+        : calibration(cal)
+        , x(0x9E3779B97F4A7C15ull)
+        , pos(0)
+        , sink(0)
+    {
+        switch(calibration.profile)
+        {
+        case WORKLOAD_ALU:
+            break;
+        case WORKLOAD_CACHE:
+            make_chain(WORKLOAD_CACHE_BYTES/sizeof(uint64_t));
+            break;
+        case WORKLOAD_DRAM:
+            data.assign(WORKLOAD_DRAM_BYTES/sizeof(uint64_t), 1);
+            break;
+        case WORKLOAD_STATE:
+            data.assign(WORKLOAD_STATE_BYTES/sizeof(uint64_t), 1);
+            break;
+        }
+    }
+
+    /// @brief do work for about this long (on an otherwise idle machine)
+    /// @param d how long, zero or negative does nothing
+    void run(vl::duration d)
+    {
+        if(d <= vl::duration())
+        { return; }
+        units(size_t(double(d.count())*calibration.units_per_ns + 0.5));
+    }
+
+    /// @brief do work for about this long
+    /// @param us microseconds, fractions are fine
+    void run_us(double us)
+    {
+        run(vl::nanoseconds(int64_t(us*1000)));
+    }
+
+    /// @brief do n units of work
+    void units(size_t n)
+    {
+        size_t const steps = n*WORKLOAD_UNIT_STEPS;
+        switch(calibration.profile)
+        {
+        case WORKLOAD_ALU:
+            for(size_t i = 0; i < steps; ++i)
+            {
+                next_random();
+            }
+            break;
+
+        case WORKLOAD_CACHE:
+            // every load depends on the one before
+            for(size_t i = 0; i < steps; ++i)
+            {
+                pos = size_t(data[pos]);
+            }
+            break;
+
+        case WORKLOAD_DRAM:
+        {
+            // one step is a cache line, read and write back
+            size_t const line = CACHE_LINE_WORDS;
+            size_t const size = data.size();
+            uint64_t sum = x;
+            for(size_t i = 0; i < steps; ++i)
+            {
+                sum += data[pos];
+                data[pos] = sum;
+                pos += line;
+                if(pos >= size)
+                { pos = 0; }
+            }
+            x = sum;
+            break;
+        }
+
+        case WORKLOAD_STATE:
+        {
+            size_t const mask = data.size() - 1;
+            for(size_t i = 0; i < steps; ++i)
+            {
+                uint64_t const r = next_random();
+                data[size_t(r) & mask] += r;
+            }
+            break;
+        }
+        }
+
+        // the compiler can't throw the work away
+        sink = x + pos;
+    }
+
+    /// @brief depends on all the work done so far
+    uint64_t result() const
+    {
+        return sink;
+    }
+
+    workload_calibration const &get_calibration() const
+    {
+        return calibration;
+    }
+
+private:
+    static const size_t CACHE_LINE_WORDS = CACHE_LINE_SIZE/sizeof(uint64_t);
+
+    /// xorshift64*
+    uint64_t next_random()
+    {
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        return x *= 0x2545F4914F6CDD1Dull;
+    }
+
+    /// @brief a single random cycle through n slots (Sattolo's shuffle)
+    void make_chain(size_t n)
+    {
+        data.resize(n);
+        for(size_t i = 0; i < n; ++i)
+        {
+            data[i] = i;
+        }
+        for(size_t i = n - 1; i > 0; --i)
+        {
+            size_t const j = size_t(next_random() % i);
+            std::swap(data[i], data[j]);
+        }
+    }
+
+    workload_calibration calibration;
+    std::vector<uint64_t> data;
+    uint64_t x;
+    size_t pos;
+    volatile uint64_t sink;
+};
+
+/// @brief measure how fast a single thread does the units of a profile
+/// Takes about a hundred milliseconds, run it once before starting the workers.
+/// @param p profile to measure
+inline workload_calibration calibrate_workload(workload_profile p)
+{
+    workload_calibration cal = { p, 1 };
+    workload w(cal);
+
+    // warm the caches and the TLB with a pass over the working set
+    w.units(WORKLOAD_DRAM_BYTES/CACHE_LINE_SIZE/WORKLOAD_UNIT_STEPS);
+
+    // best of a few rounds, anything else running only makes us slower
+    double best = 0;
+    for(int round = 0; round < 3; ++round)
+    {
+        size_t n = 16;
+        vl::duration took;
+        do
+        {
+            n *= 2;
+            vl::time_point const start = vl::fast_clock::now();
+            w.units(n);
+            took = vl::fast_clock::now() - start;
+        }
+        while(took < vl::milliseconds(10));
+
+        double const rate = double(n)/double(took.count());
+        if(rate > best)
+        { best = rate; }
+    }
+
+    cal.units_per_ns = best;
+    return cal;
+}
+
+#endif  // WORKLOAD_HPP
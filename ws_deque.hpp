@@ -0,0 +1,225 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file ws_deque.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef WS_DEQUE_HPP
+#define WS_DEQUE_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <type_traits>
+
+#include "cache_line.hpp"
+
+/** @class ws_deque
+ *  @desc Work stealing deque (Chase-Lev)
+ *  One owner thread pushes and takes from the bottom, any number of other threads
+ *  steal from the top. The owner works LIFO on fresh (cache hot) tasks while thieves
+ *  take the oldest ones.
+ *
+ *  Memory ordering follows Le, Pop, Cohen, Zappa Nardelli:
+ *  "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+ *
+ *  The array grows when full. Old arrays are kept until the deque is destroyed since
+ *  a thief might still be reading from one.
+ *
+ *  T has to be trivially copyable and default constructible, a thief can read a slot while
+ *  the owner overwrites it (the read is thrown away in that case). Every push and steal
+ *  copies the element so keep tasks small, pointers or headers with a payload pointer.
+*/
+template<typename T>
+class ws_deque
+{
+    static_assert(std::is_trivially_copyable<T>::value, "ws_deque elements have to be trivially copyable");
+
+private:
+    /// Circular array, capacity is a power of two
+    /// Elements are stored as words that are read and written with relaxed atomics,
+    /// a thief racing with the owner can get a torn copy but it's never used since
+    /// it loses the race on top. Works for any size of T without locks.
+    struct array
+    {
+        static const size_t WORDS = (sizeof(T) + sizeof(uintptr_t) - 1)/sizeof(uintptr_t);
+
+        array(size_t cap)
+            : mask(cap - 1)
+            , slots(new std::atomic<uintptr_t>[cap*WORDS])
+        {}
+
+        ~array()
+        { delete [] slots; }
+
+        size_t capacity() const
+        { return mask + 1; }
+
+        T get(ptrdiff_t i) const
+        {
+            uintptr_t words[WORDS];
+            std::atomic<uintptr_t> const *slot = &slots[(i & mask)*WORDS];
+            for(size_t w = 0; w < WORDS; ++w)
+            { words[w] = slot[w].load(std::memory_order_relaxed); }
+
+            T x;
+            std::memcpy(&x, words, sizeof(T));
+            return x;
+        }
+
+        void put(ptrdiff_t i, T const &x)
+        {
+            uintptr_t words[WORDS] = {};
+            std::memcpy(words, &x, sizeof(T));
+
+            std::atomic<uintptr_t> *slot = &slots[(i & mask)*WORDS];
+            for(size_t w = 0; w < WORDS; ++w)
+            { slot[w].store(words[w], std::memory_order_relaxed); }
+        }
+
+        size_t mask;
+        std::atomic<uintptr_t> *slots;
+    };
+
+public:
+    /// @brief Constructor
+    /// @param capacity initial capacity, rounded up to a power of two
+    ws_deque(size_t capacity = 64)
+        : top(0)
+        , bottom(0)
+    {
+        size_t cap = 2;
+        while(cap < capacity)
+        { cap *= 2; }
+
+        array *a = new array(cap);
+        arrays.push_back(a);
+        current.store(a, std::memory_order_relaxed);
+    }
+
+    /// Destructor
+    ~ws_deque()
+    {
+        for(size_t i = 0; i < arrays.size(); ++i)
+        {
+            delete arrays[i];
+        }
+    }
+
+    /// @brief push to the bottom, only the owner
+    /// @param x element to push
+    void push(T x)
+    {
+        ptrdiff_t const b = bottom.load(std::memory_order_relaxed);
+        ptrdiff_t const t = top.load(std::memory_order_acquire);
+        array *a = current.load(std::memory_order_relaxed);
+        if(b - t > ptrdiff_t(a->capacity()) - 1)
+        {
+            a = grow(a, t, b);
+        }
+        a->put(b, x);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    /// @brief take from the bottom, only the owner
+    /// @param x OUT the element
+    /// @return true if we got an element, false if the deque was empty
+    bool take(T &x)
+    {
+        ptrdiff_t const b = bottom.load(std::memory_order_relaxed) - 1;
+        array *a = current.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        ptrdiff_t t = top.load(std::memory_order_relaxed);
+
+        if(t > b)
+        {
+            // empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        x = a->get(b);
+        if(t == b)
+        {
+            // last element, race against the thieves for it
+            bool const won = top.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /// @brief steal from the top, any thread but the owner
+    /// @param x OUT the element
+    /// @return true if we got an element, false if the deque was empty or we lost a race
+    bool steal(T &x)
+    {
+        ptrdiff_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        ptrdiff_t const b = bottom.load(std::memory_order_acquire);
+
+        if(t >= b)
+        {
+            return false;
+        }
+
+        array *a = current.load(std::memory_order_acquire);
+        x = a->get(t);
+        return top.compare_exchange_strong(t, t + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    /// @brief is the deque empty, a hint only when other threads are working on it
+    bool empty() const
+    {
+        ptrdiff_t const b = bottom.load(std::memory_order_relaxed);
+        ptrdiff_t const t = top.load(std::memory_order_relaxed);
+        return b <= t;
+    }
+
+    /// @brief how many elements, a hint only when other threads are working on it
+    size_t size() const
+    {
+        ptrdiff_t const b = bottom.load(std::memory_order_relaxed);
+        ptrdiff_t const t = top.load(std::memory_order_relaxed);
+        return b > t ? size_t(b - t) : 0;
+    }
+
+private:
+    // not copyable, shared with other threads
+    ws_deque(ws_deque const &);
+    ws_deque &operator=(ws_deque const &);
+
+    /// @brief double the array, only the owner
+    array *grow(array *old, ptrdiff_t t, ptrdiff_t b)
+    {
+        array *a = new array(old->capacity()*2);
+        for(ptrdiff_t i = t; i < b; ++i)
+        {
+            a->put(i, old->get(i));
+        }
+        arrays.push_back(a);
+        current.store(a, std::memory_order_release);
+        return a;
+    }
+
+    // thieves side
+    std::atomic<ptrdiff_t> top;
+    char pad0[CACHE_LINE_SIZE - sizeof(std::atomic<ptrdiff_t>)];
+
+    // owner side
+    std::atomic<ptrdiff_t> bottom;
+    std::atomic<array *> current;
+    // every array we have allocated, owner only
+    std::vector<array *> arrays;
+};
+
+#endif  // WS_DEQUE_HPP
@@ -0,0 +1,447 @@
+/**
+*   @author Joonatan Kuosa <joonatan.kuosa@gmail.com>
+*   @date 2026-10
+*   @file ws_scheduler.hpp
+*
+*   Under a copyleft.
+*/
+
+#ifndef WS_SCHEDULER_HPP
+#define WS_SCHEDULER_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "cache_line.hpp"
+#include "chrono.hpp"
+#include "flow_control.hpp"
+#include "ws_deque.hpp"
+
+/// Statistics for one worker of ws_scheduler
+struct worker_stats
+{
+    worker_stats()
+        : executed(0)
+        , stolen(0)
+        , failed_steals(0)
+    {}
+
+    /// tasks handed to the worker (own and stolen)
+    size_t executed;
+    /// tasks taken from other workers
+    size_t stolen;
+    /// steal attempts on a non empty deque that lost a race
+    size_t failed_steals;
+    /// time spent between getting a task and asking for the next one
+    vl::time busy;
+};
+
+/// Snapshot of the task queue (deque) of one worker of ws_scheduler
+struct worker_queue_stats
+{
+    worker_queue_stats()
+        : pushed(0)
+        , taken(0)
+        , stolen(0)
+        , depth(0)
+        , high_water(0)
+        , credits_in_use(0)
+    {}
+
+    /// tasks the coordinator queued for the worker
+    uint64_t pushed;
+    /// tasks the worker took from its own queue
+    uint64_t taken;
+    /// tasks other workers stole from the queue
+    uint64_t stolen;
+    /// tasks in the queue when the snapshot was taken
+    uint64_t depth;
+    /// largest depth the coordinator has seen after a push
+    uint64_t high_water;
+    /// credits spent and not given back, 0 without a capacity
+    size_t credits_in_use;
+};
+
+inline std::ostream &operator<<(std::ostream &os, worker_queue_stats const &s)
+{
+    os << "depth " << s.depth << " (max " << s.high_water << ") : pushed " << s.pushed
+        << " : taken " << s.taken << " : stolen " << s.stolen << " : credits " << s.credits_in_use;
+    return os;
+}
+
+/** @class ws_scheduler
+ *  @desc Work stealing scheduler for a fixed set of worker threads
+ *  One coordinator submits tasks to the workers, every worker has a ws_deque that the
+ *  coordinator pushes to (it's the owner of all of them). A worker runs tasks from the top
+ *  of its own deque in order and when that is empty steals from the others, so the tasks
+ *  queued behind a slow one are run by whoever is idle instead of waiting for it.
+ *
+ *  Every worker also has an inbox queue for waking it up and for the stop. An idle worker
+ *  sleeps on its inbox, submit wakes the worker the task is for or, if that one is busy,
+ *  an idle worker that can steal it.
+ *
+ *  Task has to be trivially copyable (see ws_deque), keep it small.
+ *  Inbox is the queue template used for the inboxes, it decides how idle workers wait.
+ *
+ *  With a capacity every worker takes at most that many tasks (in its deque) and
+ *  submit blocks, fails or spills to another worker when it's full (overflow_policy).
+ *  The credits go back when a task leaves the deque, to the worker or to a thief,
+ *  so a stuck worker stops receiving instead of piling up work.
+ *
+ *  Threads are owned by the user:
+ *      coordinator: submit(i, task)... then shutdown()
+ *      worker i:    while(sched.next(i, task)) { run(task); }
+*/
+template<typename Task, template<typename> class Inbox>
+class ws_scheduler
+{
+private:
+    /// Messages from the coordinator to a worker, the tasks go to the deque
+    struct envelope
+    {
+        explicit envelope(bool s = false)
+            : stop(s)
+        {}
+
+        bool stop;
+    };
+
+    /// Everything a single worker owns, each one on its own cache lines
+    struct worker
+    {
+        explicit worker(size_t n_reserve = 64)
+            : tasks(n_reserve)
+            , pushed(0)
+            , high_water(0)
+            , taken(0)
+            , stolen(0)
+            , sleeping(false)
+            , stopping(false)
+            , working(false)
+        {}
+
+        Inbox<envelope> inbox;
+        // pushed by the coordinator, taken from the top by everyone
+        ws_deque<Task> tasks;
+        // queue counters, pushed and high_water written by the coordinator, taken by the
+        // worker and stolen by the thieves
+        std::atomic<uint64_t> pushed;
+        std::atomic<uint64_t> high_water;
+        std::atomic<uint64_t> taken;
+        std::atomic<uint64_t> stolen;
+        // waiting on the inbox, the coordinator clears it when it wakes the worker
+        std::atomic<bool> sleeping;
+        // tasks in the deque
+        credit_counter credits;
+        // only touched by the worker thread
+        bool stopping;
+        bool working;
+        vl::stop_chrono busy;
+        worker_stats stats;
+        char pad[CACHE_LINE_SIZE];
+    };
+
+public:
+    /// @brief Constructor
+    /// @param n_workers how many workers will call next
+    /// @param idle_wait how long an idle worker waits on its inbox before looking for work again,
+    ///        submit wakes it up earlier
+    /// @param capacity tasks queued per worker at most, 0 for no limit
+    ws_scheduler(size_t n_workers, vl::time const &idle_wait = vl::time(0, 1000), size_t capacity = 0)
+        : pending(0)
+        , workers(n_workers)
+        , idle(idle_wait)
+        , stop_poll(idle_wait < vl::time(0, 1000) ? idle_wait : vl::time(0, 1000))
+        , limit(capacity)
+    {
+        assert(n_workers > 0);
+        for(size_t i = 0; i < n_workers; ++i)
+        {
+            workers[i] = new worker;
+            workers[i]->busy.stop();
+            workers[i]->credits.set_capacity(limit);
+        }
+    }
+
+    /// Destructor, the workers have to be done
+    ~ws_scheduler()
+    {
+        for(size_t i = 0; i < workers.size(); ++i)
+        {
+            delete workers[i];
+        }
+    }
+
+    /// @brief rebuild the state of worker i (inbox, deque, counters) from the calling thread
+    /// Memory is placed on the NUMA node of the thread that first touches it, so call this
+    /// from a thread pinned next to the worker (see run_on_cpu in topology.hpp).
+    /// Only before anything is submitted and before any worker calls next,
+    /// watermarks set on the worker's credits before this are gone.
+    /// @param i worker index
+    /// @param n_reserve tasks to allocate room for up front, these are first touched here too
+    void attach(size_t i, size_t n_reserve = 0)
+    {
+        // the coordinator pushes to the deque later, it's synchronised with us by the caller
+        worker *w = new worker(n_reserve);
+        w->busy.stop();
+        w->credits.set_capacity(limit);
+        delete workers.at(i);
+        workers[i] = w;
+    }
+
+    /// @brief number of workers
+    size_t size() const
+    {
+        return workers.size();
+    }
+
+    /// @brief give a task to a worker, only the coordinator
+    /// The task might still end up being run by another worker, an idle one is woken up
+    /// if the worker is busy.
+    /// @param i worker index
+    /// @param task task to run
+    /// @param policy what to do if the worker is full, only matters with a capacity
+    /// @return false if the worker was full and policy is OVERFLOW_FAIL
+    bool submit(size_t i, Task task, overflow_policy policy = OVERFLOW_BLOCK)
+    {
+        return submit(i, task, policy, [](Task &) {});
+    }
+
+    /// @brief submit that lets the caller touch the task once there is room for it
+    /// For stamping the time the task really goes out, after any wait for credits.
+    /// @param before_push called with the task right before it's queued, not if submit fails
+    template<typename F>
+    bool submit(size_t i, Task task, overflow_policy policy, F before_push)
+    {
+        worker *w = workers.at(i);
+        if(!w->credits.try_acquire())
+        {
+            if(policy == OVERFLOW_FAIL)
+            { return false; }
+
+            // the first one after i with room, i itself if nobody has any
+            w = nullptr;
+            for(size_t j = 1; policy == OVERFLOW_SPILL && j < workers.size() && w == nullptr; ++j)
+            {
+                worker *other = workers[(i + j) % workers.size()];
+                if(other->credits.try_acquire())
+                { w = other; }
+            }
+            if(w == nullptr)
+            {
+                w = workers[i];
+                w->credits.acquire();
+            }
+        }
+
+        before_push(task);
+        pending.fetch_add(1, std::memory_order_relaxed);
+        w->tasks.push(task);
+        count(w->pushed, 1);
+        if(w->tasks.size() > w->high_water.load(std::memory_order_relaxed))
+        { w->high_water.store(w->tasks.size(), std::memory_order_relaxed); }
+        wake(*w);
+        return true;
+    }
+
+    /// @brief tell the workers to quit once all the submitted tasks are done, only the coordinator
+    /// No submits are allowed after this.
+    void shutdown()
+    {
+        for(size_t i = 0; i < workers.size(); ++i)
+        {
+            workers[i]->inbox.push(envelope(true));
+        }
+    }
+
+    /// @brief get the next task for a worker, blocks until there is one, only from worker i
+    /// Also marks the previous task of this worker done for the busy time.
+    /// @param i worker index
+    /// @param task OUT the task to run
+    /// @return true if there is a task, false when shutdown has been called and all work is done
+    bool next(size_t i, Task &task)
+    {
+        worker &w = *workers.at(i);
+        if(w.working)
+        {
+            w.busy.stop();
+            w.working = false;
+            pending.fetch_sub(1, std::memory_order_release);
+        }
+
+        while(true)
+        {
+            drain_inbox(w);
+
+            if(take_own(w, task) || steal(i, task))
+            {
+                ++w.stats.executed;
+                w.working = true;
+                w.busy.resume();
+                return true;
+            }
+
+            // nothing more is coming and everything has been done
+            // while others are still busy their deques might get work for us to steal later
+            if(w.stopping && pending.load(std::memory_order_acquire) == 0)
+            {
+                return false;
+            }
+
+            // a submit after this sees the flag and wakes us, one before it is seen here
+            w.sleeping.store(true, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(!any_queued())
+            {
+                // after the stop nobody wakes us when the last task finishes, look more often
+                w.inbox.wait(w.stopping ? stop_poll : idle);
+            }
+            w.sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief statistics for a worker
+    /// Only valid from that worker or after it has quit.
+    worker_stats stats(size_t i) const
+    {
+        worker const &w = *workers.at(i);
+        worker_stats s = w.stats;
+        s.busy = w.busy.elapsed();
+        return s;
+    }
+
+    /// @brief flow control of worker i, for the watermarks and monitoring
+    /// Set the watermarks before anything is submitted, the low water callback is called
+    /// by whichever worker drained the task.
+    credit_counter &credits(size_t i)
+    {
+        return workers.at(i)->credits;
+    }
+
+    /// @brief counters of worker i's task queue, from any thread
+    /// Where the batches wait, for seeing which worker is backing up.
+    worker_queue_stats queue_stats(size_t i) const
+    {
+        worker const &w = *workers.at(i);
+        worker_queue_stats s;
+        // the ones leaving first so the depth doesn't go negative
+        s.taken = w.taken.load(std::memory_order_relaxed);
+        s.stolen = w.stolen.load(std::memory_order_relaxed);
+        s.pushed = w.pushed.load(std::memory_order_relaxed);
+        s.high_water = w.high_water.load(std::memory_order_relaxed);
+        s.depth = s.pushed > s.taken + s.stolen ? s.pushed - s.taken - s.stolen : 0;
+        s.credits_in_use = w.credits.in_use();
+        return s;
+    }
+
+    /// @brief the inbox of worker i, for monitoring (stats, empty)
+    /// Only the wake ups and the stop go through it, see queue_stats for the tasks.
+    Inbox<envelope> const &inbox(size_t i) const
+    {
+        return workers.at(i)->inbox;
+    }
+
+private:
+    // not copyable, shared with other threads
+    ws_scheduler(ws_scheduler const &);
+    ws_scheduler &operator=(ws_scheduler const &);
+
+    /// @brief add to a counter that only one thread writes
+    static void count(std::atomic<uint64_t> &counter, uint64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    /// @brief read the wake ups and the stop
+    void drain_inbox(worker &w)
+    {
+        w.inbox.consume_all([&w](envelope const &e)
+        {
+            if(e.stop)
+            { w.stopping = true; }
+        });
+    }
+
+    /// @brief the oldest task of our own deque, retried if a thief beat us to it
+    bool take_own(worker &w, Task &task)
+    {
+        while(!w.tasks.empty())
+        {
+            if(w.tasks.steal(task))
+            {
+                count(w.taken, 1);
+                w.credits.release(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief is there anything to run in any of the deques
+    bool any_queued() const
+    {
+        for(size_t j = 0; j < workers.size(); ++j)
+        {
+            if(!workers[j]->tasks.empty())
+            { return true; }
+        }
+        return false;
+    }
+
+    /// @brief after a push to w's deque, wake w or if it's busy an idle worker to steal the task
+    void wake(worker &w)
+    {
+        // pairs with the fence in next, either we see the flag or the worker sees the task
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        worker *target = &w;
+        for(size_t j = 0; j < workers.size() && !target->sleeping.load(std::memory_order_relaxed); ++j)
+        {
+            target = workers[j];
+        }
+        if(target->sleeping.exchange(false, std::memory_order_relaxed))
+        {
+            target->inbox.push(envelope());
+        }
+    }
+
+    /// @brief try every other worker once, starting from our neighbour
+    bool steal(size_t i, Task &task)
+    {
+        worker &w = *workers[i];
+        for(size_t j = 1; j < workers.size(); ++j)
+        {
+            worker &victim = *workers[(i + j) % workers.size()];
+            if(victim.tasks.empty())
+            {
+                continue;
+            }
+
+            if(victim.tasks.steal(task))
+            {
+                // it left the victim's queue, the coordinator can send it another one
+                victim.credits.release(1);
+                // any worker can steal, this one needs a locked add
+                victim.stolen.fetch_add(1, std::memory_order_relaxed);
+                ++w.stats.stolen;
+                return true;
+            }
+            ++w.stats.failed_steals;
+        }
+        return false;
+    }
+
+    // tasks submitted but not finished
+    std::atomic<size_t> pending;
+    char pad[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+
+    std::vector<worker *> workers;
+    vl::time idle;
+    vl::time stop_poll;
+    // tasks per worker at most, 0 for none
+    size_t limit;
+};
+
+#endif  // WS_SCHEDULER_HPP